@@ -1,8 +1,29 @@
-#include <SPI.h>
-#include <TFT_eSPI.h>
 #include "esp_camera.h"
 #include "sd_read_write.h"
+#include "hal.h"
+#if defined(HOST_BUILD)
+#include "host/hal_host.h"
+#else
+#include "hal_esp32.h"
+#endif
 #include "img_computing.h"
+#include "isr_events.h"
+#include "auto_exposure.h"
+#include "isp_offload.h"
+#include "camera_mode.h"
+#include "boot_sequence.h"
+#include "sensor_profile.h"
+#include "motion_detect.h"
+#include "blob_tracker.h"
+#include "focus.h"
+#include "http_server.h"
+#include "stream_rate.h"
+#include "remote_control.h"
+#include "serial_export.h"
+#include "jpeg_encoder.h"
+#include "palette_quant.h"
+#include "capture_manifest.h"
+#include "hdr_merge.h"
 #include <esp_timer.h>
 
 #define CAMERA_MODEL_ESP32S3_EYE
@@ -16,39 +37,274 @@
 #define DirA_PIN 14 
 #define DirB_PIN 20
 int val = 0;
-uint8_t mappedAEC = 300;
-int lastAEC = 300;
+int mappedAEC = 110;       // AE target luma from the Value_PIN potentiometer
+int lastAEC = 110;
+AutoExposure autoExposure;
+FrameStats frameStats;
 //int tint[3] = {255, 255, 255};
 int photo_index = 0;
-// Shared volatile flag for interrupt communication
-volatile int captureRequested = 0;
-volatile unsigned long lastInterruptTime = 0;
-volatile unsigned long lastInterruptTime_GrabMode = 0;
-volatile unsigned long lastInterruptTime_Butt = 0;
-volatile bool GrabbingMode = 0;
+// Capture state, owned by loop(): 0 = live, 1 = capture pending, 2 = hold last capture
+int captureRequested = 0;
+bool captureHold = true;   // false: go straight back to live after saving (motion captures)
+bool GrabbingMode = 0;
+// RGB565 captures: file format of the processed frame on the SD card
+enum CaptureFormat { CAPTURE_BMP, CAPTURE_JPEG, CAPTURE_PNG, CAPTURE_BMP8 };
+const CaptureFormat CaptureFileFormat = CAPTURE_JPEG;
+const uint8_t CaptureJpegQuality = 90;
+const uint8_t CapturePngLevel = PNG_LEVEL_FAST;   // lossless; PNG_LEVEL_STORED (fastest) .. PNG_LEVEL_BEST (smallest)
+const uint16_t CapturePaletteColors = 256;        // 8-bit BMP: per-frame median-cut palette, lossless up to this many colours
+PaletteQuantizer paletteQuantizer;
+// Capture manifest on the SD card: one line per saved capture with its dHash. Automatic captures (motion, time-lapse)
+// within CaptureDuplicateDistance bits of the last saved hash are skipped; button captures are always saved
+CaptureManifest captureManifest;
+const char *CaptureManifestPath = "/camera/manifest.csv";
+const uint8_t CaptureDuplicateDistance = 6;   // of 64 bits; 0 keeps every capture
+uint64_t captureHash = 0;                     // hash of the capture being saved
+uint8_t captureHashDistance = 64;
+unsigned long TimeLapseInterval = 0;          // ms between automatic captures, 0 = off
+unsigned long lastTimeLapse = 0;
+// HDR bracketing: button captures in normal mode take three frames HdrEvStep stops apart (set_aec_value),
+// merge them on both cores and save/show the tone-mapped result
+bool HdrBracketing = false;
+const uint8_t HdrEvStep = 2;                  // stops between frames (x4 exposure)
+const uint16_t HdrToneContrast = 48;          // Q8 S-curve strength after the merge
+HdrBracket hdrBracket;
+// ISR -> loop() event ring, timestamped with esp_timer
+IsrEventQueue<16> isrEvents;
+IsrDebounce debounceCapture = {0};
+IsrDebounce debounceGrabMode = {0};
+IsrDebounce debounceButt = {0};
+uint32_t reportedDroppedEvents = 0;
+int64_t captureTriggerTime = 0;
 volatile unsigned long lastUpdateExposureTime = 0;
-const unsigned long debounceDelay = 200; 
+const int64_t debounceDelayUs = 200000; // 200ms debounce
 const unsigned long UpdateExposureDelay = 5000; // 1000ms debounce
 ColorAdjustment my_adjustments[] = {
     {HUE_BLUE, 43, 25, 15},    // 藍→紫
     {HUE_RED, 43, 20, 5},      // 紅→黃
     {HUE_GREEN, -20, 15, 50}   // 綠微調
 };
+// Filter mode request; the ISP planner splits it between sensor and software
+FilterRequest filterRequest = {0, 0, 0, my_adjustments, 3};
+FilterRequest previewRequest = {0, 0, 0, nullptr, 0};
+FilterPlan filterPlan;
+// Colour-correction matrix and tone curve, fused into the filter-mode colour pass.
+// Both can be changed between frames: set_matrix rebuilds 128 table entries, set_tone 768.
+ColorCorrection colorCorrection;
+const int16_t ColorSaturation = 256;   // Q8, 1.0 = unchanged (e.g. 307 for 1.2x)
+const uint16_t ColorGamma = 256;       // Q8, 1.0 = no tone curve
+bool colorBenchPending = false;        // true: time HSV vs CCM once on the first filter frame (stalls that frame; see host/bench_color)
+// YUV422 capture: hue rotation and saturation applied to the shared Cb/Cr pair while
+// converting to RGB565; replaces the HSV adjustments in filter mode
+ChromaTransform chromaTransform;
+const int16_t ChromaHueShift = 43;     // 0-255 per turn, same direction as the HSV hue
+const int16_t ChromaSaturation = 307;  // Q8, 1.2x
+int64_t rgbPipelineUs = 0;             // filter mode load + colour pass: RGB565 capture, HSV
+int64_t yuvPipelineUs = 0;             // filter mode load + colour pass: YUV422 capture, chroma
+uint32_t pipelineFrames = 0;
+const uint32_t PipelineReportFrames = 100;
+// Denoise low-light frames (once AE has raised the sensor gain)
+DenoiseFilter denoiseFilter = DENOISE_MEDIAN;
+const int DenoiseGainThreshold = 8;
+// Temporal denoise (multi-frame EWMA) replaces the spatial filter when enabled
+bool temporalDenoiseEnabled = true;
+TemporalDenoise temporalDenoise;
+int64_t previewPassUs = 0;      // running average of the plain preview pass
+int64_t filterPassUs = 0;       // filter pass without temporal denoise
+int64_t temporalPassUs = 0;     // filter pass with temporal denoise fused in
+uint32_t temporalFrames = 0;
+const uint32_t TemporalReportFrames = 100;
+// Motion-triggered capture
+MotionDetector motionDetector;
+// Colour-blob tracking, fed by the filter-mode colour pass
+BlobTracker blobTracker;
+const ColorAdjustment trackTarget = {HUE_RED, 0, 12, 0};   // hue and range to track
+uint32_t blobFrames = 0;
+const uint32_t BlobReportFrames = 30;
+// Contrast autofocus (OV5640 VCM) and focus peaking on the live view
+FocusController focusController;
+bool focusPeaking = true;
+const uint16_t FocusPeakThreshold = 40;   // |dx| + |dy| on the 2R+2G+B luma (0..219)
+uint32_t focusFrames = 0;
+const uint32_t FocusReportFrames = 50;
+// Runtime camera modes, cycled with DirA/DirB
+CameraModeManager camMode;
+const CameraMode cameraModes[] = {
+    {FRAMESIZE_QVGA, PIXFORMAT_RGB565, 2},
+    {FRAMESIZE_HVGA, PIXFORMAT_RGB565, 2},
+    {FRAMESIZE_VGA,  PIXFORMAT_RGB565, 2},
+    {FRAMESIZE_VGA,  PIXFORMAT_JPEG,   2},
+    {FRAMESIZE_SVGA, PIXFORMAT_JPEG,   2},
+    {FRAMESIZE_QVGA, PIXFORMAT_YUV422, 2},
+};
+const int numCameraModes = sizeof(cameraModes) / sizeof(cameraModes[0]);
+int cameraModeIndex = 0;
+
 
+// WiFi and HTTP server (camera_index.h UI, /stream MJPEG); an empty SSID disables networking
+const char *WifiSsid = "";
+const char *WifiPassword = "";
+uint16_t HttpControlPort = HTTP_CONTROL_PORT;
+uint16_t HttpStreamPort = HTTP_STREAM_PORT;
+HttpServer httpServer;
+RateController streamRate;              // adaptive JPEG quality / frame skip / downscale for viewers
+// Binary control channel (Serial, POST /rc, WebSocket /ws); changes switch in at a frame boundary
+RemoteControl remoteControl;
+// Processed frames over Serial to host/frame_receiver (raw, RLE or delta); the remote EXPORT message toggles it
+SerialExporter serialExport;
+uint8_t SerialExportCodec = EXPORT_OFF;
+uint8_t SerialExportEvery = 1;          // send every Nth frame
+uint32_t exportFrames = 0;              // frames handed to the export task
+int64_t exportReportUs = 0;
+uint32_t exportReportSent = 0;
+uint64_t exportReportBytes = 0;
+const uint32_t ExportReportFrames = 100;
+uint32_t streamFrames = 0;              // frames published to viewers
+const uint32_t StreamReportFrames = 100;
 
-TFT_eSPI tft = TFT_eSPI();
+// Platform drivers behind the HAL (ESP32 on target, mocks on the Linux host build)
+PlatformCamera halCamera;
+PlatformStorage halStorage;
+PlatformDisplay halDisplay;
+PlatformInput halInput(Value_PIN);
+PlatformNetwork halNetwork;
+Hal hal = { &halCamera, &halStorage, &halDisplay, &halInput, &halNetwork };
+// Boot orchestration
+BootTimeline bootTimeline = {};
+bool cameraReady = false;
+bool sdReady = false;
+bool displayReady = false;
+// Sensor profile: restored at boot and across driver reinits, saved once AE/AWB converge
+SensorProfile sensorProfile;
+bool sensorProfileValid = false;
+SensorProfile savedProfile;
+bool savedProfileValid = false;
+uint16_t aeConvergedFrames = 0;
+unsigned long lastProfileSave = 0;
+const uint16_t ProfileSaveFrames = 30;              // converged frames before saving
+const unsigned long ProfileSaveInterval = 300000;   // min 5 min between flash writes
+const char *ProfileSdPath = "/camera/sensor.bin";
 
+// Prototypes (the Arduino builder generates these; spelled out for the host build)
+bool bootSdCard();
+bool bootCamera();
+bool bootDisplay();
+bool listCameraDir();
+bool bootNetwork();
+int httpControl(const char *var, int value);
+void publishStreamFrame(camera_fb_t *fb, const uint16_t *buf);
+void reportStreamClients();
+void pollRemoteControl();
+void applyRemoteConfig(uint8_t changed);
+void reportRemoteLatency();
+void exportSerialFrame(const uint16_t *buf);
+void reportSerialExport();
+void updateSensorProfile(sensor_t *s);
+void restoreSdSensorProfile();
+void markFirstFrame();
+void configureSensor(sensor_t *s);
+void switchCameraMode(int step);
+void showFrame(uint16_t *buf);
+void drawBlobOverlay();
+void reportBlobs();
+void reportFocus(bool focused);
+void initGrabMode();
+void NormalGrabMode(bool Normal_EN);
+void applyFilterPlan();
+void NormalGrabMode_EN();
+void NormalGrabMode_DIS();
+void GrabOneImg();
+void checktrigger(int trigger);
+void TriggerA();
+void TriggerB();
+void handleIsrEvents();
+bool requestCapture(int64_t triggerTime, bool hold);
+void reportCaptureLatency(int64_t frameTime, int64_t savedTime);
+bool saveJpegCapture(const char *path, const uint16_t *buf, uint16_t width, uint16_t height, bool byteSwapped);
+String saveProcessedCapture(uint16_t *buf, uint16_t width, uint16_t height, bool byteSwapped);
+bool skipDuplicateCapture(const uint16_t *buf, uint16_t width, uint16_t height, bool byteSwapped);
+void recordCapture(const String &path);
+bool grabBracketFrame(uint16_t *dst);
+bool captureHdrBracket();
+void trackPassTime(int64_t &average, int64_t passTime);
+void reportTemporalOverhead();
+void benchmarkColorStages(const uint16_t *frame, uint32_t pixelCount);
+void reportPipelineThroughput();
+void fixEndianness(uint16_t *buf, size_t len);
+void fixEndianness_fast(uint16_t *buf, size_t len);
 
 void setup() {
   Serial.begin(115200);
   Serial.println("Initializing...");
+  boot_phase_begin(&bootTimeline, BOOT_SETUP);
   pinMode(2, INPUT);
+  temporal_denoise_init(&temporalDenoise, 2, 3, 12);
+  manifest_init(&captureManifest, CaptureDuplicateDistance);
+  hdr_init(&hdrBracket, HdrEvStep, HdrToneContrast);
+  motion_init(&motionDetector, 12, 3, 2, 10000);   // 3% of blocks for 2 frames, 10 s cooldown
+  blob_tracker_init(&blobTracker, &trackTarget, 80, 40, 64);  // min saturation, min value, min area
+  int16_t ccm[9];
+  color_correction_init(&colorCorrection);
+  color_correction_saturation_matrix(ccm, ColorSaturation);
+  color_correction_set_matrix(&colorCorrection, ccm);
+  color_correction_set_gamma(&colorCorrection, ColorGamma);
+  chroma_transform_set(&chromaTransform, ChromaHueShift, ChromaSaturation);
+  rc_init(&remoteControl, my_adjustments, sizeof(my_adjustments) / sizeof(my_adjustments[0]), GrabbingMode, cameraModeIndex);
+  export_init(&serialExport, &Serial, SerialExportCodec, SerialExportEvery);
   
-  //SD Card Config
-  sdmmcInit();
-  createDir(SD_MMC, "/camera");
-  listDir(SD_MMC, "/camera", 0);
+  // SD (core 0) and TFT (core 0) initialise while the camera initialises here
+  BootTask *sdTask = boot_start_phase(&bootTimeline, BOOT_SD, bootSdCard, 0);
+  BootTask *tftTask = boot_start_phase(&bootTimeline, BOOT_TFT, bootDisplay, 0);
+  cameraReady = boot_run_phase(&bootTimeline, BOOT_CAMERA, bootCamera);
+  sdReady = boot_wait_phase(sdTask);
+  displayReady = boot_wait_phase(tftTask);
+  if (cameraReady && sdReady) {
+    restoreSdSensorProfile();
+  }
+
+  if (!cameraReady && displayReady) {
+    hal.display->println("Camera init failed");
+  }
+  if (!sdReady) {
+    Serial.println("SD unavailable, captures disabled");
+  } else if (captureManifest.next_index) {
+    // Continue the numbering from the manifest instead of overwriting earlier captures
+    photo_index = captureManifest.next_index;
+    Serial.printf("Capture manifest: next index %u, last dHash %016llx\n", photo_index, (unsigned long long)captureManifest.last_hash);
+  }
+
+  // Setup Grabbing interrupt
+  pinMode(TRIGGER_PIN, INPUT);
+  pinMode(NormalMode_PIN, INPUT);
+  pinMode(FilterMode_PIN, INPUT);
+  attachInterrupt(TRIGGER_PIN, GrabOneImg, FALLING);
+  attachInterrupt(NormalMode_PIN, NormalGrabMode_EN, RISING);
+  attachInterrupt(FilterMode_PIN, NormalGrabMode_DIS, RISING);
+  //Setup Direction Button
+  pinMode(DirA_PIN, INPUT);
+  pinMode(DirB_PIN, INPUT);
+  Serial.println("DoneSetupInputPIN");
+  attachInterrupt(DirA_PIN, TriggerA, FALLING);
+  attachInterrupt(DirB_PIN, TriggerB, FALLING);
+  //Done
   
+  if (cameraReady) {
+    initGrabMode();
+  }
+  boot_phase_end(&bootTimeline, BOOT_SETUP, cameraReady);
+  boot_phase_begin(&bootTimeline, BOOT_FIRST_FRAME);
+  Serial.println("System Ready");
+}
+
+//Boot phases
+bool bootSdCard(){
+  if (!hal.storage->begin()) return false;
+  createDir(hal.storage->fs(), "/camera");
+  manifest_load(&captureManifest, hal.storage->fs(), CaptureManifestPath);
+  return true;
+}
+
+bool bootCamera(){
   // Camera config
   camera_config_t config;
   config.ledc_channel = LEDC_CHANNEL_0;
@@ -87,120 +343,362 @@ void setup() {
     config.fb_count = 1;
   }
 
-  // Initialize camera
-  esp_err_t err = esp_camera_init(&config);
+  // Initialize camera (sensor settings are applied by configureSensor)
+  ae_init(&autoExposure, nullptr, mappedAEC);
+  sensorProfileValid = sensor_profile_load_nvs(&sensorProfile);
+  savedProfile = sensorProfile;
+  savedProfileValid = sensorProfileValid;
+  esp_err_t err = camera_mode_begin(&camMode, hal.camera, &config, configureSensor);
   if (err != ESP_OK) {
     Serial.printf("Camera init failed: 0x%x\n", err);
-    while(1); // Halt if camera fails
+    return false;
   }
+  return true;
+}
 
-  sensor_t *s = esp_camera_sensor_get();
+bool bootDisplay(){
+  // Initialize TFT
+  if (!hal.display->begin()) {
+    Serial.println("TFT initialization failed");
+    return false;
+  }
+  hal.display->println("Camera Ready");
+  return true;
+}
 
-  // Basic camera settings
-  s->set_vflip(s, 1);        // Vertical flip (if needed)
-  s->set_brightness(s, 2);   // Brightness (0 = default)
-  s->set_contrast(s, 0);     // Contrast (0 = default, 1 = slight increase)
-  s->set_saturation(s, 0);   // Saturation (0 = default)
-  s->set_special_effect(s, 0); // No special effect
+bool listCameraDir(){
+  listDir(hal.storage->fs(), "/camera", 0);
+  return true;
+}
 
-  // Auto White Balance (AWB)
-  s->set_wb_mode(s, 0);      // 0 = Auto White Balance
+bool bootNetwork(){
+  if (!hal.network->begin(WifiSsid, WifiPassword)) {
+    Serial.println("WiFi unavailable, HTTP server disabled");
+    return false;
+  }
+  sensor_t *s = hal.camera->sensor();
+  httpServer.control_hook = httpControl;
+  httpServer.remote = &remoteControl;
+  rate_init(&streamRate, HTTP_JPEG_QUALITY);
+  if (!http_server_begin(&httpServer, HttpControlPort, HttpStreamPort, s ? s->id.PID : 0)) return false;
+  Serial.printf("HTTP: http://%s:%u/  stream http://%s:%u/stream\n", hal.network->address(), HttpControlPort,
+                hal.network->address(), HttpStreamPort);
+  return true;
+}
 
-  // Auto Exposure Control (AEC) - Critical for auto exposure
-  s->set_exposure_ctrl(s, 1); // 
-  s->set_aec2(s, 1);         // Enable AEC2 (more advanced auto exposure)
-  s->set_ae_level(s, -2);     // AE level (0 = default, -2 to +2 for adjustments)
+//Persist the sensor profile once AE/AWB have settled
+void updateSensorProfile(sensor_t *s){
+  if (s == nullptr || !autoExposure.converged) {
+    aeConvergedFrames = 0;
+    return;
+  }
+  if (++aeConvergedFrames < ProfileSaveFrames) return;
+  if (lastProfileSave && millis() - lastProfileSave < ProfileSaveInterval) return;
 
-  // Auto Gain Control (AGC) - Often needed with auto exposure
-  s->set_gain_ctrl(s, 1);    // Enable automatic gain control
-  s->set_agc_gain(s, 0);     // Auto gain (0 = full auto)
+  SensorProfile current;
+  sensor_profile_capture(s, &autoExposure, &current);
+  if (savedProfileValid && !sensor_profile_differs(&current, &savedProfile)) return;
+  bool ok = sensor_profile_save_nvs(&current);
+  if (sdReady) {
+    sensor_profile_save_fs(hal.storage->fs(), ProfileSdPath, &current);
+  }
+  savedProfile = current;
+  savedProfileValid = true;
+  lastProfileSave = millis();
+  Serial.printf("Sensor profile saved (%u bytes): aec %u, gain %u %s\n", (unsigned)sizeof(SensorProfile),
+                current.aec_value, current.agc_gain, ok ? "" : "(NVS failed)");
+}
 
-  // 关键曝光控制设置
-  //s->set_exposure_ctrl(s, 0);   // 启用手动曝光
-  //s->set_aec2(s, 1);            // 禁用AEC2
-  //s->set_gain_ctrl(s, 0);       // 禁用自动增益控制
-  //s->set_agc_gain(s, 0);        // 固定增益值
-  //s->set_aec_value(s, mappedAEC);
-  /* 
-  ov5640.start(s);
+//SD copy of the profile, used when NVS is empty or fails its checksum (SD is only ready after the camera phase)
+void restoreSdSensorProfile(){
+  sensor_t *s = hal.camera->sensor();
+  if (s == nullptr || (sensorProfileValid && sensor_profile_valid(&sensorProfile, s->id.PID))) return;
+  SensorProfile sdProfile;
+  if (!sensor_profile_load_fs(hal.storage->fs(), ProfileSdPath, &sdProfile) || !sensor_profile_valid(&sdProfile, s->id.PID)) return;
+  Serial.println("NVS sensor profile missing, using the SD copy");
+  sensorProfile = sdProfile;
+  sensorProfileValid = true;
+  configureSensor(s);
+}
 
-  if (ov5640.focusInit() == 0) {
-    Serial.println("OV5640_Focus_Init Successful!");
+//First displayed frame closes the boot timeline
+void markFirstFrame(){
+  if (bootTimeline.first_frame_us) return;
+  bootTimeline.first_frame_us = esp_timer_get_time();
+  boot_phase_end(&bootTimeline, BOOT_FIRST_FRAME, true);
+  boot_print_timeline(&bootTimeline);
+  if (sdReady) {
+    boot_defer_phase(&bootTimeline, BOOT_DIR_LIST, listCameraDir, 0);
   }
+  boot_defer_phase(&bootTimeline, BOOT_NETWORK, bootNetwork, 0);
+}
 
-  if (ov5640.autoFocusMode() == 0) {
-    Serial.println("OV5640_Auto_Focus Successful!");
+//Sensor settings, re-applied after every driver (re)initialisation
+void configureSensor(sensor_t *s){
+  if (sensorProfileValid && sensor_profile_valid(&sensorProfile, s->id.PID)) {
+    // Warm start: tuned settings plus last converged exposure, gain and WB
+    sensor_profile_apply(s, &sensorProfile, &autoExposure);
+    lastAEC = autoExposure.target_luma;
+    Serial.println("Sensor profile restored");
+  } else {
+    // Basic camera settings
+    s->set_vflip(s, 1);        // Vertical flip (if needed)
+    s->set_brightness(s, 2);   // Brightness (0 = default)
+    s->set_contrast(s, 0);     // Contrast (0 = default, 1 = slight increase)
   }
-  */
-  // Initialize TFT
-  tft.begin();
-  if (!tft.width() || !tft.height()) {
-    Serial.println("TFT initialization failed");
-    while(1); // Halt if TFT fails
+  // Saturation, special effect, hue and AWB gains are set by applyFilterPlan()
+
+  // Software AE/AWB: sensor AEC/AGC/AWB are switched to manual and
+  // driven from the frame statistics gathered in loop()
+  ae_apply_sensor(&autoExposure, s);
+  applyFilterPlan();
+  // Hill-climb autofocus drives the VCM directly (no AF firmware download)
+  focus_init(&focusController, s);
+}
+
+//Camera mode switching
+void switchCameraMode(int step){
+  if (!cameraReady || camMode.lost) return;
+  // Carry the live sensor state across the driver reinit
+  sensor_t *s = hal.camera->sensor();
+  if (s) {
+    sensor_profile_capture(s, &autoExposure, &sensorProfile);
+    sensorProfileValid = true;
   }
-  tft.setRotation(1);
-  tft.fillScreen(TFT_BLACK);
-  tft.setTextColor(TFT_WHITE);
-  tft.println("Camera Ready");
+  int next = (cameraModeIndex + step + numCameraModes) % numCameraModes;
+  if (camera_mode_switch(&camMode, &cameraModes[next]) == ESP_OK) {
+    cameraModeIndex = next;
+  }
+  motion_reset(&motionDetector);
+  hal.display->fillScreen(TFT_BLACK);
+}
 
-  // Setup Grabbing interrupt
-  pinMode(TRIGGER_PIN, INPUT);
-  pinMode(NormalMode_PIN, INPUT);
-  pinMode(FilterMode_PIN, INPUT);
-  attachInterrupt(TRIGGER_PIN, GrabOneImg, FALLING);
-  attachInterrupt(NormalMode_PIN, NormalGrabMode_EN, RISING);
-  attachInterrupt(FilterMode_PIN, NormalGrabMode_DIS, RISING);
-  //Setup Direction Button
-  pinMode(DirA_PIN, INPUT);
-  pinMode(DirB_PIN, INPUT);
-  Serial.println("DoneSetupInputPIN");
-  attachInterrupt(DirA_PIN, TriggerA, FALLING);
-  attachInterrupt(DirB_PIN, TriggerB, FALLING);
-  //Done
-  
-  initGrabMode();
-  Serial.println("System Ready");
+//A failed mode switch that could not restore the old mode leaves the driver down; retry once a second
+void recoverCamera(){
+  static int64_t lastAttemptUs = 0;
+  int64_t now = esp_timer_get_time();
+  if (lastAttemptUs != 0 && now - lastAttemptUs < 1000000) {
+    delay(10);
+    return;
+  }
+  lastAttemptUs = now;
+  hal.display->fillScreen(TFT_BLACK);
+  hal.display->println("Camera lost, retrying");
+  if (camera_mode_recover(&camMode)) {
+    lastAttemptUs = 0;
+    motion_reset(&motionDetector);
+    hal.display->fillScreen(TFT_BLACK);
+  }
+}
+
+void showFrame(uint16_t *buf){
+  uint16_t w, h;
+  const uint16_t *view = camera_mode_fit_display(&camMode, buf, &w, &h);
+  if (view == nullptr) return;
+  // view may alias buf; leave a frame that is about to be saved untouched
+  if (focusPeaking && captureRequested != 1) {
+    focus_peaking((uint16_t*)view, w, h, FocusPeakThreshold, TFT_RED, true);
+  }
+  hal.display->pushImage((DISPLAY_WIDTH - w) / 2, (DISPLAY_HEIGHT - h) / 2, w, h, (uint16_t*)view);
+  markFirstFrame();
+  if (rc_frame_shown(&remoteControl)) reportRemoteLatency();
+}
+
+//Blob tracker output: boxes and centroids on the TFT, summary on Serial
+void drawBlobOverlay(){
+  uint16_t step = camera_mode_display_step(&camMode);
+  int32_t ox = (DISPLAY_WIDTH - camMode.width / step) / 2;
+  int32_t oy = (DISPLAY_HEIGHT - camMode.height / step) / 2;
+  for (uint8_t i = 0; i < blobTracker.blob_count; i++) {
+    const Blob &b = blobTracker.blobs[i];
+    hal.display->drawRect(ox + b.x0 / step, oy + b.y0 / step, (b.x1 - b.x0) / step + 1, (b.y1 - b.y0) / step + 1, TFT_GREEN);
+    hal.display->drawRect(ox + b.cx / step - 1, oy + b.cy / step - 1, 3, 3, TFT_RED);
+  }
+}
+
+void reportBlobs(){
+  if (++blobFrames % BlobReportFrames) return;
+  Serial.printf("Blobs: %u (%lld us%s)\n", blobTracker.blob_count, (long long)blobTracker.last_cost_us, blobTracker.overflow ? ", label overflow" : "");
+  for (uint8_t i = 0; i < blobTracker.blob_count; i++) {
+    const Blob &b = blobTracker.blobs[i];
+    Serial.printf("  #%u centroid (%u,%u) box (%u,%u)-(%u,%u) area %u\n", i, b.cx, b.cy, b.x0, b.y0, b.x1, b.y1, b.area);
+  }
+}
+
+//HTTP server hooks, called from loop()
+//framesize has to go through the camera mode manager (buffers, display scaling)
+int httpControl(const char *var, int value){
+  if (!strcmp(var, "adaptive")) {
+    streamRate.enabled = value != 0;
+    streamRate.quality = httpServer.jpeg_quality;
+    return 0;
+  }
+  //A manual quality setting from the page turns the rate controller off
+  if (!strcmp(var, "quality")) streamRate.enabled = false;
+  if (strcmp(var, "framesize") != 0) return -1;
+  for (int i = 0; i < numCameraModes; i++) {
+    if (cameraModes[i].frame_size == value && cameraModes[i].pixel_format == camMode.mode.pixel_format) {
+      switchCameraMode(i - cameraModeIndex);
+      return cameraModeIndex == i ? 0 : -2;
+    }
+  }
+  return -2;
+}
+
+//Encode once for all viewers; sensor JPEG is passed through untouched in normal mode (frame skip only)
+void publishStreamFrame(camera_fb_t *fb, const uint16_t *buf){
+  if (!http_server_wants_frame(&httpServer) || !rate_should_encode(&streamRate)) return;
+  bool published;
+  if (fb->format == PIXFORMAT_JPEG && GrabbingMode == 1) {
+    published = http_server_publish_jpeg(&httpServer, fb->buf, fb->len);
+  } else {
+    uint16_t w, h;
+    const uint16_t *frame = rate_prepare(&streamRate, buf, camMode.width, camMode.height, &w, &h);
+    if (streamRate.enabled) httpServer.jpeg_quality = rate_quality(&streamRate);
+    published = http_server_publish_rgb565(&httpServer, frame, w, h);
+  }
+  if (!published) return;
+  rate_update(&streamRate, &httpServer.broadcast);
+  reportStreamClients();
+}
+
+//Per-viewer delivered fps and backlog (frames behind the newest encode)
+void reportStreamClients(){
+  if (++streamFrames % StreamReportFrames) return;
+  FrameBroadcaster *b = &httpServer.broadcast;
+  int64_t now = esp_timer_get_time();
+  Serial.printf("Stream: %u viewers, encode %lld us, quality %u%s, skip %u, scale 1/%u, %u bytes/frame\n",
+                b->client_count, (long long)b->encode_us, httpServer.jpeg_quality, streamRate.enabled ? " (adaptive)" : "",
+                streamRate.skip, streamRate.scale, streamRate.frame_bytes);
+  // Sender tasks update the per-client stats under the broadcast lock
+  xSemaphoreTake(b->lock, portMAX_DELAY);
+  for (uint8_t i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+    const BroadcastClient *c = &b->clients[i];
+    if (!c->active) continue;
+    uint16_t fps = broadcast_client_fps_x10(c, now);
+    Serial.printf("  #%u: %u.%u fps, backlog %u, delivered %u, dropped %u, %u kB/s%s, latency %u ms\n",
+                  i, fps / 10, fps % 10, broadcast_client_backlog(b, c), c->delivered, c->dropped,
+                  c->drain_bps / 1024, c->saturated ? " (saturated)" : "", c->latency_us / 1000);
+  }
+  xSemaphoreGive(b->lock);
+}
+
+//Remote control: stage queued messages and switch the config in before this frame is grabbed
+void pollRemoteControl(){
+  rc_sync_mode(&remoteControl, GrabbingMode, cameraModeIndex);
+  rc_sync_export(&remoteControl, serialExport.codec, serialExport.every);
+  rc_poll_serial(&remoteControl, &Serial);
+  uint8_t changed = rc_process(&remoteControl, numCameraModes);
+  if (changed) applyRemoteConfig(changed);
+}
+
+void applyRemoteConfig(uint8_t changed){
+  const RcConfig *cfg = rc_active(&remoteControl);
+  // Always point at the active buffer; the other one is the next staging area
+  filterRequest.adjustments = (ColorAdjustment*)cfg->adjustments;
+  filterRequest.num_adjustments = cfg->adjustment_count;
+  if (changed & RC_CHANGED_EXPOSURE) {
+    autoExposure.target_luma = cfg->target_luma ? cfg->target_luma : mappedAEC;
+    autoExposure.ae_enabled = cfg->aec_value == 0;
+    if (!autoExposure.ae_enabled) {
+      autoExposure.aec_value = cfg->aec_value;
+      autoExposure.agc_gain = cfg->agc_gain;
+      ae_apply_sensor(&autoExposure, hal.camera->sensor());
+    }
+  }
+  if (changed & RC_CHANGED_CAMERA) switchCameraMode(cfg->camera_mode - cameraModeIndex);
+  if (changed & RC_CHANGED_GRAB) GrabbingMode = cfg->grab_mode;
+  if (changed & RC_CHANGED_EXPORT) export_configure(&serialExport, cfg->export_codec, cfg->export_every);
+  if (changed & (RC_CHANGED_ADJUSTMENTS | RC_CHANGED_GRAB | RC_CHANGED_CAMERA)) applyFilterPlan();
+}
+
+//Command-to-display latency of the last applied change
+void reportRemoteLatency(){
+  Serial.printf("Remote: applied %lld us, visible %lld us after receipt (%u commands, %u errors)\n",
+                (long long)remoteControl.last_apply_us, (long long)remoteControl.last_visible_us,
+                remoteControl.commands, remoteControl.errors);
+}
+
+//Serial frame export: the copy happens here, compression and the write on core 0
+void exportSerialFrame(const uint16_t *buf){
+  if (!export_offer(&serialExport, buf, camMode.width, camMode.height)) return;
+  reportSerialExport();
+}
+
+//Link throughput over the last report window; ratio is raw / wire bytes since boot
+void reportSerialExport(){
+  int64_t now = esp_timer_get_time();
+  if (exportFrames++ == 0) exportReportUs = now;
+  if (exportFrames % ExportReportFrames) return;
+  const SerialExporter *e = &serialExport;
+  float seconds = (now - exportReportUs) / 1000000.0f;
+  uint32_t sent = e->sent - exportReportSent;
+  uint64_t bytes = e->wire_bytes - exportReportBytes;
+  Serial.printf("Export: %.1f fps, %.0f kB/s, ratio %.2f, %u busy skips, %u keyframes, encode %lld us, send %lld us, latency %u ms\n",
+                sent / seconds, bytes / 1024.0f / seconds, e->wire_bytes ? (float)e->raw_bytes / e->wire_bytes : 0.0f,
+                e->busy_skips, e->keyframes, (long long)e->encode_us, (long long)e->send_us, e->latency_us / 1000);
+  exportReportUs = now;
+  exportReportSent = e->sent;
+  exportReportBytes = e->wire_bytes;
+}
+
+//Autofocus status
+void reportFocus(bool focused){
+  if (focused) {
+    Serial.printf("Focus locked at %u (score %u, %u moves)\n", focusController.position, focusController.best_score, focusController.moves);
+    return;
+  }
+  if (++focusFrames % FocusReportFrames) return;
+  static const char *states[] = {"no VCM", "searching", "locked"};
+  Serial.printf("Focus: score %u, %s, VCM %u\n", focusController.score, states[focusController.state], focusController.position);
 }
 
 //Grabbing Mode Control
 void initGrabMode(){
   GrabbingMode = digitalRead(NormalMode_PIN);
   Serial.println(GrabbingMode);
+  applyFilterPlan();
 }
 
 void NormalGrabMode(bool Normal_EN){
   GrabbingMode = Normal_EN;
   Serial.println(GrabbingMode);
+  applyFilterPlan();
 }
 
-void NormalGrabMode_EN(){
-  unsigned long currentTime = millis();
-  if (currentTime - lastInterruptTime_GrabMode > debounceDelay) {
-    NormalGrabMode(1);
+//Push what the sensor ISP can do to registers, keep the rest for software
+void applyFilterPlan(){
+  sensor_t *s = hal.camera->sensor();
+  isp_plan_filters(s, GrabbingMode ? &previewRequest : &filterRequest, &filterPlan);
+  autoExposure.awb_in_sensor = filterPlan.hw_awb;
+  // A hue rotation done in the sensor moves the tracked colour too
+  blobTracker.mask.target_hue = (uint8_t)(trackTarget.target_hue + filterPlan.hw_hue_shift);
+  if (filterPlan.hw_awb) {
+    build_channel_gain_lut(&autoExposure.lut, 256, 256, 256);
+    isp_apply_awb_gains(s, autoExposure.gain_r, autoExposure.gain_g, autoExposure.gain_b);
+  } else {
+    build_channel_gain_lut(&autoExposure.lut, autoExposure.gain_r, autoExposure.gain_g, autoExposure.gain_b);
   }
-  lastInterruptTime_GrabMode = currentTime;
 }
 
-void NormalGrabMode_DIS(){
-  unsigned long currentTime = millis();
-  if (currentTime - lastInterruptTime_GrabMode > debounceDelay) {
-    NormalGrabMode(0);
+void IRAM_ATTR NormalGrabMode_EN(){
+  int64_t now = esp_timer_get_time();
+  if (isr_debounce_accept(debounceGrabMode, now, debounceDelayUs)) {
+    isrEvents.push(EVT_MODE_NORMAL, now);
+  }
+}
+
+void IRAM_ATTR NormalGrabMode_DIS(){
+  int64_t now = esp_timer_get_time();
+  if (isr_debounce_accept(debounceGrabMode, now, debounceDelayUs)) {
+    isrEvents.push(EVT_MODE_FILTER, now);
   }
-  lastInterruptTime_GrabMode = currentTime;
 }
 //
-void GrabOneImg() {
-  unsigned long currentTime = millis();
-  if (currentTime - lastInterruptTime > debounceDelay) {
-    //Serial.println(captureRequested);
-    if(captureRequested == 2){
-      captureRequested = 0;
-    }
-    else{
-      captureRequested = 1;
-    }
-    //Serial.println(captureRequested);
-    lastInterruptTime = currentTime;
+void IRAM_ATTR GrabOneImg() {
+  int64_t now = esp_timer_get_time();
+  if (isr_debounce_accept(debounceCapture, now, debounceDelayUs)) {
+    isrEvents.push(EVT_CAPTURE, now);
   }
 }
 //
@@ -210,24 +708,255 @@ void checktrigger(int trigger){
   Serial.println(trigger);
 }
 
-void TriggerA(){
-  unsigned long currentTime = millis();
-  if (currentTime - lastInterruptTime_Butt > debounceDelay) {
-    checktrigger(1);
+void IRAM_ATTR TriggerA(){
+  int64_t now = esp_timer_get_time();
+  if (isr_debounce_accept(debounceButt, now, debounceDelayUs)) {
+    isrEvents.push(EVT_DIR_A, now);
+  }
+}
+
+void IRAM_ATTR TriggerB(){
+  int64_t now = esp_timer_get_time();
+  if (isr_debounce_accept(debounceButt, now, debounceDelayUs)) {
+    isrEvents.push(EVT_DIR_B, now);
+  }
+}
+//
+
+//Drain ISR events (runs in loop context, safe to print)
+void handleIsrEvents(){
+  IsrEvent ev;
+  while (isrEvents.pop(ev)) {
+    switch (ev.type) {
+      case EVT_CAPTURE:
+        if(captureRequested == 2){
+          captureRequested = 0;
+        }
+        else{
+          requestCapture(ev.timestamp_us, true);
+        }
+        break;
+      case EVT_MODE_NORMAL:
+        NormalGrabMode(1);
+        break;
+      case EVT_MODE_FILTER:
+        NormalGrabMode(0);
+        break;
+      case EVT_DIR_A:
+        checktrigger(1);
+        switchCameraMode(1);
+        break;
+      case EVT_DIR_B:
+        checktrigger(2);
+        switchCameraMode(-1);
+        break;
+    }
+  }
+
+  uint32_t dropped = isrEvents.droppedCount();
+  if (dropped != reportedDroppedEvents) {
+    Serial.printf("ISR events dropped: %u\n", dropped - reportedDroppedEvents);
+    reportedDroppedEvents = dropped;
   }
-  lastInterruptTime_Butt = currentTime;
 }
 
-void TriggerB(){
-  unsigned long currentTime = millis();
-  if (currentTime - lastInterruptTime_Butt > debounceDelay) {
-    checktrigger(2);
+//Capture requests from the button and the motion detector share this path
+bool requestCapture(int64_t triggerTime, bool hold){
+  if (captureRequested != 0) return false;
+  captureRequested = 1;
+  captureHold = hold;
+  captureTriggerTime = triggerTime;
+  return true;
+}
+
+//Trigger-to-capture latency
+void reportCaptureLatency(int64_t frameTime, int64_t savedTime){
+  Serial.printf("Capture latency: trigger->frame %lld us, trigger->saved %lld us\n",
+                (long long)(frameTime - captureTriggerTime), (long long)(savedTime - captureTriggerTime));
+}
+
+//Streams the frame through the encoder one MCU row at a time; only the current row and a small output chunk are buffered
+static bool writeJpegToFile(void *context, const uint8_t *data, size_t len){
+  return ((File *)context)->write(data, len) == len;
+}
+
+bool saveJpegCapture(const char *path, const uint16_t *buf, uint16_t width, uint16_t height, bool byteSwapped){
+  File file = hal.storage->fs().open(path, FILE_WRITE);
+  if (!file) {
+    Serial.println("Failed to open file");
+    return false;
+  }
+  int64_t start = esp_timer_get_time();
+  JpegEncoder encoder;
+  bool ok = jpeg_encoder_begin(&encoder, width, height, CaptureJpegQuality, JPEG_SUBSAMPLE_420, byteSwapped, writeJpegToFile, &file);
+  ok = ok && jpeg_encoder_write_lines(&encoder, buf, height);
+  ok = jpeg_encoder_end(&encoder) && ok;
+  size_t size = file.size();
+  file.close();
+  Serial.printf("%s: %u bytes JPEG q%u in %lld us%s\n", path, (unsigned)size, CaptureJpegQuality,
+                (long long)(esp_timer_get_time() - start), ok ? "" : " (write failed)");
+  return ok;
+}
+
+//BMP and PNG are written from native byte order, so a sensor-order buffer is swapped in place first
+String saveProcessedCapture(uint16_t *buf, uint16_t width, uint16_t height, bool byteSwapped){
+  static const char *extensions[] = {".bmp", ".jpg", ".png", ".bmp"};
+  String path = "/camera/" + String(photo_index) + extensions[CaptureFileFormat];
+  if (CaptureFileFormat == CAPTURE_JPEG) {
+    saveJpegCapture(path.c_str(), buf, width, height, byteSwapped);
+    return path;
+  }
+  if (byteSwapped) {
+    fixEndianness_fast(buf, (size_t)width * height);
+  }
+  int64_t start = esp_timer_get_time();
+  if (CaptureFileFormat == CAPTURE_PNG) {
+    writePNG_RGB565(hal.storage->fs(), path.c_str(), buf, width, height, CapturePngLevel);
+  } else if (CaptureFileFormat == CAPTURE_BMP8 && palette_build(&paletteQuantizer, buf, (size_t)width * height, CapturePaletteColors)) {
+    Serial.printf("Palette: %u colours for %u distinct (histogram %lld us, median cut + LUT %lld us)\n", paletteQuantizer.colors,
+                  paletteQuantizer.distinct, (long long)paletteQuantizer.histogram_us, (long long)paletteQuantizer.build_us);
+    writeBMP_Indexed8(hal.storage->fs(), path.c_str(), buf, width, height, paletteQuantizer.lut, paletteQuantizer.palette,
+                      paletteQuantizer.colors);
+  } else {
+    writeBMP_RGB565(hal.storage->fs(), path.c_str(), buf, width, height);
+  }
+  Serial.printf("%s written in %lld us\n", path.c_str(), (long long)(esp_timer_get_time() - start));
+  return path;
+}
+
+//Hashes the frame about to be saved; automatic captures too close to the last saved one are dropped
+bool skipDuplicateCapture(const uint16_t *buf, uint16_t width, uint16_t height, bool byteSwapped){
+  bool duplicate = manifest_check(&captureManifest, buf, width, height, byteSwapped, &captureHash, &captureHashDistance);
+  if (!duplicate || captureHold) return false;
+  captureManifest.skipped++;
+  Serial.printf("Capture skipped: %u bits from the last saved frame (dHash %016llx, %lld us), %u skipped so far\n",
+                captureHashDistance, (unsigned long long)captureHash, (long long)captureManifest.hash_us, captureManifest.skipped);
+  return true;
+}
+
+void recordCapture(const String &path){
+  if (!manifest_append(&captureManifest, hal.storage->fs(), CaptureManifestPath, photo_index, path.c_str(),
+                       captureHash, captureHashDistance)) {
+    Serial.println("Capture manifest: write failed");
   }
-  lastInterruptTime_Butt = currentTime;
+}
+//
+
+//HDR bracketing: loads one frame into the processing buffer and copies it out, so every capture mode works
+bool grabBracketFrame(uint16_t *dst){
+  camera_fb_t *fb = hal.camera->grab();
+  if (!fb) return false;
+  bool ok = camera_mode_load_frame(&camMode, fb);
+  hal.camera->release(fb);
+  if (ok) memcpy(dst, camMode.buffer, (size_t)camMode.width * camMode.height * sizeof(uint16_t));
+  return ok;
+}
+
+//Current exposure first (already settled), then short and long; AE is restored before the merge.
+//Returns false if nothing was captured, leaving the request to the single-frame path
+bool captureHdrBracket(){
+  sensor_t *s = hal.camera->sensor();
+  const uint16_t width = camMode.width;
+  const uint16_t height = camMode.height;
+  if (s == nullptr || !hdr_alloc(&hdrBracket, width, height)) {
+    Serial.println("HDR: no sensor or buffers, single-frame capture");
+    return false;
+  }
+  hdr_bracket_exposures(&hdrBracket, autoExposure.aec_value);
+  int64_t start = esp_timer_get_time();
+  int64_t frameTime = 0;
+  bool ok = true;
+  for (int i = 0; i < HDR_FRAMES && ok; i++) {
+    if (i > 0) {
+      s->set_aec_value(s, hdrBracket.aec[i]);
+      for (int k = 0; k < HDR_SETTLE_FRAMES && ok; k++) {
+        camera_fb_t *stale = hal.camera->grab();
+        if (stale) hal.camera->release(stale);
+        ok = stale != nullptr;
+      }
+    }
+    ok = ok && grabBracketFrame(hdrBracket.frames[i]);
+    if (i == 0) frameTime = esp_timer_get_time();
+  }
+  ae_apply_sensor(&autoExposure, s);
+  if (!ok) {
+    Serial.println("HDR: bracket grab failed, single-frame capture");
+    return false;
+  }
+  int64_t captured = esp_timer_get_time();
+  hdrBracket.capture_us = captured - start;
+
+  uint16_t *merged = camMode.buffer;
+  uint32_t pixelCount = (uint32_t)width * height;
+  hdr_merge_parallel(&hdrBracket, merged, true);
+  apply_channel_gain_buffer(merged, pixelCount, &autoExposure.lut, true);
+  int64_t mergedTime = esp_timer_get_time();
+  Serial.printf("HDR: aec %d/%d/%d, bracket %lld us, merge %lld us, capture->merged %lld us, trigger->merged %lld us\n",
+                hdrBracket.aec[0], hdrBracket.aec[1], hdrBracket.aec[2], (long long)hdrBracket.capture_us, (long long)hdrBracket.merge_us,
+                (long long)(mergedTime - start), (long long)(mergedTime - captureTriggerTime));
+
+  showFrame(merged);
+  captureRequested = captureHold ? 2 : 0;
+  skipDuplicateCapture(merged, width, height, true);   // button captures are never skipped; hashes for the manifest
+  String path = saveProcessedCapture(merged, width, height, true);
+  reportCaptureLatency(frameTime, esp_timer_get_time());
+  recordCapture(path);
+  photo_index = photo_index+1;
+  return true;
+}
+//
+
+//Per-frame processing cost, plain preview vs filter with and without temporal denoise
+void trackPassTime(int64_t &average, int64_t passTime){
+  average = average ? (average * 7 + passTime) / 8 : passTime;
+}
+
+void reportTemporalOverhead(){
+  if (++temporalFrames % TemporalReportFrames) return;
+  Serial.printf("Temporal denoise: %lld us/frame", (long long)temporalPassUs);
+  if (filterPassUs) Serial.printf(", +%lld us over filter only", (long long)(temporalPassUs - filterPassUs));
+  if (previewPassUs) Serial.printf(", +%lld us over plain preview", (long long)(temporalPassUs - previewPassUs));
+  Serial.println();
 }
 //
 
 //Fix Image
+//Colour stage benchmark: HSV adjustments vs CCM + tone LUT on a copy of a live frame
+void benchmarkColorStages(const uint16_t *frame, uint32_t pixelCount){
+  size_t bytes = pixelCount * sizeof(uint16_t);
+  uint16_t *scratch = (uint16_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+  if (scratch == nullptr) return;
+  const int runs = 5;
+  int64_t hsvUs = 0, ccmUs = 0, bothUs = 0;
+  for (int i = 0; i < runs; i++) {
+    memcpy(scratch, frame, bytes);
+    int64_t t0 = esp_timer_get_time();
+    adjust_multiple_colors_parallel(scratch, pixelCount, filterPlan.sw_adjustments, filterPlan.sw_count);
+    hsvUs += esp_timer_get_time() - t0;
+    memcpy(scratch, frame, bytes);
+    t0 = esp_timer_get_time();
+    adjust_multiple_colors_parallel(scratch, pixelCount, nullptr, 0, nullptr, nullptr, nullptr, nullptr, &colorCorrection);
+    ccmUs += esp_timer_get_time() - t0;
+    memcpy(scratch, frame, bytes);
+    t0 = esp_timer_get_time();
+    adjust_multiple_colors_parallel(scratch, pixelCount, filterPlan.sw_adjustments, filterPlan.sw_count, nullptr, nullptr, nullptr, nullptr, &colorCorrection);
+    bothUs += esp_timer_get_time() - t0;
+  }
+  heap_caps_free(scratch);
+  Serial.printf("Colour stage (%u px): HSV %lld us, CCM+tone %lld us, both %lld us\n",
+                pixelCount, (long long)(hsvUs / runs), (long long)(ccmUs / runs), (long long)(bothUs / runs));
+}
+
+//Load and colour pass per frame for the capture format in use; only paths that have run are printed
+//(host/bench_yuv times RGB565+HSV and YUV422+chroma side by side on the same frame)
+void reportPipelineThroughput(){
+  if (++pipelineFrames % PipelineReportFrames) return;
+  Serial.print("Filter pipeline:");
+  if (rgbPipelineUs) Serial.printf(" RGB565+HSV %lld us", (long long)rgbPipelineUs);
+  if (yuvPipelineUs) Serial.printf(" YUV422+chroma %lld us", (long long)yuvPipelineUs);
+  Serial.println();
+}
+
 void fixEndianness(uint16_t *buf, size_t len) {
     for (size_t i = 0; i < len; i++) {
         buf[i] = (buf[i] << 8) | (buf[i] >> 8);
@@ -252,70 +981,169 @@ void fixEndianness_fast(uint16_t *buf, size_t len) {
 //
 
 void loop() {
-  if(captureRequested != 2)
+  handleIsrEvents();
+  http_server_service(&httpServer, cameraReady ? hal.camera->sensor() : nullptr);
+  if (!cameraReady) {
+    delay(100);
+    return;
+  }
+  if (camMode.lost) {
+    recoverCamera();
+    return;
+  }
+  pollRemoteControl();
+  bool hdrCapture = HdrBracketing && captureRequested == 1 && captureHold && GrabbingMode == 1 && sdReady;
+  if (hdrCapture && captureHdrBracket()) {
+    // merged frame is on the LCD and saved, held like a single capture
+  }
+  else if(captureRequested != 2)
   {
-    /*
-    uint8_t rc = ov5640.getFWStatus();
-    Serial.printf("FW_STATUS = 0x%x\n", rc);
-
-    if (rc == -1) {
-      Serial.println("Check your OV5640");
-    } else if (rc == FW_STATUS_S_FOCUSED) {
-      Serial.println("Focused!");
-    } else if (rc == FW_STATUS_S_FOCUSING) {
-      Serial.println("Focusing!");
-    } else {
-    }
-    */
-    camera_fb_t *fb = esp_camera_fb_get();
+    camera_fb_t *fb = hal.camera->grab();
     if (!fb) {
       Serial.println("捕获失败");
-      tft.fillScreen(TFT_BLACK);
-      tft.println("捕获失败");
+      hal.display->fillScreen(TFT_BLACK);
+      hal.display->println("捕获失败");
       Serial.println("GrabFail");
       return;
     }
+    int64_t frameTime = esp_timer_get_time();
 
-    uint16_t* processedBuffer = (uint16_t*)malloc(320*240*sizeof(uint16_t));
-    Serial.println("Memory Pool Setup Done");
-    memcpy(processedBuffer, fb->buf, 320*240*sizeof(uint16_t));
-    String path = "/camera/" + String(photo_index) +".bmp";
+    uint16_t* processedBuffer = camMode.buffer;
+    const uint16_t width = camMode.width;
+    const uint16_t height = camMode.height;
+    const uint32_t pixelCount = (uint32_t)width * height;
+    bool yuvFilter = GrabbingMode == 0 && fb->format == PIXFORMAT_YUV422;
+    int64_t loadStart = esp_timer_get_time();
+    if (!camera_mode_load_frame(&camMode, fb, yuvFilter ? &chromaTransform : nullptr)) {
+      Serial.println("Frame load failed");
+      hal.camera->release(fb);
+      return;
+    }
+    int64_t loadUs = esp_timer_get_time() - loadStart;
+
+    if (motion_update(&motionDetector, processedBuffer, width, height, true) && requestCapture(frameTime, false)) {
+      Serial.printf("Motion: %u of %u blocks changed (%lld us)\n", motionDetector.changed_blocks,
+                    motionDetector.grid_w * motionDetector.grid_h, (long long)motionDetector.last_cost_us);
+    }
+    if (TimeLapseInterval && millis() - lastTimeLapse >= TimeLapseInterval && requestCapture(frameTime, false)) {
+      lastTimeLapse = millis();
+    }
+    // Sharpness of the raw frame, before any filtering
+    uint32_t focusScore = focus_score(processedBuffer, width, height, true);
+
+    val = hal.input->read();
+    mappedAEC = map(val, 0, 4095, 40, 200);
+    // A remote exposure target overrides the potentiometer until it is set back to 0
+    if (rc_active(&remoteControl)->target_luma == 0 && abs(mappedAEC - lastAEC) > 2) {
+      autoExposure.target_luma = mappedAEC;
+      lastAEC = mappedAEC;
+    }
 
     if(GrabbingMode == 1)
     {
       //Serial.println("Update image");
-      tft.pushImage(0, 0, 320, 240, processedBuffer);
+      int64_t passStart = esp_timer_get_time();
+      collect_frame_stats(processedBuffer, pixelCount, &frameStats, true);
+      apply_channel_gain_buffer(processedBuffer, pixelCount, &autoExposure.lut, true);
+      trackPassTime(previewPassUs, esp_timer_get_time() - passStart);
+      temporal_denoise_reset(&temporalDenoise);
+      publishStreamFrame(fb, processedBuffer);
+      exportSerialFrame(processedBuffer);
+      showFrame(processedBuffer);
+      if (captureRequested == 1 && !sdReady) {
+          Serial.println("Capture skipped: no SD card");
+          captureRequested = 0;
+      }
+      if (captureRequested == 1 && skipDuplicateCapture(processedBuffer, width, height, true)) {
+          captureRequested = 0;
+      }
       if (captureRequested == 1) {
-          captureRequested = 2;
-          fixEndianness_fast(processedBuffer,  320 * 240);
-          writeBMP_RGB565(SD_MMC, path.c_str(), processedBuffer, 320, 240);    
+          captureRequested = captureHold ? 2 : 0;
+          String path;
+          if (fb->format == PIXFORMAT_JPEG) {
+            path = "/camera/" + String(photo_index) +".jpg";
+            writejpg(hal.storage->fs(), path.c_str(), fb->buf, fb->len);
+          } else {
+            path = saveProcessedCapture(processedBuffer, width, height, true);
+          }
+          reportCaptureLatency(frameTime, esp_timer_get_time());
+          recordCapture(path);
           photo_index = photo_index+1;
       }
     }
     else{
-      val = analogRead(2);
-      mappedAEC = map(val, 0, 4095, -330, 30);
-      fixEndianness_fast(processedBuffer,  320 * 240);
+      fixEndianness_fast(processedBuffer, pixelCount);
+      if (colorBenchPending) {
+        colorBenchPending = false;
+        benchmarkColorStages(processedBuffer, pixelCount);
+      }
       uint64_t Starttime = esp_timer_get_time();
-      //adjust_hue_rgb565_inplace(processedBuffer,320,240,mappedAEC);
-      //adjust_hue_rgb565_parallel(processedBuffer,320*240,mappedAEC);
-      //process_noisy_image(processedBuffer, 320, 240);
-      adjust_multiple_colors_parallel(processedBuffer, 320*240, my_adjustments, 3);
+      //adjust_hue_rgb565_inplace(processedBuffer,width,height,mappedAEC);
+      //adjust_hue_rgb565_parallel(processedBuffer,pixelCount,mappedAEC);
+      bool lowLight = autoExposure.agc_gain >= DenoiseGainThreshold;
+      TemporalDenoise *temporal = nullptr;
+      if (lowLight && temporalDenoiseEnabled && temporal_denoise_alloc(&temporalDenoise, pixelCount)) {
+        temporal = &temporalDenoise;
+      } else {
+        temporal_denoise_reset(&temporalDenoise);
+        if (lowLight) {
+          process_noisy_image(processedBuffer, width, height, denoiseFilter);
+        }
+      }
+      HueMask *mask = nullptr;
+      if (blobTracker.enabled && blob_tracker_prepare(&blobTracker, width, height)) {
+        mask = &blobTracker.mask;
+      }
+      // YUV422 frames already had hue and saturation applied to Cb/Cr during the load
+      adjust_multiple_colors_parallel(processedBuffer, pixelCount, yuvFilter ? nullptr : filterPlan.sw_adjustments, yuvFilter ? 0 : filterPlan.sw_count,
+                                      &autoExposure.lut, &frameStats, temporal, mask, &colorCorrection);
+      if (mask) {
+        blob_tracker_label(&blobTracker);
+        reportBlobs();
+      }
       uint64_t Finishtime = esp_timer_get_time();
+      if (temporal) {
+        trackPassTime(temporalPassUs, Finishtime - Starttime);
+        reportTemporalOverhead();
+      } else if (!lowLight) {
+        trackPassTime(filterPassUs, Finishtime - Starttime);
+      }
+      if (fb->format != PIXFORMAT_JPEG) {
+        trackPassTime(yuvFilter ? yuvPipelineUs : rgbPipelineUs, loadUs + (Finishtime - Starttime));
+        reportPipelineThroughput();
+      }
       
+      if (captureRequested == 1 && !sdReady) {
+        Serial.println("Capture skipped: no SD card");
+        captureRequested = 0;
+      }
+      if (captureRequested == 1 && skipDuplicateCapture(processedBuffer, width, height, false)) {
+        captureRequested = 0;
+      }
       if (captureRequested == 1) {
         Serial.println(Finishtime - Starttime);
-        captureRequested = 2;
-        writeBMP_RGB565(SD_MMC, path.c_str(), processedBuffer, 320, 240);
+        captureRequested = captureHold ? 2 : 0;
+        String path = saveProcessedCapture(processedBuffer, width, height, false);
+        reportCaptureLatency(frameTime, esp_timer_get_time());
+        recordCapture(path);
         photo_index = photo_index+1;
       }
-      fixEndianness_fast(processedBuffer,  320 * 240);
-      tft.pushImage(0, 0, 320, 240, processedBuffer);
-
+      fixEndianness_fast(processedBuffer, pixelCount);
+      publishStreamFrame(fb, processedBuffer);
+      exportSerialFrame(processedBuffer);
+      showFrame(processedBuffer);
+      if (mask && blobTracker.overlay) {
+        drawBlobOverlay();
+      }
     }
-    free(processedBuffer);
 
-  esp_camera_fb_return(fb);
+  hal.camera->release(fb);
+  sensor_t *s = hal.camera->sensor();
+  if (ae_update(&autoExposure, s, &frameStats) && autoExposure.awb_in_sensor) {
+    isp_apply_awb_gains(s, autoExposure.gain_r, autoExposure.gain_g, autoExposure.gain_b);
+  }
+  updateSensorProfile(s);
+  reportFocus(focus_update(&focusController, s, focusScore));
   }
   
   delay(10);
@@ -0,0 +1,141 @@
+#ifndef __AUTO_EXPOSURE_H
+#define __AUTO_EXPOSURE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "img_computing.h"
+
+// ==================== 軟體自動曝光 / 自動白平衡 ====================
+// 使用處理迴圈中順便收集的 FrameStats:
+//   AE : 總曝光量 E = aec_value * (agc_gain + 1), 先拉長曝光時間再加增益
+//   AWB: 灰色世界假設, 以 G 為基準計算 R/B 的 Q8 增益
+
+#define AE_AEC_MIN        1
+#define AE_AEC_MAX        1200   // set_aec_value 上限
+#define AE_AGC_MAX        30     // set_agc_gain 上限
+#define AE_DEADBAND       4      // 目標亮度 ± 容許誤差
+#define AE_MAX_STEP_Q8    1024   // 每幀最大倍率 4x (Q8)
+#define AE_MIN_STEP_Q8    64     // 每幀最小倍率 1/4x (Q8)
+#define AE_SETTLE_FRAMES  1      // 改設定後跳過的幀數 (fb_count=2 時仍有舊幀)
+#define AWB_GAIN_MIN      128    // 0.5x (Q8)
+#define AWB_GAIN_MAX      512    // 2.0x (Q8)
+
+struct AutoExposure {
+    bool ae_enabled;
+    bool awb_enabled;
+    bool awb_in_sensor;      // 增益寫入感測器 (統計為套用增益後的像素)
+    uint8_t target_luma;     // 目標平均亮度 (0-255)
+    int aec_value;           // 目前曝光 (AE_AEC_MIN - AE_AEC_MAX)
+    int agc_gain;            // 目前增益 (0 - AE_AGC_MAX)
+    uint16_t gain_r;         // Q8
+    uint16_t gain_g;         // Q8
+    uint16_t gain_b;         // Q8
+    uint8_t settle;          // 剩餘跳過幀數
+    bool converged;          // 亮度已進入容許範圍
+    uint8_t last_luma;       // 最近一次量測到的平均亮度
+    ChannelGainLUT lut;      // 目前白平衡增益查表
+};
+
+// 把感測器切換成手動曝光/增益並寫入目前的值 (感測器重新初始化後也要呼叫)
+void ae_apply_sensor(AutoExposure* ae, sensor_t* s) {
+    if (s == nullptr) return;
+    s->set_exposure_ctrl(s, 0);
+    s->set_gain_ctrl(s, 0);
+    s->set_whitebal(s, 0);
+    s->set_aec_value(s, ae->aec_value);
+    s->set_agc_gain(s, ae->agc_gain);
+    ae->settle = AE_SETTLE_FRAMES;
+}
+
+// 初始化控制器狀態, 之後由 ae_update 驅動
+void ae_init(AutoExposure* ae, sensor_t* s, uint8_t target_luma) {
+    ae->ae_enabled = true;
+    ae->awb_enabled = true;
+    ae->awb_in_sensor = false;
+    ae->target_luma = target_luma;
+    ae->aec_value = 300;
+    ae->agc_gain = 0;
+    ae->gain_r = ae->gain_g = ae->gain_b = 256;
+    ae->settle = AE_SETTLE_FRAMES;
+    ae->converged = false;
+    ae->last_luma = 0;
+    build_channel_gain_lut(&ae->lut, 256, 256, 256);
+    ae_apply_sensor(ae, s);
+}
+
+// 總曝光量拆回曝光時間與增益
+static void ae_apply_exposure(AutoExposure* ae, sensor_t* s, uint32_t exposure) {
+    uint32_t max_exposure = (uint32_t)AE_AEC_MAX * (AE_AGC_MAX + 1);
+    exposure = constrain(exposure, (uint32_t)AE_AEC_MIN, max_exposure);
+
+    int agc = 0;
+    if (exposure > AE_AEC_MAX) {
+        agc = (exposure + AE_AEC_MAX - 1) / AE_AEC_MAX - 1;
+    }
+    int aec = exposure / (agc + 1);
+
+    if (aec != ae->aec_value) {
+        s->set_aec_value(s, aec);
+        ae->aec_value = aec;
+        ae->settle = AE_SETTLE_FRAMES;
+    }
+    if (agc != ae->agc_gain) {
+        s->set_agc_gain(s, agc);
+        ae->agc_gain = agc;
+        ae->settle = AE_SETTLE_FRAMES;
+    }
+}
+
+// 每幀呼叫一次; 回傳 true 表示白平衡增益有更新
+// (awb_in_sensor 時由呼叫端把 gain_r/g/b 寫入感測器, 否則已更新 lut)
+bool ae_update(AutoExposure* ae, sensor_t* s, const FrameStats* stats) {
+    if (stats->count == 0 || s == nullptr) return false;
+    if (ae->settle > 0) {
+        ae->settle--;
+        return false;
+    }
+
+    // ---------- AE ----------
+    uint32_t mean = stats->sum_y / stats->count;
+    ae->last_luma = mean;
+    int err = (int)ae->target_luma - (int)mean;
+    ae->converged = abs(err) <= AE_DEADBAND;
+    if (ae->ae_enabled && !ae->converged) {
+        // 比例控制: 倍率 = target / mean, 取 3/4 的步長避免振盪
+        uint32_t ratio_q8 = ((uint32_t)ae->target_luma << 8) / max<uint32_t>(mean, 1);
+        ratio_q8 = constrain(ratio_q8, (uint32_t)AE_MIN_STEP_Q8, (uint32_t)AE_MAX_STEP_Q8);
+        int32_t step_q8 = 256 + (((int32_t)ratio_q8 - 256) * 3) / 4;
+        uint32_t exposure = (uint32_t)ae->aec_value * (ae->agc_gain + 1);
+        uint32_t next = ((uint64_t)exposure * step_q8 + 128) >> 8;
+        if (next == exposure) next += (err > 0) ? 1 : -1;
+        ae_apply_exposure(ae, s, next);
+    }
+
+    // ---------- AWB ----------
+    if (!ae->awb_enabled) return false;
+    uint32_t sum_r = max<uint32_t>(stats->sum_r, 1);
+    uint32_t sum_b = max<uint32_t>(stats->sum_b, 1);
+    uint64_t want_r = ((uint64_t)stats->sum_g << 8) / sum_r;
+    uint64_t want_b = ((uint64_t)stats->sum_g << 8) / sum_b;
+    if (ae->awb_in_sensor) {
+        // 統計已含目前增益, 修正量要乘回去
+        want_r = (want_r * ae->gain_r) >> 8;
+        want_b = (want_b * ae->gain_b) >> 8;
+    }
+    want_r = constrain(want_r, (uint64_t)AWB_GAIN_MIN, (uint64_t)AWB_GAIN_MAX);
+    want_b = constrain(want_b, (uint64_t)AWB_GAIN_MIN, (uint64_t)AWB_GAIN_MAX);
+    // 以一半步長趨近目標
+    uint16_t gain_r = (ae->gain_r + want_r + 1) / 2;
+    uint16_t gain_b = (ae->gain_b + want_b + 1) / 2;
+    if (gain_r == ae->gain_r && gain_b == ae->gain_b) return false;
+
+    ae->gain_r = gain_r;
+    ae->gain_b = gain_b;
+    if (!ae->awb_in_sensor) {
+        build_channel_gain_lut(&ae->lut, ae->gain_r, ae->gain_g, ae->gain_b);
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef __BLOB_TRACKER_H
+#define __BLOB_TRACKER_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "esp_heap_caps.h"
+#include "img_computing.h"
+
+// ==================== 色塊追蹤 ====================
+// 1. 顏色處理迴圈中順便建立色調遮罩 (HueMask, 見 img_computing.h)
+// 2. 單次掃描連通元件標記: 每行抽出連續段 (run), 與上一行重疊的段以 union-find 合併,
+//    面積 / 座標和 / 外框在掃描時就累加到根節點, 不需要第二次掃描或標籤影像
+// 3. 依面積排序, 輸出前 BLOB_MAX 個色塊的重心、外框與面積
+
+#define BLOB_MAX          8       // 每幀輸出的色塊數
+#define BLOB_MAX_LABELS   1024    // 每幀最多標籤數 (超過的連續段忽略)
+
+struct Blob {
+    uint16_t x0, y0, x1, y1;    // 外框 (含)
+    uint16_t cx, cy;            // 重心
+    uint32_t area;              // 像素數
+};
+
+struct BlobRun {
+    uint16_t x0, x1;            // [x0, x1]
+    uint16_t label;
+};
+
+struct BlobLabel {
+    uint16_t parent;
+    uint16_t x0, y0, x1, y1;
+    uint32_t area;
+    uint32_t sum_x;
+    uint32_t sum_y;
+};
+
+struct BlobTracker {
+    HueMask mask;
+    uint32_t mask_words;        // bits 可容納的 uint32 數
+    BlobRun* runs;              // 上一行與目前這一行的連續段, 各 run_capacity 個
+    uint16_t run_capacity;
+    BlobLabel* labels;
+    uint16_t label_count;
+    bool overflow;              // 標籤用完
+    uint32_t min_area;          // 小於此面積的色塊忽略
+    Blob blobs[BLOB_MAX];
+    uint8_t blob_count;
+    int64_t last_cost_us;       // 最近一次標記耗時
+    bool enabled;
+    bool overlay;               // 在 TFT 上畫外框
+};
+
+// 追蹤目標沿用 ColorAdjustment 的 target_hue / range
+void blob_tracker_init(BlobTracker* bt, const ColorAdjustment* target, uint8_t min_sat, uint8_t min_val, uint32_t min_area) {
+    memset(bt, 0, sizeof(BlobTracker));
+    bt->mask.target_hue = target->target_hue;
+    bt->mask.range = target->range;
+    bt->mask.min_sat = min_sat;
+    bt->mask.min_val = min_val;
+    bt->min_area = min_area;
+    bt->enabled = true;
+    bt->overlay = true;
+}
+
+// 依目前影像尺寸準備遮罩與工作區; 失敗時回傳 false (這一幀不追蹤)
+bool blob_tracker_prepare(BlobTracker* bt, uint16_t width, uint16_t height) {
+    if (bt->labels == nullptr) {
+        bt->labels = (BlobLabel*)heap_caps_malloc(BLOB_MAX_LABELS * sizeof(BlobLabel), MALLOC_CAP_8BIT);
+        if (bt->labels == nullptr) return false;
+    }
+    uint16_t stride = (width + 31) / 32;
+    uint32_t words = (uint32_t)stride * height;
+    if (words > bt->mask_words) {
+        heap_caps_free(bt->mask.bits);
+        bt->mask.bits = (uint32_t*)heap_caps_malloc(words * sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (bt->mask.bits == nullptr) {
+            bt->mask.bits = (uint32_t*)heap_caps_malloc(words * sizeof(uint32_t), MALLOC_CAP_8BIT);
+        }
+        bt->mask_words = bt->mask.bits ? words : 0;
+        if (bt->mask.bits == nullptr) return false;
+    }
+    // 一行最多 (width + 1) / 2 個連續段
+    uint16_t runs = (width + 1) / 2;
+    if (runs > bt->run_capacity) {
+        heap_caps_free(bt->runs);
+        bt->runs = (BlobRun*)heap_caps_malloc(2 * runs * sizeof(BlobRun), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        bt->run_capacity = bt->runs ? runs : 0;
+        if (bt->runs == nullptr) return false;
+    }
+    bt->mask.width = width;
+    bt->mask.height = height;
+    bt->mask.stride = stride;
+    return true;
+}
+
+static uint16_t blob_find(BlobLabel* labels, uint16_t l) {
+    while (labels[l].parent != l) {
+        labels[l].parent = labels[labels[l].parent].parent;   // 路徑減半
+        l = labels[l].parent;
+    }
+    return l;
+}
+
+// 合併兩棵樹並把統計量併到新的根
+static uint16_t blob_union(BlobLabel* labels, uint16_t a, uint16_t b) {
+    a = blob_find(labels, a);
+    b = blob_find(labels, b);
+    if (a == b) return a;
+    if (b < a) {
+        uint16_t t = a;
+        a = b;
+        b = t;
+    }
+    BlobLabel* ra = &labels[a];
+    BlobLabel* rb = &labels[b];
+    rb->parent = a;
+    ra->area += rb->area;
+    ra->sum_x += rb->sum_x;
+    ra->sum_y += rb->sum_y;
+    ra->x0 = min(ra->x0, rb->x0);
+    ra->y0 = min(ra->y0, rb->y0);
+    ra->x1 = max(ra->x1, rb->x1);
+    ra->y1 = max(ra->y1, rb->y1);
+    return a;
+}
+
+// 抽出一行的連續段, 回傳段數
+static uint16_t blob_extract_runs(const uint32_t* row, uint16_t width, uint16_t stride, BlobRun* runs) {
+    uint16_t n = 0;
+    int32_t start = -1;
+    for (uint16_t w = 0; w < stride; w++) {
+        uint32_t bits = row[w];
+        // 整個 word 都不變時直接跳過
+        if (start < 0 && bits == 0) continue;
+        if (start >= 0 && bits == 0xFFFFFFFF) continue;
+        for (uint8_t b = 0; b < 32; b++) {
+            uint16_t x = w * 32 + b;
+            if (x >= width) break;
+            bool on = (bits >> b) & 1;
+            if (on && start < 0) {
+                start = x;
+            } else if (!on && start >= 0) {
+                runs[n].x0 = start;
+                runs[n].x1 = x - 1;
+                n++;
+                start = -1;
+            }
+        }
+    }
+    if (start >= 0) {
+        runs[n].x0 = start;
+        runs[n].x1 = width - 1;
+        n++;
+    }
+    return n;
+}
+
+// 對目前的遮罩做標記並更新 bt->blobs
+void blob_tracker_label(BlobTracker* bt) {
+    int64_t start = esp_timer_get_time();
+    const HueMask* mask = &bt->mask;
+    BlobLabel* labels = bt->labels;
+    BlobRun* prev = bt->runs;
+    BlobRun* cur = bt->runs + bt->run_capacity;
+    uint16_t prev_count = 0;
+    bt->label_count = 0;
+    bt->overflow = false;
+
+    for (uint16_t y = 0; y < mask->height; y++) {
+        uint16_t cur_count = blob_extract_runs(mask->bits + (size_t)y * mask->stride, mask->width, mask->stride, cur);
+        uint16_t j = 0;
+        for (uint16_t i = 0; i < cur_count; i++) {
+            BlobRun* r = &cur[i];
+            // 8 連通: 上一行的段與 [x0 - 1, x1 + 1] 重疊即相連
+            while (j < prev_count && prev[j].x1 + 1 < r->x0) j++;
+            uint16_t label = 0xFFFF;
+            for (uint16_t k = j; k < prev_count && prev[k].x0 <= r->x1 + 1; k++) {
+                if (prev[k].label == 0xFFFF) continue;
+                label = label == 0xFFFF ? blob_find(labels, prev[k].label) : blob_union(labels, label, prev[k].label);
+            }
+            if (label == 0xFFFF) {
+                if (bt->label_count >= BLOB_MAX_LABELS) {
+                    bt->overflow = true;
+                    r->label = 0xFFFF;
+                    continue;
+                }
+                label = bt->label_count++;
+                BlobLabel* nl = &labels[label];
+                nl->parent = label;
+                nl->x0 = r->x0;
+                nl->x1 = r->x1;
+                nl->y0 = nl->y1 = y;
+                nl->area = nl->sum_x = nl->sum_y = 0;
+            }
+            r->label = label;
+            BlobLabel* root = &labels[label];
+            uint32_t len = r->x1 - r->x0 + 1;
+            root->area += len;
+            root->sum_x += (uint32_t)(r->x0 + r->x1) * len / 2;
+            root->sum_y += (uint32_t)y * len;
+            root->x0 = min(root->x0, r->x0);
+            root->x1 = max(root->x1, r->x1);
+            root->y1 = y;
+        }
+        BlobRun* t = prev;
+        prev = cur;
+        cur = t;
+        prev_count = cur_count;
+    }
+
+    // 取面積最大的 BLOB_MAX 個根 (插入排序)
+    bt->blob_count = 0;
+    for (uint16_t l = 0; l < bt->label_count; l++) {
+        const BlobLabel* lb = &labels[l];
+        if (lb->parent != l || lb->area < bt->min_area) continue;
+        uint8_t pos = bt->blob_count;
+        while (pos > 0 && bt->blobs[pos - 1].area < lb->area) {
+            if (pos < BLOB_MAX) bt->blobs[pos] = bt->blobs[pos - 1];
+            pos--;
+        }
+        if (pos >= BLOB_MAX) continue;
+        Blob* b = &bt->blobs[pos];
+        b->x0 = lb->x0;
+        b->y0 = lb->y0;
+        b->x1 = lb->x1;
+        b->y1 = lb->y1;
+        b->area = lb->area;
+        b->cx = lb->sum_x / lb->area;
+        b->cy = lb->sum_y / lb->area;
+        if (bt->blob_count < BLOB_MAX) bt->blob_count++;
+    }
+    bt->last_cost_us = esp_timer_get_time() - start;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef __BOOT_SEQUENCE_H
+#define __BOOT_SEQUENCE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+// ==================== 開機流程編排 ====================
+// SD (SDMMC)、相機 (SCCB + LCD_CAM DMA) 與 TFT (SPI) 使用不同的周邊,
+// 初始化大多在等待硬體延遲, 因此可以並行:
+//   - SD 與 TFT 在核心 0 的任務中初始化
+//   - 相機在 setup() 所在的任務中初始化
+// 每個階段記錄起訖時間 (esp_timer, 從開機起算), 目錄列表延後到第一幀顯示之後。
+
+enum BootPhase {
+    BOOT_SETUP = 0,      // setup() 整體
+    BOOT_SD,
+    BOOT_CAMERA,
+    BOOT_TFT,
+    BOOT_FIRST_FRAME,    // setup() 結束到第一幀顯示
+    BOOT_DIR_LIST,       // 延後的目錄列表
+    BOOT_NETWORK,        // 延後的 WiFi 連線與 HTTP 伺服器
+    BOOT_PHASE_COUNT
+};
+
+struct BootPhaseRecord {
+    int64_t start_us;
+    int64_t end_us;
+    bool ok;
+};
+
+struct BootTimeline {
+    BootPhaseRecord phases[BOOT_PHASE_COUNT];
+    int64_t first_frame_us;    // 開機到第一幀顯示
+};
+
+typedef bool (*BootStepFn)(void);
+
+struct BootTask {
+    BootTimeline* timeline;
+    BootPhase phase;
+    BootStepFn fn;
+    SemaphoreHandle_t done;    // nullptr = 背景任務, 不需等待
+};
+
+static const char* const boot_phase_names[BOOT_PHASE_COUNT] = {
+    "setup", "sd", "camera", "tft", "first_frame", "dir_list", "network"
+};
+
+__attribute__((always_inline)) inline void boot_phase_begin(BootTimeline* tl, BootPhase phase) {
+    tl->phases[phase].start_us = esp_timer_get_time();
+}
+
+__attribute__((always_inline)) inline void boot_phase_end(BootTimeline* tl, BootPhase phase, bool ok) {
+    tl->phases[phase].end_us = esp_timer_get_time();
+    tl->phases[phase].ok = ok;
+}
+
+// 在目前任務中執行一個階段
+bool boot_run_phase(BootTimeline* tl, BootPhase phase, BootStepFn fn) {
+    boot_phase_begin(tl, phase);
+    bool ok = fn();
+    boot_phase_end(tl, phase, ok);
+    return ok;
+}
+
+static void boot_task_func(void* p) {
+    BootTask* task = (BootTask*)p;
+    boot_run_phase(task->timeline, task->phase, task->fn);
+    if (task->done) {
+        xSemaphoreGive(task->done);
+    } else {
+        delete task;
+    }
+    vTaskDelete(NULL);
+}
+
+// 在另一個任務中執行階段; 回傳的 BootTask 交給 boot_wait_phase 等待
+BootTask* boot_start_phase(BootTimeline* tl, BootPhase phase, BootStepFn fn, BaseType_t core) {
+    BootTask* task = new BootTask();
+    task->timeline = tl;
+    task->phase = phase;
+    task->fn = fn;
+    task->done = xSemaphoreCreateBinary();
+    if (task->done == nullptr || xTaskCreatePinnedToCore(boot_task_func, boot_phase_names[phase], 4096, task, 2, nullptr, core) != pdPASS) {
+        // 無法建立任務時就地執行
+        if (task->done) vSemaphoreDelete(task->done);
+        task->done = nullptr;
+        boot_run_phase(tl, phase, fn);
+    }
+    return task;
+}
+
+bool boot_wait_phase(BootTask* task) {
+    if (task->done) {
+        xSemaphoreTake(task->done, portMAX_DELAY);
+        vSemaphoreDelete(task->done);
+    }
+    bool ok = task->timeline->phases[task->phase].ok;
+    delete task;
+    return ok;
+}
+
+// 不在關鍵路徑上的工作: 低優先權背景任務, 不等待
+void boot_defer_phase(BootTimeline* tl, BootPhase phase, BootStepFn fn, BaseType_t core) {
+    BootTask* task = new BootTask();
+    task->timeline = tl;
+    task->phase = phase;
+    task->fn = fn;
+    task->done = nullptr;
+    if (xTaskCreatePinnedToCore(boot_task_func, boot_phase_names[phase], 4096, task, 0, nullptr, core) != pdPASS) {
+        delete task;
+        boot_run_phase(tl, phase, fn);
+    }
+}
+
+void boot_print_timeline(const BootTimeline* tl) {
+    Serial.println("Boot timeline (us since reset):");
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        const BootPhaseRecord* p = &tl->phases[i];
+        if (p->start_us == 0 && p->end_us == 0) continue;
+        Serial.printf("  %-12s %8lld -> %8lld  (%7lld us) %s\n", boot_phase_names[i],
+                      (long long)p->start_us, (long long)p->end_us, (long long)(p->end_us - p->start_us), p->ok ? "ok" : "FAILED");
+    }
+    if (tl->first_frame_us) {
+        Serial.printf("  reset -> first displayed frame: %lld us\n", (long long)tl->first_frame_us);
+    }
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef __CAMERA_MODE_H
+#define __CAMERA_MODE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "img_converters.h"
+#include <esp_timer.h>
+#include "hal.h"
+#include "yuv_pipeline.h"
+
+// ==================== 執行期切換解析度 / 像素格式 ====================
+// 不重開機切換 frame_size / pixel_format / fb_count:
+//   - JPEG 只縮小解析度且格式不變: 直接 set_framesize (快速路徑)
+//   - 其他情況: esp_camera_deinit → esp_camera_init, 失敗時回復原模式
+//     (RGB565/YUV422 的 fb_size 與 DMA 在 init 時就固定, 縮小後 cam_hal 會以 FB-SIZE 丟掉每一幀)
+//   - 連原模式都無法回復時設 lost, 由 loop() 定期呼叫 camera_mode_recover
+// 處理緩衝區 (RGB565) 隨新尺寸重新配置, 下游運算一律使用 width/height。
+// YUV422 在載入時就轉成 RGB565 (可順便做色度變換), 緩衝區大小與 RGB565 相同。
+
+#define DISPLAY_WIDTH                 320
+#define DISPLAY_HEIGHT                240
+#define CAMERA_MODE_SWITCH_TARGET_US  500000   // 切換延遲目標 (含第一幀)
+
+struct CameraMode {
+    framesize_t frame_size;
+    pixformat_t pixel_format;   // PIXFORMAT_RGB565, PIXFORMAT_YUV422 或 PIXFORMAT_JPEG
+    uint8_t fb_count;
+};
+
+struct CameraModeManager {
+    CameraSource* camera;         // 相機驅動 (HAL)
+    camera_config_t config;       // 目前生效的驅動設定
+    CameraMode mode;
+    framesize_t alloc_frame_size; // 驅動的 fb 是依此尺寸配置的
+    jpg_scale_t jpeg_scale;       // JPEG 解碼縮放
+    uint16_t width;               // 處理緩衝區寬 (JPEG 為解碼後尺寸)
+    uint16_t height;              // 處理緩衝區高
+    uint16_t* buffer;             // 處理緩衝區 (RGB565, 感測器位元組順序)
+    size_t buffer_pixels;
+    uint16_t* display_buffer;     // 縮小到螢幕尺寸用
+    void (*configure_sensor)(sensor_t*); // 重新初始化後重設感測器參數
+    int64_t last_switch_us;       // 最近一次切換耗時
+    bool lost;                    // 驅動未初始化 (切換後連原模式都無法回復)
+};
+
+static void* camera_mode_malloc(size_t size) {
+    void* p = psramFound() ? ps_malloc(size) : nullptr;
+    return p ? p : malloc(size);
+}
+
+// JPEG 解碼時選擇能放進螢幕寬度的最小縮放
+static jpg_scale_t camera_mode_jpeg_scale(uint16_t width) {
+    if (width <= DISPLAY_WIDTH) return JPG_SCALE_NONE;
+    if ((width >> 1) <= DISPLAY_WIDTH) return JPG_SCALE_2X;
+    if ((width >> 2) <= DISPLAY_WIDTH) return JPG_SCALE_4X;
+    return JPG_SCALE_8X;
+}
+
+// 依目前模式重新配置處理緩衝區; 新緩衝區配置成功才釋放舊的, 失敗時尺寸與緩衝區都維持原狀
+static bool camera_mode_alloc(CameraModeManager* mgr) {
+    uint16_t w = resolution[mgr->mode.frame_size].width;
+    uint16_t h = resolution[mgr->mode.frame_size].height;
+    jpg_scale_t scale = JPG_SCALE_NONE;
+    if (mgr->mode.pixel_format == PIXFORMAT_JPEG) {
+        scale = camera_mode_jpeg_scale(w);
+        w >>= scale;
+        h >>= scale;
+    }
+
+    size_t pixels = (size_t)w * h;
+    if (pixels != mgr->buffer_pixels || mgr->buffer == nullptr) {
+        uint16_t* buffer = (uint16_t*)camera_mode_malloc(pixels * sizeof(uint16_t));
+        if (buffer == nullptr) {
+            Serial.printf("Frame buffer alloc failed: %ux%u\n", w, h);
+            return false;
+        }
+        free(mgr->buffer);
+        mgr->buffer = buffer;
+        mgr->buffer_pixels = pixels;
+    }
+    mgr->jpeg_scale = scale;
+    mgr->width = w;
+    mgr->height = h;
+    if ((w > DISPLAY_WIDTH || h > DISPLAY_HEIGHT) && mgr->display_buffer == nullptr) {
+        mgr->display_buffer = (uint16_t*)camera_mode_malloc(DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof(uint16_t));
+    }
+    return true;
+}
+
+static esp_err_t camera_mode_init_driver(CameraModeManager* mgr) {
+    mgr->config.frame_size = mgr->mode.frame_size;
+    mgr->config.pixel_format = mgr->mode.pixel_format;
+    mgr->config.fb_count = psramFound() ? mgr->mode.fb_count : 1;
+    esp_err_t err = mgr->camera->init(&mgr->config);
+    if (err != ESP_OK) return err;
+    mgr->alloc_frame_size = mgr->mode.frame_size;
+    if (mgr->configure_sensor && mgr->camera->sensor()) mgr->configure_sensor(mgr->camera->sensor());
+    return ESP_OK;
+}
+
+esp_err_t camera_mode_begin(CameraModeManager* mgr, CameraSource* camera, const camera_config_t* config, void (*configure_sensor)(sensor_t*)) {
+    mgr->camera = camera;
+    mgr->config = *config;
+    mgr->mode.frame_size = config->frame_size;
+    mgr->mode.pixel_format = config->pixel_format;
+    mgr->mode.fb_count = config->fb_count;
+    mgr->buffer = nullptr;
+    mgr->buffer_pixels = 0;
+    mgr->display_buffer = nullptr;
+    mgr->configure_sensor = configure_sensor;
+    mgr->last_switch_us = 0;
+    mgr->lost = false;
+
+    esp_err_t err = camera_mode_init_driver(mgr);
+    if (err != ESP_OK) return err;
+    return camera_mode_alloc(mgr) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+// 以 previous 重新初始化驅動, 重試一次; 仍失敗時設 lost
+static esp_err_t camera_mode_restore(CameraModeManager* mgr, const CameraMode* previous) {
+    mgr->mode = *previous;
+    esp_err_t err = ESP_FAIL;
+    for (uint8_t attempt = 0; attempt < 2 && err != ESP_OK; attempt++) {
+        mgr->camera->deinit();
+        err = camera_mode_init_driver(mgr);
+        if (err != ESP_OK) Serial.printf("Restoring previous mode failed: 0x%x\n", err);
+    }
+    mgr->lost = err != ESP_OK;
+    if (mgr->lost) Serial.println("Camera lost: driver not initialised");
+    return err;
+}
+
+// 驅動遺失時由 loop() 呼叫; 以目前模式重新初始化, 成功回傳 true
+bool camera_mode_recover(CameraModeManager* mgr) {
+    mgr->camera->deinit();
+    esp_err_t err = camera_mode_init_driver(mgr);
+    mgr->lost = err != ESP_OK || !camera_mode_alloc(mgr);
+    if (!mgr->lost) Serial.println("Camera recovered");
+    return !mgr->lost;
+}
+
+// 呼叫前必須已歸還所有 camera_fb_t
+esp_err_t camera_mode_switch(CameraModeManager* mgr, const CameraMode* mode) {
+    if (mode->frame_size == mgr->mode.frame_size && mode->pixel_format == mgr->mode.pixel_format &&
+        mode->fb_count == mgr->mode.fb_count) {
+        return ESP_OK;
+    }
+    int64_t start = esp_timer_get_time();
+    CameraMode previous = mgr->mode;
+    mgr->mode = *mode;
+
+    bool fits = resolution[mode->frame_size].width <= resolution[mgr->alloc_frame_size].width &&
+                resolution[mode->frame_size].height <= resolution[mgr->alloc_frame_size].height;
+    esp_err_t err = ESP_FAIL;
+    bool fast = false;
+    sensor_t* s = mgr->camera->sensor();
+    if (fits && mode->pixel_format == PIXFORMAT_JPEG && previous.pixel_format == PIXFORMAT_JPEG &&
+        mode->fb_count == previous.fb_count && s != nullptr) {
+        // 快速路徑: JPEG fb 已夠大, 只需改感測器輸出尺寸
+        err = s->set_framesize(s, mode->frame_size) == 0 ? ESP_OK : ESP_FAIL;
+        if (err == ESP_OK) mgr->config.frame_size = mode->frame_size;
+        fast = err == ESP_OK;
+    }
+    if (err != ESP_OK) {
+        mgr->camera->deinit();
+        err = camera_mode_init_driver(mgr);
+        if (err != ESP_OK) {
+            Serial.printf("Mode switch failed: 0x%x, restoring previous mode\n", err);
+            camera_mode_restore(mgr, &previous);
+        }
+    }
+    if (err == ESP_OK && !camera_mode_alloc(mgr)) {
+        // 處理緩衝區配置失敗: 回到原模式, 舊緩衝區仍然有效
+        Serial.println("Mode switch: no memory, restoring previous mode");
+        err = ESP_ERR_NO_MEM;
+        if (fast && s->set_framesize(s, previous.frame_size) == 0) {
+            mgr->mode = previous;
+            mgr->config.frame_size = previous.frame_size;
+        } else {
+            camera_mode_restore(mgr, &previous);
+        }
+        camera_mode_alloc(mgr);
+    }
+
+    // 丟棄第一幀 (舊設定下曝光的資料), 延遲量到新模式第一幀為止
+    if (!mgr->lost) {
+        camera_fb_t* fb = mgr->camera->grab();
+        if (fb) mgr->camera->release(fb);
+    }
+
+    mgr->last_switch_us = esp_timer_get_time() - start;
+    Serial.printf("Mode switch to %ux%u fmt %d: %lld us%s\n", mgr->width, mgr->height, mgr->mode.pixel_format,
+                  (long long)mgr->last_switch_us, mgr->last_switch_us > CAMERA_MODE_SWITCH_TARGET_US ? " (over target)" : "");
+    return err;
+}
+
+// 把 fb 內容複製/解碼/轉換到處理緩衝區; 結果為感測器位元組順序 (大端序) 的 RGB565
+// chroma 只對 YUV422 有效 (nullptr = 單純轉換)
+bool camera_mode_load_frame(CameraModeManager* mgr, camera_fb_t* fb, const ChromaTransform* chroma = nullptr) {
+    if (fb->format == PIXFORMAT_JPEG) {
+        return jpg2rgb565(fb->buf, fb->len, (uint8_t*)mgr->buffer, mgr->jpeg_scale);
+    }
+    if (fb->width != mgr->width || fb->height != mgr->height) return false;
+    if (fb->format == PIXFORMAT_YUV422) {
+        if (fb->len < mgr->buffer_pixels * 2) return false;
+        yuv422_to_rgb565_parallel(fb->buf, mgr->buffer, mgr->buffer_pixels, chroma);
+        return true;
+    }
+    memcpy(mgr->buffer, fb->buf, mgr->buffer_pixels * sizeof(uint16_t));
+    return true;
+}
+
+// 縮小到螢幕的整數抽樣倍率 (1 = 原尺寸)
+uint16_t camera_mode_display_step(const CameraModeManager* mgr) {
+    return max((mgr->width + DISPLAY_WIDTH - 1) / DISPLAY_WIDTH, (mgr->height + DISPLAY_HEIGHT - 1) / DISPLAY_HEIGHT);
+}
+
+// 回傳要推送到螢幕的影像; 大於螢幕時以整數倍抽樣縮小 (無縮圖緩衝區時回傳 nullptr)
+const uint16_t* camera_mode_fit_display(CameraModeManager* mgr, const uint16_t* src, uint16_t* out_w, uint16_t* out_h) {
+    if (mgr->width <= DISPLAY_WIDTH && mgr->height <= DISPLAY_HEIGHT) {
+        *out_w = mgr->width;
+        *out_h = mgr->height;
+        return src;
+    }
+    if (mgr->display_buffer == nullptr) return nullptr;
+    uint16_t step = camera_mode_display_step(mgr);
+    uint16_t w = mgr->width / step;
+    uint16_t h = mgr->height / step;
+    uint16_t* dst = mgr->display_buffer;
+    for (uint16_t y = 0; y < h; y++) {
+        const uint16_t* row = src + (size_t)y * step * mgr->width;
+        for (uint16_t x = 0; x < w; x++) {
+            *dst++ = row[x * step];
+        }
+    }
+    *out_w = w;
+    *out_h = h;
+    return mgr->display_buffer;
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef __CAPTURE_MANIFEST_H
+#define __CAPTURE_MANIFEST_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "FS.h"
+
+// ==================== 拍照清單 / 重複影像略過 ====================
+// 每張要存的影像算一個 64 位元 dHash: 把畫面分成 9x8 格取平均亮度 (整張影像都算進去, 比取樣點穩定),
+// 每列相鄰兩格比較 (左 > 右 為 1), 8 列 x 8 個比較 = 64 位元。
+// 自動拍照 (移動偵測、縮時) 與上一張存下的 hash 相差 (漢明距離) 不到門檻就不存。
+// 清單是 SD 卡上的 CSV, 每存一張加一行:
+//   index,file,time_ms,dhash,distance
+// 只和上一張比, 上一張的 hash 留在記憶體, 開機時只讀清單最後一行 (同時接續編號), 檢查是 O(1)。
+
+#define MANIFEST_HEADER     "index,file,time_ms,dhash,distance\n"
+#define MANIFEST_TAIL_BYTES 160          // 開機時從檔尾讀回的長度 (至少一整行)
+
+struct CaptureManifest {
+    uint64_t last_hash;                  // 上一張存下的影像
+    bool has_last;
+    uint32_t next_index;                 // 清單最後一張的編號 + 1
+    uint8_t threshold;                   // 距離 < threshold 視為重複; 0 = 全部存
+    uint32_t saved;
+    uint32_t skipped;
+    int64_t hash_us;                     // 最近一次 dHash 耗時
+};
+
+// ---------- dHash ----------
+
+// 近似 BT.601 亮度 (0-255), 直接由 5/6/5 位元分量計算
+__attribute__((always_inline)) inline uint32_t manifest_luma(uint16_t rgb, bool byte_swapped) {
+    if (byte_swapped) rgb = __builtin_bswap16(rgb);
+    return ((rgb >> 11) * 616 + ((rgb >> 5) & 0x3F) * 600 + (rgb & 0x1F) * 232) >> 8;
+}
+
+uint64_t capture_dhash(const uint16_t* buffer, uint16_t width, uint16_t height, bool byte_swapped) {
+    if (buffer == nullptr || width < 9 || height < 8) return 0;
+    uint32_t sum[8][9] = { { 0 } };
+    uint16_t edge[10];                   // 第 gx 格的欄範圍 [edge[gx], edge[gx + 1])
+    for (uint8_t gx = 0; gx <= 9; gx++) edge[gx] = (uint32_t)gx * width / 9;
+    for (uint16_t y = 0; y < height; y++) {
+        const uint16_t* row = buffer + (size_t)y * width;
+        uint32_t* cells = sum[(uint32_t)y * 8 / height];
+        for (uint8_t gx = 0; gx < 9; gx++) {
+            uint32_t s = 0;
+            for (uint16_t x = edge[gx]; x < edge[gx + 1]; x++) s += manifest_luma(row[x], byte_swapped);
+            cells[gx] += s;
+        }
+    }
+    uint64_t hash = 0;
+    for (uint8_t gy = 0; gy < 8; gy++) {
+        for (uint8_t gx = 0; gx < 8; gx++) {
+            // 比較平均值: 同一列的格子行數相同, 寬度可能差一欄, 交叉相乘
+            uint64_t left = (uint64_t)sum[gy][gx] * (edge[gx + 2] - edge[gx + 1]);
+            uint64_t right = (uint64_t)sum[gy][gx + 1] * (edge[gx + 1] - edge[gx]);
+            if (left > right) hash |= 1ULL << (gy * 8 + gx);
+        }
+    }
+    return hash;
+}
+
+__attribute__((always_inline)) inline uint8_t capture_hash_distance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+// ---------- 清單 ----------
+
+void manifest_init(CaptureManifest* m, uint8_t threshold) {
+    memset(m, 0, sizeof(CaptureManifest));
+    m->threshold = threshold;
+}
+
+// 讀清單最後一行, 取回上一張的 hash 與編號; 沒有清單回傳 false
+bool manifest_load(CaptureManifest* m, fs::FS &fs, const char* path) {
+    File file = fs.open(path);
+    if (!file) return false;
+    size_t size = file.size();
+    size_t start = size > MANIFEST_TAIL_BYTES ? size - MANIFEST_TAIL_BYTES : 0;
+    char tail[MANIFEST_TAIL_BYTES + 1];
+    file.seek(start);
+    size_t len = file.read((uint8_t*)tail, size - start);
+    file.close();
+    tail[len] = '\0';
+    // 最後一個完整行
+    while (len && (tail[len - 1] == '\n' || tail[len - 1] == '\r')) tail[--len] = '\0';
+    char* line = strrchr(tail, '\n');
+    line = line ? line + 1 : tail;
+    unsigned index;
+    unsigned long long hash;
+    if (sscanf(line, "%u,%*[^,],%*u,%llx", &index, &hash) != 2) return false;   // 只有標題行
+    m->last_hash = hash;
+    m->has_last = true;
+    m->next_index = index + 1;
+    return true;
+}
+
+// 算 hash; 回傳是否與上一張存下的重複 (*distance 為漢明距離, 沒有上一張時為 64)
+bool manifest_check(CaptureManifest* m, const uint16_t* buffer, uint16_t width, uint16_t height, bool byte_swapped,
+                    uint64_t* hash, uint8_t* distance) {
+    int64_t start = esp_timer_get_time();
+    *hash = capture_dhash(buffer, width, height, byte_swapped);
+    m->hash_us = esp_timer_get_time() - start;
+    *distance = m->has_last ? capture_hash_distance(*hash, m->last_hash) : 64;
+    return m->has_last && *distance < m->threshold;
+}
+
+// 存檔後加一行; 新檔先寫標題
+bool manifest_append(CaptureManifest* m, fs::FS &fs, const char* path, uint32_t index, const char* file_path,
+                     uint64_t hash, uint8_t distance) {
+    m->last_hash = hash;
+    m->has_last = true;
+    m->next_index = index + 1;
+    m->saved++;
+    File file = fs.open(path, FILE_APPEND);
+    if (!file) return false;
+    char line[128];
+    int len = 0;
+    if (file.size() == 0) len = snprintf(line, sizeof(line), MANIFEST_HEADER);
+    len += snprintf(line + len, sizeof(line) - len, "%u,%s,%lu,%016llx,%u\n", (unsigned)index, file_path,
+                    (unsigned long)millis(), (unsigned long long)hash, distance);
+    bool ok = file.write((const uint8_t*)line, len) == (size_t)len;
+    file.close();
+    return ok;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef __CHECKSUM_H
+#define __CHECKSUM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==================== CRC-32 (IEEE 802.3, 與 zlib/PNG 相同) ====================
+// 半位元組查表: 表格只有 16 個項目, 每位元組兩次查表
+
+static const uint32_t crc32_nibble_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+// 以 crc = 0 開始, 可分段呼叫
+inline uint32_t crc32_update(uint32_t crc, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32_nibble_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32_nibble_table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// 位元組查表: 與 crc32_update 結果相同, 每位元組一次查表; 1 KB 表格在第一次使用時建好。
+// 大量資料用 (sd_read_write.cpp 的 PNG, 每張數十到數百 KB)
+inline uint32_t crc32_update_bulk(uint32_t crc, const void* data, size_t len) {
+    static uint32_t table[256];
+    static bool ready = false;
+    if (!ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            c = (c >> 4) ^ crc32_nibble_table[c & 0x0F];
+            c = (c >> 4) ^ crc32_nibble_table[c & 0x0F];
+            table[i] = c;
+        }
+        ready = true;
+    }
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) crc = (crc >> 8) ^ table[(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+// ==================== CRC-8 (多項式 0x07, 初值 0) ====================
+// 短訊息用 (remote_control.h 的封包), 逐位元計算不需要表格
+
+inline uint8_t crc8_update(uint8_t crc, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len--) {
+        crc ^= *p++;
+        for (uint8_t i = 0; i < 8; i++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+// ==================== SHA-1 ====================
+// 只用於 WebSocket 握手 (Sec-WebSocket-Accept), 一次處理整段輸入
+
+inline void sha1(const void* data, size_t len, uint8_t digest[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    const uint8_t* msg = (const uint8_t*)data;
+    uint64_t bits = (uint64_t)len * 8;
+    size_t total = ((len + 8) / 64 + 1) * 64;   // 補 0x80、0 與 64 位元長度後的總長
+    for (size_t off = 0; off < total; off += 64) {
+        uint32_t w[80];
+        for (uint8_t i = 0; i < 64; i++) {
+            size_t k = off + i;
+            uint8_t byte = k < len ? msg[k] : k == len ? 0x80 : k >= total - 8 ? (uint8_t)(bits >> (8 * (total - 1 - k))) : 0;
+            if (i % 4 == 0) w[i / 4] = 0;
+            w[i / 4] |= (uint32_t)byte << (24 - 8 * (i % 4));
+        }
+        for (uint8_t i = 16; i < 80; i++) {
+            uint32_t x = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+            w[i] = (x << 1) | (x >> 31);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (uint8_t i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            uint32_t t = ((a << 5) | (a >> 27)) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = (b << 30) | (b >> 2);
+            b = a;
+            a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (uint8_t i = 0; i < 20; i++) digest[i] = (uint8_t)(h[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+#endif
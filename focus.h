@@ -0,0 +1,191 @@
+#ifndef __FOCUS_H
+#define __FOCUS_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "esp_camera.h"
+
+// ==================== 對焦評分 / 爬山對焦 / 對焦峰值 ====================
+// 評分: 中央 ROI (寬高各 1/2) 上的 Tenengrad, 隔行隔列取樣, 全部整數運算;
+//       亮度用 2R + 2G + B 近似, 梯度平方和低於門檻的 (雜訊) 不計。
+// 對焦: 直接寫 OV5640 VCM 暫存器 (10 位元位置), 先大步爬山, 過頭就反向並減半步長,
+//       步長小於 FOCUS_FINE_STEP 時回到最佳位置鎖定; 鎖定後分數明顯下降就重新搜尋。
+// 峰值: 顯示前把梯度夠大的邊緣塗上醒目顏色。
+
+// OV5640 VCM 驅動: D[9:4] 在 0x3603[5:0], D[3:0] 在 0x3602[7:4]
+#define OV5640_REG_VCM_CTRL0      0x3602
+#define OV5640_REG_VCM_CTRL1      0x3603
+
+#define FOCUS_TENENGRAD_THRESHOLD 400    // gx² + gy² 門檻
+#define FOCUS_VCM_MAX             1023
+#define FOCUS_COARSE_STEP         96
+#define FOCUS_FINE_STEP           8
+#define FOCUS_SETTLE_FRAMES       2      // 移動鏡頭後跳過的幀數 (含 fb_count=2 的舊幀)
+#define FOCUS_REFOCUS_PERCENT     60     // 分數掉到鎖定時的 60% 以下 ...
+#define FOCUS_REFOCUS_FRAMES      8      // ... 連續這麼多幀才重新對焦
+
+__attribute__((always_inline)) inline int32_t IRAM_ATTR focus_luma(uint16_t rgb, bool byte_swapped) {
+    if (byte_swapped) rgb = __builtin_bswap16(rgb);
+    return ((rgb >> 11) << 1) + (((rgb >> 5) & 0x3F) << 1) + (rgb & 0x1F);
+}
+
+// 中央 ROI 的 Tenengrad 分數 (每個取樣點的平均梯度能量)
+uint32_t focus_score(const uint16_t* buffer, uint16_t width, uint16_t height, bool byte_swapped) {
+    if (buffer == nullptr || width < 8 || height < 8) return 0;
+    uint16_t x0 = width / 4, x1 = width - width / 4;
+    uint16_t y0 = height / 4, y1 = height - height / 4;
+    uint64_t energy = 0;
+    uint32_t samples = 0;
+    for (uint16_t y = y0; y < y1; y += 2) {
+        const uint16_t* above = buffer + (size_t)(y - 1) * width;
+        const uint16_t* row = above + width;
+        const uint16_t* below = row + width;
+        for (uint16_t x = x0; x < x1; x += 2) {
+            int32_t a0 = focus_luma(above[x - 1], byte_swapped), a1 = focus_luma(above[x], byte_swapped), a2 = focus_luma(above[x + 1], byte_swapped);
+            int32_t m0 = focus_luma(row[x - 1], byte_swapped), m2 = focus_luma(row[x + 1], byte_swapped);
+            int32_t b0 = focus_luma(below[x - 1], byte_swapped), b1 = focus_luma(below[x], byte_swapped), b2 = focus_luma(below[x + 1], byte_swapped);
+            // Sobel
+            int32_t gx = (a2 + 2 * m2 + b2) - (a0 + 2 * m0 + b0);
+            int32_t gy = (b0 + 2 * b1 + b2) - (a0 + 2 * a1 + a2);
+            uint32_t g2 = gx * gx + gy * gy;
+            if (g2 > FOCUS_TENENGRAD_THRESHOLD) energy += g2;
+            samples++;
+        }
+    }
+    return samples ? energy / samples : 0;
+}
+
+// ---------- VCM ----------
+
+bool ov5640_vcm_set(sensor_t* s, uint16_t position) {
+    position = min<uint16_t>(position, FOCUS_VCM_MAX);
+    // 0x3602[3:0] 為步進模式, 0 = 直接移動
+    int err = s->set_reg(s, OV5640_REG_VCM_CTRL0, 0xFF, (position & 0x0F) << 4);
+    err |= s->set_reg(s, OV5640_REG_VCM_CTRL1, 0x3F, position >> 4);
+    return err == 0;
+}
+
+// ---------- 爬山控制器 ----------
+
+enum FocusState : uint8_t {
+    FOCUS_NO_VCM = 0,    // 感測器沒有可控的 VCM, 只算分數
+    FOCUS_SEARCH,
+    FOCUS_LOCKED
+};
+
+struct FocusController {
+    FocusState state;
+    uint16_t position;       // 目前 VCM 位置
+    int16_t step;            // 目前步長 (帶方向)
+    uint16_t best_position;
+    uint32_t best_score;
+    uint32_t last_score;
+    uint32_t locked_score;
+    uint8_t settle;          // 剩餘跳過幀數
+    uint8_t low_frames;      // 鎖定後連續低分幀數
+    uint16_t moves;          // 這次搜尋移動次數
+    uint32_t score;          // 最近一幀分數
+};
+
+static void focus_move(FocusController* fc, sensor_t* s, uint16_t position) {
+    fc->position = position;
+    ov5640_vcm_set(s, position);
+    fc->settle = FOCUS_SETTLE_FRAMES;
+    fc->moves++;
+}
+
+void focus_start_search(FocusController* fc) {
+    if (fc->state == FOCUS_NO_VCM) return;
+    fc->state = FOCUS_SEARCH;
+    fc->step = fc->position < FOCUS_VCM_MAX / 2 ? FOCUS_COARSE_STEP : -FOCUS_COARSE_STEP;
+    fc->best_score = 0;
+    fc->best_position = fc->position;
+    fc->last_score = 0;
+    fc->low_frames = 0;
+    fc->moves = 0;
+    fc->settle = FOCUS_SETTLE_FRAMES;
+}
+
+// 感測器 (重新) 初始化後呼叫; 只有 OV5640 有 VCM
+void focus_init(FocusController* fc, sensor_t* s) {
+    uint16_t position = fc->position ? fc->position : FOCUS_VCM_MAX / 2;
+    memset(fc, 0, sizeof(FocusController));
+    fc->position = position;
+    if (s == nullptr || s->id.PID != OV5640_PID) {
+        fc->state = FOCUS_NO_VCM;
+        return;
+    }
+    fc->state = FOCUS_SEARCH;
+    ov5640_vcm_set(s, position);
+    focus_start_search(fc);
+}
+
+// 每幀呼叫一次; 回傳 true 表示剛完成對焦
+bool focus_update(FocusController* fc, sensor_t* s, uint32_t score) {
+    fc->score = score;
+    if (fc->state == FOCUS_NO_VCM || s == nullptr) return false;
+    if (fc->settle) {
+        fc->settle--;
+        return false;
+    }
+
+    if (fc->state == FOCUS_LOCKED) {
+        if (score > fc->locked_score) fc->locked_score = score;
+        if ((uint64_t)score * 100 < (uint64_t)fc->locked_score * FOCUS_REFOCUS_PERCENT) {
+            if (++fc->low_frames >= FOCUS_REFOCUS_FRAMES) focus_start_search(fc);
+        } else {
+            fc->low_frames = 0;
+        }
+        return false;
+    }
+
+    // 搜尋中
+    if (score >= fc->best_score) {
+        fc->best_score = score;
+        fc->best_position = fc->position;
+    }
+    if (fc->last_score && score < fc->last_score) {
+        // 過頭: 反向並減半步長
+        fc->step = -fc->step / 2;
+    }
+    fc->last_score = score;
+
+    if (abs(fc->step) < FOCUS_FINE_STEP) {
+        focus_move(fc, s, fc->best_position);
+        fc->state = FOCUS_LOCKED;
+        fc->locked_score = fc->best_score;
+        fc->low_frames = 0;
+        return true;
+    }
+
+    int32_t next = (int32_t)fc->position + fc->step;
+    if (next < 0 || next > FOCUS_VCM_MAX) {
+        // 走到行程端點: 反向並減半
+        fc->step = -fc->step / 2;
+        next = constrain((int32_t)fc->position + fc->step, 0, FOCUS_VCM_MAX);
+    }
+    focus_move(fc, s, next);
+    return false;
+}
+
+// ---------- 對焦峰值 ----------
+
+// 就地把水平/垂直差超過門檻的像素塗成 color (緩衝區位元組順序由 byte_swapped 指定)
+void focus_peaking(uint16_t* buffer, uint16_t width, uint16_t height, uint16_t threshold, uint16_t color, bool byte_swapped) {
+    if (buffer == nullptr || width < 2 || height < 2) return;
+    uint16_t mark = byte_swapped ? __builtin_bswap16(color) : color;
+    // 往右下讀鄰居, 這些像素還沒被改寫
+    for (uint16_t y = 0; y < height - 1; y++) {
+        uint16_t* row = buffer + (size_t)y * width;
+        uint16_t* below = row + width;
+        int32_t left = focus_luma(row[0], byte_swapped);
+        for (uint16_t x = 0; x < width - 1; x++) {
+            int32_t right = focus_luma(row[x + 1], byte_swapped);
+            int32_t down = focus_luma(below[x], byte_swapped);
+            if (abs(right - left) + abs(down - left) > threshold) row[x] = mark;
+            left = right;
+        }
+    }
+}
+
+#endif
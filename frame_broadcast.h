@@ -0,0 +1,261 @@
+#ifndef __FRAME_BROADCAST_H
+#define __FRAME_BROADCAST_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// ==================== 單次編碼、多客戶端分送 ====================
+// 每個處理完的影像只編碼一次, 放進有參考計數的 SharedFrame, 所有客戶端共用同一份資料。
+// 每個客戶端一個槽位, 只保留「最新一張還沒送出的影像」:
+//   - 發布時槽位裡還有沒送的舊影像 → 丟掉舊的 (算一次 drop), 換成新的
+//   - 發布端只在鎖內搬指標, 不會被慢的客戶端卡住; 客戶端在鎖外送資料
+// 最後一個參考釋放時才 free 影像資料。
+
+#define BROADCAST_MAX_CLIENTS    4
+#define BROADCAST_FPS_WINDOW_US  1000000
+
+struct SharedFrame {
+    uint8_t* data;              // malloc 配置, 最後一個參考釋放時 free
+    size_t len;
+    uint32_t seq;
+    int64_t timestamp_us;
+    int32_t refs;
+};
+
+struct BroadcastClient {
+    bool active;
+    SharedFrame* pending;       // 最新一張未送出的影像 (持有一個參考)
+    SemaphoreHandle_t ready;    // 有新的 pending 時給出
+    uint32_t last_seq;          // 最近送完的序號
+    uint32_t delivered;
+    uint32_t dropped;           // 還沒送就被更新的影像取代
+    uint64_t bytes;
+    int64_t connected_us;
+    int64_t last_delivered_us;
+    int64_t window_start_us;    // 幀率 / 吞吐量量測視窗
+    uint32_t window_frames;
+    uint32_t window_bytes;
+    uint32_t window_dropped;    // 視窗開始時的 dropped
+    uint16_t fps_x10;           // 最近一個完整視窗的送出幀率 x10
+    uint32_t drain_bps;         // 最近一個完整視窗的送出速率 (bytes/s)
+    bool saturated;             // 該視窗內有丟幀: 送出速率就是連線的上限
+    int64_t send_us;            // 最近一張的送出耗時
+    uint32_t latency_us;        // 發布到送完的延遲 (平滑), 含排隊等前一張送完的時間
+};
+
+struct FrameBroadcaster {
+    SemaphoreHandle_t lock;
+    SharedFrame* current;       // 最新一張 (持有一個參考), 給快照用
+    uint32_t seq;
+    BroadcastClient clients[BROADCAST_MAX_CLIENTS];
+    uint8_t client_count;
+    uint8_t snapshot_waiters;
+    uint32_t published;
+    int64_t encode_us;          // 最近一張的編碼耗時 (由發布端填寫)
+    size_t last_len;            // 最近發布的影像大小
+};
+
+// ---------- SharedFrame ----------
+
+// 接手 data (malloc 配置) 的所有權, 初始參考數 1
+SharedFrame* shared_frame_wrap(uint8_t* data, size_t len) {
+    SharedFrame* f = (SharedFrame*)malloc(sizeof(SharedFrame));
+    if (f == nullptr) {
+        free(data);
+        return nullptr;
+    }
+    f->data = data;
+    f->len = len;
+    f->seq = 0;
+    f->timestamp_us = esp_timer_get_time();
+    f->refs = 1;
+    return f;
+}
+
+__attribute__((always_inline)) inline SharedFrame* shared_frame_retain(SharedFrame* f) {
+    if (f) __atomic_add_fetch(&f->refs, 1, __ATOMIC_RELAXED);
+    return f;
+}
+
+__attribute__((always_inline)) inline void shared_frame_release(SharedFrame* f) {
+    if (f && __atomic_sub_fetch(&f->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(f->data);
+        free(f);
+    }
+}
+
+// ---------- 發布端 ----------
+
+bool broadcast_init(FrameBroadcaster* b) {
+    memset(b, 0, sizeof(FrameBroadcaster));
+    b->lock = xSemaphoreCreateMutex();
+    if (b->lock == nullptr) return false;
+    for (uint8_t i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        b->clients[i].ready = xSemaphoreCreateBinary();
+        if (b->clients[i].ready == nullptr) return false;
+    }
+    return true;
+}
+
+__attribute__((always_inline)) inline bool broadcast_wants_frame(const FrameBroadcaster* b) {
+    return b->lock && (b->client_count > 0 || b->snapshot_waiters > 0);
+}
+
+// 接手 frame 的參考; 分給每個客戶端的槽位
+void broadcast_publish(FrameBroadcaster* b, SharedFrame* frame) {
+    if (frame == nullptr) return;
+    SharedFrame* dropped[BROADCAST_MAX_CLIENTS + 1];
+    uint8_t n = 0;
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    frame->seq = ++b->seq;
+    dropped[n++] = b->current;
+    b->current = frame;
+    for (uint8_t i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        BroadcastClient* c = &b->clients[i];
+        if (!c->active) continue;
+        if (c->pending) {
+            dropped[n++] = c->pending;
+            c->dropped++;
+        }
+        c->pending = shared_frame_retain(frame);
+        xSemaphoreGive(c->ready);
+    }
+    b->published++;
+    b->last_len = frame->len;
+    xSemaphoreGive(b->lock);
+    // free 放在鎖外
+    for (uint8_t i = 0; i < n; i++) shared_frame_release(dropped[i]);
+}
+
+// ---------- 客戶端 ----------
+
+BroadcastClient* broadcast_join(FrameBroadcaster* b) {
+    BroadcastClient* client = nullptr;
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < BROADCAST_MAX_CLIENTS && client == nullptr; i++) {
+        BroadcastClient* c = &b->clients[i];
+        if (c->active) continue;
+        SemaphoreHandle_t ready = c->ready;
+        memset(c, 0, sizeof(BroadcastClient));
+        c->ready = ready;
+        xSemaphoreTake(ready, 0);   // 清掉上一個客戶端留下的通知
+        c->active = true;
+        c->last_seq = b->seq;
+        c->connected_us = c->window_start_us = esp_timer_get_time();
+        b->client_count++;
+        client = c;
+    }
+    xSemaphoreGive(b->lock);
+    return client;
+}
+
+void broadcast_leave(FrameBroadcaster* b, BroadcastClient* c) {
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    SharedFrame* pending = c->pending;
+    c->pending = nullptr;
+    c->active = false;
+    b->client_count--;
+    xSemaphoreGive(b->lock);
+    shared_frame_release(pending);
+}
+
+// 取出這個客戶端的下一張 (呼叫端送完後交給 broadcast_delivered); 逾時回傳 nullptr
+SharedFrame* broadcast_next(FrameBroadcaster* b, BroadcastClient* c, uint32_t timeout_ms) {
+    if (xSemaphoreTake(c->ready, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) return nullptr;
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    SharedFrame* f = c->pending;
+    c->pending = nullptr;
+    xSemaphoreGive(b->lock);
+    return f;
+}
+
+// 釋放參考並更新統計 (統計由 loop() 與 HTTP 任務在鎖內讀取)
+void broadcast_delivered(FrameBroadcaster* b, BroadcastClient* c, SharedFrame* f, int64_t send_us) {
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    c->last_seq = f->seq;
+    c->delivered++;
+    c->bytes += f->len;
+    c->send_us = send_us;
+    c->last_delivered_us = now;
+    uint32_t latency = now - f->timestamp_us;
+    c->latency_us = c->latency_us ? ((uint64_t)c->latency_us * 3 + latency) / 4 : latency;
+    c->window_frames++;
+    c->window_bytes += f->len;
+    if (now - c->window_start_us >= BROADCAST_FPS_WINDOW_US) {
+        // send 只要放進 socket 緩衝就返回, 單張的送出時間量不到連線速率; 改看整個視窗
+        c->fps_x10 = (uint64_t)c->window_frames * 10000000 / (now - c->window_start_us);
+        c->drain_bps = (uint64_t)c->window_bytes * 1000000 / (now - c->window_start_us);
+        c->saturated = c->dropped != c->window_dropped;
+        c->window_start_us = now;
+        c->window_frames = 0;
+        c->window_bytes = 0;
+        c->window_dropped = c->dropped;
+    }
+    xSemaphoreGive(b->lock);
+    shared_frame_release(f);
+}
+
+// 等一張比呼叫時更新的影像 (快照), 回傳持有參考的影像; 逾時回傳 nullptr
+SharedFrame* broadcast_snapshot(FrameBroadcaster* b, uint32_t timeout_ms) {
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    uint32_t seen = b->seq;
+    b->snapshot_waiters++;
+    xSemaphoreGive(b->lock);
+    SharedFrame* f = nullptr;
+    unsigned long start = millis();
+    while (f == nullptr && millis() - start < timeout_ms) {
+        xSemaphoreTake(b->lock, portMAX_DELAY);
+        if (b->seq != seen) f = shared_frame_retain(b->current);
+        xSemaphoreGive(b->lock);
+        if (f == nullptr) delay(5);
+    }
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    b->snapshot_waiters--;
+    xSemaphoreGive(b->lock);
+    return f;
+}
+
+// ---------- 統計 ----------
+
+// 客戶端送出幀率 x10; 超過一個視窗沒有送出就以目前視窗計算 (卡住的客戶端會降到 0)
+__attribute__((always_inline)) inline uint16_t broadcast_client_fps_x10(const BroadcastClient* c, int64_t now) {
+    int64_t elapsed = now - c->window_start_us;
+    if (elapsed >= 2 * BROADCAST_FPS_WINDOW_US) return (uint64_t)c->window_frames * 10000000 / elapsed;
+    return c->fps_x10;
+}
+
+// 落後的影像數: 最新序號 - 最近送完的序號 (含被丟掉與等待中的)
+__attribute__((always_inline)) inline uint32_t broadcast_client_backlog(const FrameBroadcaster* b, const BroadcastClient* c) {
+    return b->seq - c->last_seq;
+}
+
+// JSON: {"published":..,"encode_us":..,"clients":[{...}]}
+size_t broadcast_stats_json(FrameBroadcaster* b, char* out, size_t len) {
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    int n = snprintf(out, len, "{\"published\":%u,\"encode_us\":%lld,\"clients\":[", b->published, (long long)b->encode_us);
+    bool first = true;
+    for (uint8_t i = 0; i < BROADCAST_MAX_CLIENTS && n < (int)len; i++) {
+        const BroadcastClient* c = &b->clients[i];
+        if (!c->active) continue;
+        uint16_t fps = broadcast_client_fps_x10(c, now);
+        n += snprintf(out + n, len - n,
+                      "%s{\"slot\":%u,\"fps\":%u.%u,\"backlog\":%u,\"delivered\":%u,\"dropped\":%u,\"kbytes\":%llu,\"send_us\":%lld,"
+                      "\"kBps\":%u,\"saturated\":%s,\"latency_ms\":%u,\"connected_s\":%lld}",
+                      first ? "" : ",", i, fps / 10, fps % 10, broadcast_client_backlog(b, c), c->delivered, c->dropped,
+                      (unsigned long long)(c->bytes / 1024), (long long)c->send_us,
+                      c->drain_bps / 1024, c->saturated ? "true" : "false", c->latency_us / 1000, (long long)((now - c->connected_us) / 1000000));
+        first = false;
+    }
+    xSemaphoreGive(b->lock);
+    if (n < (int)len) n += snprintf(out + n, len - n, "]}");
+    if (n >= (int)len) {
+        out[len - 1] = '\0';
+        return len - 1;
+    }
+    return n;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef __HAL_H
+#define __HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "FS.h"
+#include "esp_camera.h"
+
+// ==================== 硬體抽象層 ====================
+// 影像路徑只透過這些介面存取相機、儲存、螢幕、類比輸入與網路:
+//   - 目標板: hal_esp32.h 包裝 esp_camera / SD_MMC / TFT_eSPI / analogRead / WiFi
+//   - Linux : host/hal_host.h 以檔案重播相機, 目錄當儲存, 螢幕寫檔或丟棄, 網路為本機迴路
+// 平台標頭各自以 typedef 提供 PlatformCamera / PlatformStorage /
+// PlatformDisplay / PlatformInput / PlatformNetwork。
+// 連上網路後 socket 一律使用 BSD API (lwIP / POSIX)。
+
+class CameraSource {
+public:
+    virtual ~CameraSource() {}
+    virtual esp_err_t init(const camera_config_t* config) = 0;
+    virtual void deinit() = 0;
+    virtual camera_fb_t* grab() = 0;
+    virtual void release(camera_fb_t* fb) = 0;
+    virtual sensor_t* sensor() = 0;          // 沒有感測器時回傳 nullptr
+};
+
+class Storage {
+public:
+    virtual ~Storage() {}
+    virtual bool begin() = 0;
+    virtual fs::FS& fs() = 0;
+};
+
+class Display {
+public:
+    virtual ~Display() {}
+    virtual bool begin() = 0;
+    // data 為感測器位元組順序 (大端序) 的 RGB565
+    virtual void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data) = 0;
+    virtual void fillScreen(uint16_t color) = 0;
+    virtual void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) = 0;
+    virtual void println(const char* text) = 0;
+};
+
+class AnalogInput {
+public:
+    virtual ~AnalogInput() {}
+    virtual uint16_t read() = 0;              // 0 - 4095
+};
+
+class Network {
+public:
+    virtual ~Network() {}
+    virtual bool begin(const char* ssid, const char* password) = 0;   // 阻塞到連上或逾時
+    virtual bool connected() = 0;
+    virtual const char* address() = 0;        // 點分十進位 IP
+};
+
+struct Hal {
+    CameraSource* camera;
+    Storage* storage;
+    Display* display;
+    AnalogInput* input;
+    Network* network;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef __HAL_ESP32_H
+#define __HAL_ESP32_H
+
+#include <SPI.h>
+#include <TFT_eSPI.h>
+#include <WiFi.h>
+#include "esp_camera.h"
+#include "sd_read_write.h"
+#include "hal.h"
+
+// ==================== ESP32 目標板實作 ====================
+
+class Esp32Camera : public CameraSource {
+public:
+    esp_err_t init(const camera_config_t* config) override { return esp_camera_init(config); }
+    void deinit() override { esp_camera_deinit(); }
+    camera_fb_t* grab() override { return esp_camera_fb_get(); }
+    void release(camera_fb_t* fb) override { esp_camera_fb_return(fb); }
+    sensor_t* sensor() override { return esp_camera_sensor_get(); }
+};
+
+class SdMmcStorage : public Storage {
+public:
+    bool begin() override { return sdmmcInit(); }
+    fs::FS& fs() override { return SD_MMC; }
+};
+
+class TftDisplay : public Display {
+public:
+    bool begin() override {
+        tft.begin();
+        if (!tft.width() || !tft.height()) return false;
+        tft.setRotation(1);
+        tft.fillScreen(TFT_BLACK);
+        tft.setTextColor(TFT_WHITE);
+        return true;
+    }
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data) override { tft.pushImage(x, y, w, h, data); }
+    void fillScreen(uint16_t color) override { tft.fillScreen(color); }
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) override { tft.drawRect(x, y, w, h, color); }
+    void println(const char* text) override { tft.println(text); }
+
+    TFT_eSPI tft = TFT_eSPI();
+};
+
+class AdcInput : public AnalogInput {
+public:
+    explicit AdcInput(uint8_t pin) : pin(pin) {}
+    uint16_t read() override { return analogRead(pin); }
+
+private:
+    uint8_t pin;
+};
+
+class WifiNetwork : public Network {
+public:
+    bool begin(const char* ssid, const char* password) override {
+        if (ssid == nullptr || ssid[0] == '\0') return false;
+        WiFi.mode(WIFI_STA);
+        WiFi.setSleep(false);      // 省電模式會讓串流延遲暴增
+        WiFi.begin(ssid, password);
+        unsigned long start = millis();
+        while (WiFi.status() != WL_CONNECTED) {
+            if (millis() - start > connectTimeoutMs) return false;
+            delay(100);
+        }
+        snprintf(ip, sizeof(ip), "%s", WiFi.localIP().toString().c_str());
+        return true;
+    }
+    bool connected() override { return WiFi.status() == WL_CONNECTED; }
+    const char* address() override { return ip; }
+
+    unsigned long connectTimeoutMs = 15000;
+
+private:
+    char ip[16] = "0.0.0.0";
+};
+
+typedef Esp32Camera PlatformCamera;
+typedef SdMmcStorage PlatformStorage;
+typedef TftDisplay PlatformDisplay;
+typedef AdcInput PlatformInput;
+typedef WifiNetwork PlatformNetwork;
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef __HDR_MERGE_H
+#define __HDR_MERGE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "img_computing.h"
+#include "auto_exposure.h"
+
+// ==================== HDR 包圍曝光合成 ====================
+// 高反差場景單一曝光不是暗部死黑就是亮部過曝。拍照時連拍三張不同 set_aec_value 的影像:
+//   目前 AE 的曝光 (不必等穩定, 先拍), 減 ev_step 檔, 加 ev_step 檔 (1 檔 = 曝光 x2, 受 AE_AEC_MIN/MAX 限制)
+// 合成 (曝光融合, 不需要相機響應曲線):
+//   - 每張每個像素依自己的亮度給「曝光良好度」權重: 以 128 為中心的高斯 (σ = 0.2), 256 項查表 (Q8)
+//   - 三個權重以倒數查表正規化成和為 256, 三張的 8 位元 R/G/B 加權平均, 結果多保留 4 位元 (Q4, 0-4080)
+//   - 單一尺度融合會壓平反差, 最後以 S 曲線查表色調映射回 8 位元並打包成 RGB565
+// 全部整數運算, 逐行處理不需要中間影像: 上半部在目前核心, 下半部在另一個核心。
+// 三張影像各佔一個完整畫面 (QVGA 共 450 KB), 優先放 PSRAM, 第一次拍 HDR 時配置。
+
+#define HDR_FRAMES         3
+#define HDR_SETTLE_FRAMES  (AE_SETTLE_FRAMES + 1)   // 改曝光後丟掉的幀數 (佇列中的舊幀 + 曝光中途改設定的那幀)
+#define HDR_TONE_SIZE      4160                     // 色調映射查表, 輸入為 Q4 (0-4080, 正規化捨入最多再多 60)
+
+struct HdrBracket {
+    uint16_t* frames[HDR_FRAMES];        // 感測器位元組順序 RGB565
+    uint16_t width;
+    uint16_t height;
+    int aec[HDR_FRAMES];                 // 拍攝順序: 目前曝光, 短, 長
+    uint8_t ev_step;                     // 相鄰兩張差幾檔
+    uint16_t weight[256];                // 亮度 → 曝光良好度 (Q8, 1-256)
+    uint16_t recip[HDR_FRAMES * 256 + 1];   // 權重和 → 65536 / 和
+    uint8_t tone[HDR_TONE_SIZE];         // Q4 → 8 位元
+    int64_t capture_us;                  // 三張的拍攝時間 (含丟掉的幀)
+    int64_t merge_us;
+};
+
+// contrast: S 曲線強度 (Q8, 0 = 直接取整, 256 = 完整 smoothstep)
+void hdr_init(HdrBracket* hdr, uint8_t ev_step, uint16_t contrast) {
+    memset(hdr, 0, sizeof(HdrBracket));
+    hdr->ev_step = ev_step;
+    const float sigma = 0.2f * 255.0f;
+    for (int v = 0; v < 256; v++) {
+        float d = v - 127.5f;
+        int w = (int)(256.0f * expf(-d * d / (2 * sigma * sigma)) + 0.5f);
+        hdr->weight[v] = constrain(w, 1, 256);
+    }
+    hdr->recip[0] = 0;
+    for (uint32_t sum = 1; sum <= HDR_FRAMES * 256; sum++) {
+        hdr->recip[sum] = min<uint32_t>((65536 + sum / 2) / sum, 65535);
+    }
+    float k = contrast / 256.0f;
+    for (int i = 0; i < HDR_TONE_SIZE; i++) {
+        float t = min(i / 4080.0f, 1.0f);
+        float s = t * t * (3 - 2 * t);
+        hdr->tone[i] = (uint8_t)(255.0f * (t + k * (s - t)) + 0.5f);
+    }
+}
+
+static uint16_t* hdr_alloc_frame(size_t pixels) {
+    uint16_t* p = (uint16_t*)heap_caps_malloc(pixels * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+    if (p == nullptr) p = (uint16_t*)heap_caps_malloc(pixels * sizeof(uint16_t), MALLOC_CAP_8BIT);
+    return p;
+}
+
+// 尺寸改變 (切換相機模式) 時重新配置
+bool hdr_alloc(HdrBracket* hdr, uint16_t width, uint16_t height) {
+    if (hdr->width != width || hdr->height != height) {
+        for (uint8_t i = 0; i < HDR_FRAMES; i++) {
+            heap_caps_free(hdr->frames[i]);
+            hdr->frames[i] = nullptr;
+        }
+        hdr->width = width;
+        hdr->height = height;
+    }
+    bool ok = true;
+    for (uint8_t i = 0; i < HDR_FRAMES; i++) {
+        if (hdr->frames[i] == nullptr) hdr->frames[i] = hdr_alloc_frame((size_t)width * height);
+        ok = ok && hdr->frames[i];
+    }
+    return ok;
+}
+
+// 以目前曝光為中心排出三張的 aec 值
+void hdr_bracket_exposures(HdrBracket* hdr, int base_aec) {
+    hdr->aec[0] = constrain(base_aec, AE_AEC_MIN, AE_AEC_MAX);
+    hdr->aec[1] = max(hdr->aec[0] >> hdr->ev_step, AE_AEC_MIN);
+    hdr->aec[2] = min(hdr->aec[0] << hdr->ev_step, AE_AEC_MAX);
+}
+
+// ---------- 合成 ----------
+
+// 第 first_row 到 end_row (不含) 行; 輸入與輸出同為 byte_swapped 指定的位元組順序
+void IRAM_ATTR hdr_merge_rows(const HdrBracket* hdr, uint16_t* out, uint16_t first_row, uint16_t end_row, bool byte_swapped) {
+    const uint16_t* weight = hdr->weight;
+    const uint8_t* tone = hdr->tone;
+    for (uint16_t y = first_row; y < end_row; y++) {
+        size_t base = (size_t)y * hdr->width;
+        for (uint16_t x = 0; x < hdr->width; x++) {
+            uint32_t r[HDR_FRAMES], g[HDR_FRAMES], b[HDR_FRAMES], w[HDR_FRAMES];
+            uint32_t sum = 0;
+            for (uint8_t i = 0; i < HDR_FRAMES; i++) {
+                uint16_t px = hdr->frames[i][base + x];
+                if (byte_swapped) px = __builtin_bswap16(px);
+                r[i] = five_to_eight[px >> 11];
+                g[i] = six_to_eight[(px >> 5) & 0x3F];
+                b[i] = five_to_eight[px & 0x1F];
+                w[i] = weight[(77 * r[i] + 150 * g[i] + 29 * b[i]) >> 8];
+                sum += w[i];
+            }
+            // 權重正規化為和 256, 累加結果為 Q4
+            uint32_t inv = hdr->recip[sum];
+            uint32_t acc_r = 0, acc_g = 0, acc_b = 0;
+            for (uint8_t i = 0; i < HDR_FRAMES; i++) {
+                uint32_t nw = (w[i] * inv + 128) >> 8;
+                acc_r += nw * r[i];
+                acc_g += nw * g[i];
+                acc_b += nw * b[i];
+            }
+            uint16_t px = ((uint16_t)(tone[acc_r >> 4] >> 3) << 11) | ((uint16_t)(tone[acc_g >> 4] >> 2) << 5) | (tone[acc_b >> 4] >> 3);
+            out[base + x] = byte_swapped ? __builtin_bswap16(px) : px;
+        }
+    }
+}
+
+struct HdrMergeParams {
+    const HdrBracket* hdr;
+    uint16_t* out;
+    uint16_t first_row;
+    uint16_t end_row;
+    bool byte_swapped;
+};
+
+// out 不可與三張輸入重疊
+void hdr_merge_parallel(HdrBracket* hdr, uint16_t* out, bool byte_swapped) {
+    if (out == nullptr || hdr->frames[HDR_FRAMES - 1] == nullptr) return;
+    int64_t start = esp_timer_get_time();
+    TaskHandle_t task_handle = nullptr;
+    uint16_t split_row = hdr->height / 2;
+
+    // 為第二核心建立參數
+    HdrMergeParams* params = new HdrMergeParams{ hdr, out, split_row, hdr->height, byte_swapped };
+
+    // 第二核心任務函數
+    auto task_func = [](void* p) {
+        HdrMergeParams* args = (HdrMergeParams*)p;
+        hdr_merge_rows(args->hdr, args->out, args->first_row, args->end_row, args->byte_swapped);
+        delete args;
+        vTaskDelete(NULL);
+    };
+
+    // 在第二核心建立任務
+    BaseType_t result = xTaskCreatePinnedToCore(
+        task_func,
+        "hdr_merge_task",
+        4096,  // 堆疊大小
+        params,
+        1,     // 優先級
+        &task_handle,
+        !xPortGetCoreID()  // 在另一個核心運行
+    );
+
+    if (result != pdPASS) {
+        Serial.println("Failed to create task! Falling back to single core.");
+        // 單核心備援處理
+        delete params;
+        hdr_merge_rows(hdr, out, 0, hdr->height, byte_swapped);
+        hdr->merge_us = esp_timer_get_time() - start;
+        return;
+    }
+
+    // 第一核心處理上半部
+    hdr_merge_rows(hdr, out, 0, split_row, byte_swapped);
+
+    // 等待第二核心任務完成
+    if (task_handle != nullptr) {
+        while (eTaskGetState(task_handle) != eDeleted) {
+            delay(1);
+        }
+    }
+    hdr->merge_us = esp_timer_get_time() - start;
+}
+
+#endif
@@ -0,0 +1,106 @@
+// ==================== 色彩階段基準測試 (Linux 主機) ====================
+// HSV 顏色調整 vs 3x3 色彩校正矩陣 + 色調曲線, 同一個兩核心顏色處理迴圈;
+// 並以浮點參考逐一比對 CCM 的 65536 種輸入, 以及換參數的成本。
+//
+//   bench_color [width height] [runs]
+
+#include "Arduino.h"
+#include "../img_computing.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+static ColorAdjustment adjustments[] = {
+    {HUE_BLUE, 43, 25, 15},
+    {HUE_RED, 43, 20, 5},
+    {HUE_GREEN, -20, 15, 50}
+};
+
+// 與 apply_color_correction 相同定義的浮點版本
+static uint16_t reference_ccm(const int16_t m[9], const uint8_t* curve, uint16_t rgb) {
+    float in[3] = { (float)five_to_eight[rgb >> 11], (float)six_to_eight[(rgb >> 5) & 0x3F], (float)five_to_eight[rgb & 0x1F] };
+    int out[3];
+    for (int row = 0; row < 3; row++) {
+        float v = (m[row * 3] * in[0] + m[row * 3 + 1] * in[1] + m[row * 3 + 2] * in[2]) / 256.0f;
+        out[row] = curve[std::min(255, std::max(0, (int)floorf(v + 0.5f)))];
+    }
+    return ((out[0] >> 3) << 11) | ((out[1] >> 2) << 5) | (out[2] >> 3);
+}
+
+static int64_t time_pass(std::vector<uint16_t>& work, const std::vector<uint16_t>& frame, int runs,
+                         ColorAdjustment* adj, uint8_t count, const ColorCorrection* ccm) {
+    int64_t total = 0;
+    for (int i = 0; i < runs; i++) {
+        work = frame;
+        int64_t start = esp_timer_get_time();
+        adjust_multiple_colors_parallel(work.data(), work.size(), adj, count, nullptr, nullptr, nullptr, nullptr, ccm);
+        total += esp_timer_get_time() - start;
+    }
+    return total / runs;
+}
+
+int main(int argc, char** argv) {
+    uint16_t width = argc > 2 ? atoi(argv[1]) : 320;
+    uint16_t height = argc > 2 ? atoi(argv[2]) : 240;
+    int runs = argc > 3 ? atoi(argv[3]) : argc == 2 ? atoi(argv[1]) : 50;
+    host_set_realtime(false);
+
+    static ColorCorrection cc;
+    int16_t matrix[9];
+    color_correction_init(&cc);
+    color_correction_saturation_matrix(matrix, 307);
+    color_correction_set_matrix(&cc, matrix);
+    color_correction_set_gamma(&cc, 563);   // 2.2
+
+    uint8_t curve[256];
+    for (int v = 0; v < 256; v++) curve[v] = (uint8_t)(255.0f * powf(v / 255.0f, 256.0f / 563) + 0.5f);
+    uint32_t mismatches = 0;
+    for (uint32_t rgb = 0; rgb < 65536; rgb++) {
+        mismatches += apply_color_correction(&cc, rgb) != reference_ccm(matrix, curve, rgb);
+    }
+
+    // 恆等設定必須無損
+    static ColorCorrection unit;
+    color_correction_init(&unit);
+    static const int16_t unit_matrix[9] = { 256, 0, 0, 0, 256, 0, 0, 0, 256 };
+    color_correction_set_matrix(&unit, unit_matrix);
+    color_correction_set_tone(&unit, curve, nullptr, nullptr);
+    color_correction_set_tone(&unit, nullptr, nullptr, nullptr);
+    uint32_t identity_errors = !unit.identity;
+    for (uint32_t rgb = 0; rgb < 65536; rgb++) {
+        identity_errors += apply_color_correction(&unit, rgb) != rgb;
+    }
+
+    // 換參數的成本
+    const int updates = 1000;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < updates; i++) {
+        color_correction_saturation_matrix(matrix, 256 + (i & 127));
+        color_correction_set_matrix(&cc, matrix);
+    }
+    int64_t matrix_us = esp_timer_get_time() - start;
+    start = esp_timer_get_time();
+    for (int i = 0; i < updates; i++) {
+        color_correction_set_tone(&cc, curve, curve, curve);
+    }
+    int64_t tone_us = esp_timer_get_time() - start;
+    color_correction_saturation_matrix(matrix, 307);
+    color_correction_set_matrix(&cc, matrix);
+
+    std::mt19937 rng(1234);
+    std::vector<uint16_t> frame((size_t)width * height), work;
+    for (uint16_t& px : frame) px = rng();
+    int64_t hsv_us = time_pass(work, frame, runs, adjustments, 3, nullptr);
+    int64_t ccm_us = time_pass(work, frame, runs, nullptr, 0, &cc);
+    int64_t both_us = time_pass(work, frame, runs, adjustments, 3, &cc);
+
+    printf("%ux%u, %d runs\n", width, height, runs);
+    printf("  HSV adjustments  : %lld us/frame\n", (long long)hsv_us);
+    printf("  CCM + tone LUT   : %lld us/frame\n", (long long)ccm_us);
+    printf("  both             : %lld us/frame\n", (long long)both_us);
+    printf("  set_matrix       : %.2f us\n", (double)matrix_us / updates);
+    printf("  set_tone         : %.2f us\n", (double)tone_us / updates);
+    printf("  mismatches       : %u (vs float reference), %u (identity)\n", mismatches, identity_errors);
+    return mismatches || identity_errors ? 1 : 0;
+}
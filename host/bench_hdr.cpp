@@ -0,0 +1,103 @@
+// ==================== HDR 合成基準測試 (Linux 主機) ====================
+// hdr_merge.h 在合成的高反差場景上:
+//   - 以 gamma 2.2 模擬三種曝光 (與 HostCamera 的曝光模型相同), 過亮的截在 255
+//   - 單核心 (hdr_merge_rows) 與兩核心 (hdr_merge_parallel) 的合成時間, 兩者輸出必須相同
+//   - 目前曝光那張與合成結果的暗部 (亮度 < 16) / 過曝 (> 239) 比例
+//
+//   bench_hdr [width height] [runs] [out_dir]
+// 給 out_dir 時存三張曝光與合成結果的 BMP。
+
+#include "Arduino.h"
+#include "FS.h"
+#include "sd_read_write.h"
+#include "../hdr_merge.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+// 線性亮度: 左邊陰影 (0.002) 到右邊窗外 (8), 跨 12 檔, 加上彩色條紋
+static std::vector<float> make_scene(uint16_t w, uint16_t h) {
+    std::vector<float> scene((size_t)w * h * 3);
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++) {
+            float level = 0.002f * powf(2.0f, 12.0f * x / (w - 1));
+            float* p = &scene[((size_t)y * w + x) * 3];
+            uint16_t band = y * 4 / h;
+            p[0] = level * (band == 1 ? 1.0f : 0.6f);
+            p[1] = level * (band == 2 ? 1.0f : 0.6f);
+            p[2] = level * (band == 3 ? 1.0f : 0.6f);
+        }
+    }
+    return scene;
+}
+
+// 曝光 ratio 倍的感測器輸出 (大端序 RGB565)
+static void expose(const std::vector<float>& scene, float ratio, uint16_t* out, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        int c[3];
+        for (int k = 0; k < 3; k++) c[k] = constrain((int)(255.0f * powf(scene[i * 3 + k] * ratio, 1 / 2.2f) + 0.5f), 0, 255);
+        out[i] = __builtin_bswap16((uint16_t)((c[0] >> 3) << 11 | (c[1] >> 2) << 5 | (c[2] >> 3)));
+    }
+}
+
+static void clipped(const uint16_t* frame, size_t pixels, double* dark, double* bright) {
+    size_t d = 0, b = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        uint16_t px = __builtin_bswap16(frame[i]);
+        uint32_t y = (77 * five_to_eight[px >> 11] + 150 * six_to_eight[(px >> 5) & 0x3F] + 29 * five_to_eight[px & 0x1F]) >> 8;
+        if (y < 16) d++;
+        if (y > 239) b++;
+    }
+    *dark = 100.0 * d / pixels;
+    *bright = 100.0 * b / pixels;
+}
+
+static void save(FS* fs, const char* name, uint16_t* frame, uint16_t w, uint16_t h) {
+    if (fs == nullptr) return;
+    std::vector<uint16_t> native(frame, frame + (size_t)w * h);
+    for (uint16_t& px : native) px = __builtin_bswap16(px);
+    writeBMP_RGB565(*fs, name, native.data(), w, h);
+}
+
+int main(int argc, char** argv) {
+    uint16_t w = argc > 2 ? atoi(argv[1]) : 320;
+    uint16_t h = argc > 2 ? atoi(argv[2]) : 240;
+    int runs = argc > 3 ? atoi(argv[3]) : 20;
+    FS* fs = argc > 4 ? new FS(argv[4]) : nullptr;
+    size_t pixels = (size_t)w * h;
+
+    static HdrBracket hdr;
+    hdr_init(&hdr, 2, 48);
+    if (!hdr_alloc(&hdr, w, h)) return 1;
+    hdr_bracket_exposures(&hdr, 300);
+    std::vector<float> scene = make_scene(w, h);
+    static const char* names[HDR_FRAMES] = { "ev0.bmp", "ev_short.bmp", "ev_long.bmp" };
+    for (int i = 0; i < HDR_FRAMES; i++) {
+        expose(scene, hdr.aec[i] / 300.0f, hdr.frames[i], pixels);
+        save(fs, names[i], hdr.frames[i], w, h);
+    }
+
+    std::vector<uint16_t> single(pixels), dual(pixels);
+    int64_t t_single = 0, t_dual = 0;
+    for (int r = 0; r < runs; r++) {
+        int64_t t0 = esp_timer_get_time();
+        hdr_merge_rows(&hdr, single.data(), 0, h, true);
+        t_single += esp_timer_get_time() - t0;
+        hdr_merge_parallel(&hdr, dual.data(), true);
+        t_dual += hdr.merge_us;
+    }
+    bool same = single == dual;
+    save(fs, "merged.bmp", dual.data(), w, h);
+
+    double dark0, bright0, dark, bright;
+    clipped(hdr.frames[0], pixels, &dark0, &bright0);
+    clipped(dual.data(), pixels, &dark, &bright);
+    printf("%ux%u, aec %d/%d/%d, %d runs\n", w, h, hdr.aec[0], hdr.aec[1], hdr.aec[2], runs);
+    printf("merge: 1 core %lld us, 2 cores %lld us%s\n", (long long)(t_single / runs), (long long)(t_dual / runs),
+           same ? "" : "  1 core != 2 cores");
+    printf("%-8s %7s %7s\n", "", "dark", "clipped");
+    printf("%-8s %6.1f%% %6.1f%%\n", "ev0", dark0, bright0);
+    printf("%-8s %6.1f%% %6.1f%%\n", "merged", dark, bright);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+// ==================== 積分影像基準測試 (Linux 主機) ====================
+// 隨機矩形的亮度總和: 逐像素加總 vs 積分影像 (含建立時間), 並逐一比對結果。
+//
+//   bench_integral [width height] [queries]
+
+#include "Arduino.h"
+#include "../integral_image.h"
+
+#include <random>
+#include <vector>
+
+static uint32_t naive_sum(const uint16_t* buf, uint16_t width, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    uint32_t sum = 0;
+    for (uint16_t j = y; j < y + h; j++) {
+        const uint16_t* row = buf + (size_t)j * width;
+        for (uint16_t i = x; i < x + w; i++) {
+            sum += integral_luma(row[i]);
+        }
+    }
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    uint16_t width = argc > 2 ? atoi(argv[1]) : 320;
+    uint16_t height = argc > 2 ? atoi(argv[2]) : 240;
+    uint32_t queries = argc > 3 ? atoi(argv[3]) : argc == 2 ? atoi(argv[1]) : 10000;
+    host_set_realtime(false);
+
+    std::mt19937 rng(1234);
+    std::vector<uint16_t> frame((size_t)width * height);
+    for (uint16_t& px : frame) px = rng();
+
+    struct Rect { uint16_t x, y, w, h; };
+    std::vector<Rect> rects(queries);
+    for (Rect& r : rects) {
+        r.w = 1 + rng() % width;
+        r.h = 1 + rng() % height;
+        r.x = rng() % (width - r.w + 1);
+        r.y = rng() % (height - r.h + 1);
+    }
+
+    IntegralImage ii = {};
+    const int builds = 20;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < builds; i++) integral_image_build(&ii, frame.data(), width, height, false);
+    int64_t build_us = (esp_timer_get_time() - start) / builds;
+
+    std::vector<uint32_t> expect(queries);
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < queries; i++) {
+        expect[i] = naive_sum(frame.data(), width, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+    }
+    int64_t naive_us = esp_timer_get_time() - start;
+
+    uint32_t mismatches = 0;
+    volatile uint32_t sink = 0;
+    start = esp_timer_get_time();
+    for (uint32_t i = 0; i < queries; i++) {
+        uint32_t s = integral_image_sum(&ii, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+        sink += s;
+        mismatches += s != expect[i];
+    }
+    int64_t query_us = esp_timer_get_time() - start;
+
+    double naive_per = (double)naive_us / queries;
+    double query_per = (double)query_us / queries;
+    printf("%ux%u, %u random rectangles\n", width, height, queries);
+    printf("  integral build   : %lld us/frame (two-phase, two tasks)\n", (long long)build_us);
+    printf("  naive summation  : %.3f us/query (%lld us total)\n", naive_per, (long long)naive_us);
+    printf("  integral lookup  : %.4f us/query (%lld us total)\n", query_per, (long long)query_us);
+    printf("  break-even       : %.1f queries/frame\n", naive_per > query_per ? build_us / (naive_per - query_per) : 0.0);
+    printf("  mismatches       : %u\n", mismatches);
+    return mismatches ? 1 : 0;
+}
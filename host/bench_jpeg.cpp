@@ -0,0 +1,153 @@
+// ==================== JPEG 編碼器基準測試 (Linux 主機) ====================
+// jpeg_encoder.h 與 libjpeg (fmt2jpg 主機版) 在同一張合成影像上比較:
+//   - 單核心 / 兩核心的編碼時間與大小, 兩者輸出必須逐位元組相同
+//   - 串流 API (一次一行餵入, 無 RST) 的大小
+//   - 以 libjpeg 解碼 (有任何錯誤或警告即失敗), 與原圖的 PSNR
+// 另外編一張寬高不是 16 倍數的影像, 檢查邊緣處理。
+//
+//   bench_jpeg [width height] [runs] [out_dir]
+
+#include "Arduino.h"
+#include "img_converters.h"
+#include "../jpeg_encoder.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// 漸層 + 正弦紋理 + 銳利邊緣 + 雜訊, 感測器位元組順序
+static std::vector<uint16_t> make_frame(uint16_t w, uint16_t h) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 4.0f);
+    std::vector<uint16_t> frame((size_t)w * h);
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++) {
+            float r = 255.0f * x / w, g = 255.0f * y / h;
+            float b = 128 + 100 * sinf(x * 0.15f) * cosf(y * 0.1f);
+            if ((x / 40 + y / 40) % 2 && x > w / 2) r = g = 255 - b;
+            int ri = constrain((int)(r + noise(rng)), 0, 255);
+            int gi = constrain((int)(g + noise(rng)), 0, 255);
+            int bi = constrain((int)(b + noise(rng)), 0, 255);
+            uint16_t px = ((ri >> 3) << 11) | ((gi >> 2) << 5) | (bi >> 3);
+            frame[(size_t)y * w + x] = (px >> 8) | (px << 8);
+        }
+    }
+    return frame;
+}
+
+static double psnr(const std::vector<uint16_t>& frame, const uint8_t* rgb, uint16_t w, uint16_t h) {
+    double se = 0;
+    for (size_t i = 0; i < (size_t)w * h; i++) {
+        uint16_t px = (frame[i] >> 8) | (frame[i] << 8);
+        int ref[3] = { five_to_eight[px >> 11], six_to_eight[(px >> 5) & 0x3F], five_to_eight[px & 0x1F] };
+        for (int c = 0; c < 3; c++) se += (double)(ref[c] - rgb[3 * i + c]) * (ref[c] - rgb[3 * i + c]);
+    }
+    double mse = se / ((double)w * h * 3);
+    return mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+// 解碼並回傳 PSNR; 解碼失敗回傳 -1
+static double check(const std::vector<uint16_t>& frame, const uint8_t* jpg, size_t len, uint16_t w, uint16_t h) {
+    uint8_t* rgb = nullptr;
+    uint16_t dw, dh;
+    if (!host_jpeg_decode_rgb888(jpg, len, &rgb, &dw, &dh) || dw != w || dh != h) {
+        free(rgb);
+        return -1;
+    }
+    double p = psnr(frame, rgb, w, h);
+    free(rgb);
+    return p;
+}
+
+static bool vector_sink(void* context, const uint8_t* data, size_t len) {
+    std::vector<uint8_t>* v = (std::vector<uint8_t>*)context;
+    v->insert(v->end(), data, data + len);
+    return true;
+}
+
+static void save(const char* dir, const char* name, const uint8_t* data, size_t len) {
+    if (dir == nullptr) return;
+    std::string path = std::string(dir) + "/" + name;
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f) {
+        fwrite(data, 1, len, f);
+        fclose(f);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint16_t w = argc > 2 ? atoi(argv[1]) : 320;
+    uint16_t h = argc > 2 ? atoi(argv[2]) : 240;
+    int runs = argc > 3 ? atoi(argv[3]) : 20;
+    const char* out_dir = argc > 4 ? argv[4] : nullptr;
+    std::vector<uint16_t> frame = make_frame(w, h);
+    bool ok = true;
+
+    printf("%ux%u, %d runs\n", w, h, runs);
+    printf("%-7s %-5s %9s %9s %9s %8s %8s %8s %7s\n", "quality", "sub", "1 core", "2 cores", "libjpeg",
+           "bytes", "stream", "libjpeg", "PSNR");
+    static const uint8_t qualities[] = { 50, 80, 95 };
+    for (uint8_t quality : qualities) {
+        for (int sub = 0; sub < 2; sub++) {
+            JpegSubsampling s = sub ? JPEG_SUBSAMPLE_422 : JPEG_SUBSAMPLE_420;
+            uint8_t *single = nullptr, *dual = nullptr, *ref = nullptr;
+            size_t single_len = 0, dual_len = 0, ref_len = 0;
+            int64_t t_single = 0, t_dual = 0, t_ref = 0;
+            for (int r = 0; r < runs; r++) {
+                free(single);
+                free(dual);
+                free(ref);
+                int64_t t0 = esp_timer_get_time();
+                jpeg_encode_rgb565(frame.data(), w, h, quality, s, true, &single, &single_len, false);
+                int64_t t1 = esp_timer_get_time();
+                jpeg_encode_rgb565(frame.data(), w, h, quality, s, true, &dual, &dual_len, true);
+                int64_t t2 = esp_timer_get_time();
+                fmt2jpg((uint8_t*)frame.data(), frame.size() * 2, w, h, PIXFORMAT_RGB565, quality, &ref, &ref_len);
+                int64_t t3 = esp_timer_get_time();
+                t_single += t1 - t0;
+                t_dual += t2 - t1;
+                t_ref += t3 - t2;
+            }
+
+            // 串流 API: 一次一行
+            std::vector<uint8_t> streamed;
+            JpegEncoder enc;
+            bool stream_ok = jpeg_encoder_begin(&enc, w, h, quality, s, true, vector_sink, &streamed);
+            for (uint16_t y = 0; y < h && stream_ok; y++) stream_ok = jpeg_encoder_write_lines(&enc, frame.data() + (size_t)y * w, 1);
+            stream_ok = jpeg_encoder_end(&enc) && stream_ok;
+
+            bool same = single_len == dual_len && memcmp(single, dual, single_len) == 0;
+            double p = check(frame, dual, dual_len, w, h);
+            double p_stream = stream_ok ? check(frame, streamed.data(), streamed.size(), w, h) : -1;
+            double p_ref = check(frame, ref, ref_len, w, h);
+            printf("%-7u %-5s %7lld us %7lld us %7lld us %8zu %8zu %8zu %4.1f dB (stream %.1f, libjpeg %.1f)%s\n",
+                   quality, sub ? "4:2:2" : "4:2:0", (long long)(t_single / runs), (long long)(t_dual / runs),
+                   (long long)(t_ref / runs), dual_len, streamed.size(), ref_len, p, p_stream, p_ref,
+                   same ? "" : "  1 core != 2 cores");
+            if (!same || p < 0 || p_stream < 0) ok = false;
+            char name[64];
+            snprintf(name, sizeof(name), "q%u_%s.jpg", quality, sub ? "422" : "420");
+            save(out_dir, name, dual, dual_len);
+            free(single);
+            free(dual);
+            free(ref);
+        }
+    }
+
+    // 邊緣: 寬高不是 MCU 的倍數
+    uint16_t ew = 100, eh = 75;
+    std::vector<uint16_t> edge = make_frame(ew, eh);
+    for (int sub = 0; sub < 2; sub++) {
+        uint8_t* jpg = nullptr;
+        size_t len = 0;
+        jpeg_encode_rgb565(edge.data(), ew, eh, 90, sub ? JPEG_SUBSAMPLE_422 : JPEG_SUBSAMPLE_420, true, &jpg, &len);
+        double p = check(edge, jpg, len, ew, eh);
+        printf("%ux%u %s: %zu bytes, %.1f dB\n", ew, eh, sub ? "4:2:2" : "4:2:0", len, p);
+        if (p < 0) ok = false;
+        save(out_dir, sub ? "edge_422.jpg" : "edge_420.jpg", jpg, len);
+        free(jpg);
+    }
+    printf("%s\n", ok ? "all outputs decoded by libjpeg" : "FAILED");
+    return ok ? 0 : 1;
+}
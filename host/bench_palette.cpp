@@ -0,0 +1,148 @@
+// ==================== 調色盤量化基準測試 (Linux 主機) ====================
+// palette_quant.h 的中位數切割 + writeBMP_Indexed8 與 24 位元 writeBMP_RGB565 比較:
+// 直方圖與切割的時間、調色盤顏色數、PSNR、檔案大小。8 位元 BMP 讀回後逐像素檢查
+// 每個像素都是 palette[lut[原色]]; 顏色數不超過調色盤大小時必須無損。
+//
+//   bench_palette [image.bmp] [colors] [runs] [out_dir]
+// 沒有給影像時用合成影像: 只有 40 色的色塊圖 (顏色調整後的目標), 只差一階 G 的兩色, 漸層 + 雜訊。
+
+#include "Arduino.h"
+#include "FS.h"
+#include "sd_read_write.h"
+#include "bench_util.h"
+#include "../palette_quant.h"
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+static uint8_t expand5(uint8_t v) { return (v << 3) | (v >> 2); }
+static uint8_t expand6(uint8_t v) { return (v << 2) | (v >> 4); }
+
+// 40 色的色塊
+static std::vector<uint16_t> make_blocks(uint16_t w, uint16_t h) {
+    std::mt19937 rng(3);
+    uint16_t colors[40];
+    for (uint16_t& c : colors) c = rng() & 0xFFFF;
+    std::vector<uint16_t> frame((size_t)w * h);
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++) frame[(size_t)y * w + x] = colors[((x / 23) * 7 + (y / 17) * 3) % 40];
+    }
+    return frame;
+}
+
+// 兩色只差一階 G: 最長邊以 8 位元單位比較時與只有一階的 R/B 同長, 必須沿 G 切
+static std::vector<uint16_t> make_g_step(uint16_t w, uint16_t h) {
+    std::vector<uint16_t> frame((size_t)w * h);
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++) frame[(size_t)y * w + x] = palette_index(12, x < w / 2 ? 20 : 21, 9);
+    }
+    return frame;
+}
+
+static std::vector<uint16_t> make_photo(uint16_t w, uint16_t h) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 4.0f);
+    std::vector<uint16_t> frame((size_t)w * h);
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++) {
+            float r = 255.0f * x / w, g = 255.0f * y / h;
+            float b = 128 + 100 * sinf(x * 0.05f) * cosf(y * 0.04f);
+            int ri = constrain((int)(r + noise(rng)), 0, 255);
+            int gi = constrain((int)(g + noise(rng)), 0, 255);
+            int bi = constrain((int)(b + noise(rng)), 0, 255);
+            frame[(size_t)y * w + x] = ((ri >> 3) << 11) | ((gi >> 2) << 5) | (bi >> 3);
+        }
+    }
+    return frame;
+}
+
+// 讀回 8 位元 BMP, 檢查每個像素 = palette[lut[原色]], 回傳 PSNR (與原圖); 錯誤回傳 -1
+static double verify_bmp8(const std::string& path, const std::vector<uint16_t>& frame, uint16_t w, uint16_t h,
+                          const PaletteQuantizer& q) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return -1;
+    BMPHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.bpp != 8 || hdr.width != w || hdr.height != h || hdr.colorsUsed != q.colors) {
+        fclose(f);
+        return -1;
+    }
+    std::vector<uint8_t> table(hdr.colorsUsed * 4);
+    size_t row = (w + 3) & ~3;
+    std::vector<uint8_t> data(row * h);
+    bool ok = fread(table.data(), 1, table.size(), f) == table.size();
+    fseek(f, hdr.dataOffset, SEEK_SET);
+    ok = ok && fread(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    if (!ok) return -1;
+    double se = 0;
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++) {
+            uint16_t px = frame[(size_t)y * w + x];
+            uint8_t index = data[row * y + x];   // 與 writeBMP_RGB565 相同的行順序
+            if (index != q.lut[px] || index >= q.colors) return -1;
+            const uint8_t* bgr = &table[index * 4];
+            int ref[3] = { expand5(px >> 11), expand6((px >> 5) & 0x3F), expand5(px & 0x1F) };
+            for (int c = 0; c < 3; c++) se += (double)(ref[c] - bgr[2 - c]) * (ref[c] - bgr[2 - c]);
+        }
+    }
+    double mse = se / ((double)w * h * 3);
+    return mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+static bool run(const char* name, const std::vector<uint16_t>& frame, uint16_t w, uint16_t h, uint16_t colors, int runs,
+                FS& fs, const std::string& dir) {
+    static PaletteQuantizer q = {};
+    int64_t histogram_us = 0, build_us = 0;
+    for (int r = 0; r < runs; r++) {
+        palette_build(&q, frame.data(), frame.size(), colors);
+        histogram_us += q.histogram_us;
+        build_us += q.build_us;
+    }
+    int64_t t0 = esp_timer_get_time();
+    writeBMP_RGB565(fs, "palette24.bmp", frame.data(), w, h);
+    int64_t t1 = esp_timer_get_time();
+    writeBMP_Indexed8(fs, "palette8.bmp", frame.data(), w, h, q.lut, q.palette, q.colors);
+    int64_t t2 = esp_timer_get_time();
+    size_t bytes24 = file_size(dir + "/palette24.bmp"), bytes8 = file_size(dir + "/palette8.bmp");
+    double p = verify_bmp8(dir + "/palette8.bmp", frame, w, h, q);
+    bool lossless_expected = q.distinct <= colors;
+    if (q.colors > q.distinct) p = -1;   // 每個調色盤項目至少要有一種出現的顏色
+    printf("%-8s %6u %6u %7lld us %7lld us %7lld us %7lld us %8zu %8zu %5.1f%% %6.1f dB%s\n", name, q.distinct, q.colors,
+           (long long)(histogram_us / runs), (long long)(build_us / runs), (long long)(t1 - t0), (long long)(t2 - t1),
+           bytes24, bytes8, 100.0 * bytes8 / bytes24, p,
+           p < 0 ? "  FAILED" : lossless_expected && p < 99 ? "  not lossless" : "");
+    return p >= 0 && (!lossless_expected || p >= 99);
+}
+
+int main(int argc, char** argv) {
+    int arg = 1;
+    const char* image = nullptr;
+    if (argc > 1 && strstr(argv[1], ".bmp")) image = argv[arg++];
+    uint16_t colors = argc > arg ? atoi(argv[arg]) : 256;
+    int runs = argc > arg + 1 ? atoi(argv[arg + 1]) : 10;
+    std::string dir = argc > arg + 2 ? argv[arg + 2] : "/tmp";
+    FS fs(dir.c_str());
+
+    printf("%u colours, %d runs, files in %s\n", colors, runs, dir.c_str());
+    printf("%-8s %6s %6s %10s %10s %10s %10s %8s %8s %6s %9s\n", "frame", "unique", "colors", "histogram", "cut+lut",
+           "BMP24", "BMP8", "bytes24", "bytes8", "ratio", "PSNR");
+    bool ok = true;
+    if (image) {
+        std::vector<uint16_t> frame;
+        uint16_t w, h;
+        if (!load_bmp(image, frame, w, h)) {
+            fprintf(stderr, "cannot read %s\n", image);
+            return 1;
+        }
+        ok = run("image", frame, w, h, colors, runs, fs, dir);
+    } else {
+        ok = run("blocks", make_blocks(320, 240), 320, 240, colors, runs, fs, dir) && ok;
+        ok = run("g-step", make_g_step(320, 240), 320, 240, colors, runs, fs, dir) && ok;
+        ok = run("photo", make_photo(320, 240), 320, 240, colors, runs, fs, dir) && ok;
+        ok = run("odd", make_photo(101, 75), 101, 75, colors, runs, fs, dir) && ok;
+    }
+    printf("%s\n", ok ? "all 8-bit BMPs read back through the palette" : "FAILED");
+    return ok ? 0 : 1;
+}
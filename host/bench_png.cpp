@@ -0,0 +1,148 @@
+// ==================== PNG 寫檔基準測試 (Linux 主機) ====================
+// sd_read_write.cpp 的 writePNG_RGB565 (各壓縮等級) 與 writeBMP_RGB565 在同一張影像上比較時間與檔案大小。
+// 每個 PNG 都以 zlib 解壓、反濾波後與原圖逐像素比對 (並檢查每個區塊的 CRC), 確認無損。
+//
+//   bench_png [image.bmp | width height] [runs] [out_dir]
+// 沒有給影像時用合成影像 (漸層 + 平坦色塊 + 雜訊)。
+
+#include "Arduino.h"
+#include "FS.h"
+#include "sd_read_write.h"
+#include "bench_util.h"
+#include "../checksum.h"
+
+#include <zlib.h>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::vector<uint16_t> make_frame(uint16_t w, uint16_t h) {
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.0f, 3.0f);
+    std::vector<uint16_t> frame((size_t)w * h);
+    for (uint16_t y = 0; y < h; y++) {
+        for (uint16_t x = 0; x < w; x++) {
+            float r = 255.0f * x / w, g = 255.0f * y / h, b = 96;
+            if (x > w / 2 && y > h / 3) r = g = b = 40;          // 平坦區
+            else if (y < h / 2) {
+                r += noise(rng);
+                g += noise(rng);
+                b += noise(rng);
+            }
+            int ri = constrain((int)r, 0, 255), gi = constrain((int)g, 0, 255), bi = constrain((int)b, 0, 255);
+            frame[(size_t)y * w + x] = ((ri >> 3) << 11) | ((gi >> 2) << 5) | (bi >> 3);
+        }
+    }
+    return frame;
+}
+
+static uint32_t be32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static uint8_t paeth(int a, int b, int c) {
+    int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+// 解碼並與原圖比對; 回傳錯誤訊息 (nullptr 表示相同)
+static const char* verify_png(const std::string& path, const std::vector<uint16_t>& frame, uint16_t w, uint16_t h) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return "cannot open";
+    std::vector<uint8_t> file;
+    int c;
+    while ((c = fgetc(f)) != EOF) file.push_back(c);
+    fclose(f);
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (file.size() < 8 || memcmp(file.data(), signature, 8)) return "bad signature";
+    std::vector<uint8_t> idat;
+    bool iend = false;
+    for (size_t pos = 8; pos + 12 <= file.size() && !iend;) {
+        uint32_t len = be32(&file[pos]);
+        if (pos + 12 + len > file.size()) return "truncated chunk";
+        const uint8_t* type = &file[pos + 4];
+        if (crc32_update(0, type, 4 + len) != be32(&file[pos + 8 + len])) return "chunk CRC mismatch";
+        if (!memcmp(type, "IHDR", 4)) {
+            if (be32(type + 4) != w || be32(type + 8) != h || type[12] != 8 || type[13] != 2) return "bad IHDR";
+        } else if (!memcmp(type, "IDAT", 4)) {
+            idat.insert(idat.end(), type + 4, type + 4 + len);
+        } else if (!memcmp(type, "IEND", 4)) {
+            iend = true;
+        }
+        pos += 12 + len;
+    }
+    if (!iend) return "no IEND";
+    size_t stride = (size_t)w * 3 + 1;
+    std::vector<uint8_t> raw(stride * h + 1);
+    uLongf raw_len = raw.size();
+    if (uncompress(raw.data(), &raw_len, idat.data(), idat.size()) != Z_OK) return "inflate failed";
+    if (raw_len != stride * h) return "wrong data length";
+    std::vector<uint8_t> prior(w * 3, 0), cur(w * 3);
+    for (uint16_t y = 0; y < h; y++) {
+        const uint8_t* row = &raw[y * stride];
+        for (size_t i = 0; i < (size_t)w * 3; i++) {
+            int a = i >= 3 ? cur[i - 3] : 0, b = prior[i], cc = i >= 3 ? prior[i - 3] : 0;
+            uint8_t pred = row[0] == 0 ? 0 : row[0] == 1 ? a : row[0] == 2 ? b : row[0] == 3 ? (a + b) >> 1 : paeth(a, b, cc);
+            if (row[0] > 4) return "bad filter type";
+            cur[i] = row[1 + i] + pred;
+        }
+        for (uint16_t x = 0; x < w; x++) {
+            uint16_t px = frame[(size_t)y * w + x];
+            uint8_t r = px >> 11, g = (px >> 5) & 0x3F, b = px & 0x1F;
+            if (cur[3 * x] != ((r << 3) | (r >> 2)) || cur[3 * x + 1] != ((g << 2) | (g >> 4)) ||
+                cur[3 * x + 2] != ((b << 3) | (b >> 2))) {
+                return "pixel mismatch";
+            }
+        }
+        prior.swap(cur);
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint16_t> frame;
+    uint16_t w = 320, h = 240;
+    int arg = 1;
+    if (argc > 1 && strstr(argv[1], ".bmp")) {
+        if (!load_bmp(argv[1], frame, w, h)) {
+            fprintf(stderr, "cannot read %s\n", argv[1]);
+            return 1;
+        }
+        arg = 2;
+    } else {
+        if (argc > 2) {
+            w = atoi(argv[1]);
+            h = atoi(argv[2]);
+            arg = 3;
+        }
+        frame = make_frame(w, h);
+    }
+    int runs = argc > arg ? atoi(argv[arg]) : 10;
+    std::string dir = argc > arg + 1 ? argv[arg + 1] : "/tmp";
+    FS fs(dir.c_str());
+
+    printf("%ux%u, %d runs, files in %s\n", w, h, runs, dir.c_str());
+    printf("%-12s %9s %9s %7s\n", "format", "time", "bytes", "of BMP");
+    int64_t t0 = esp_timer_get_time();
+    for (int r = 0; r < runs; r++) writeBMP_RGB565(fs, "bench.bmp", frame.data(), w, h);
+    int64_t bmp_us = (esp_timer_get_time() - t0) / runs;
+    size_t bmp_bytes = file_size(dir + "/bench.bmp");
+    printf("%-12s %6lld us %9zu %6.1f%%\n", "BMP", (long long)bmp_us, bmp_bytes, 100.0);
+
+    static const char* names[] = { "PNG stored", "PNG rle", "PNG fast", "PNG best" };
+    bool ok = true;
+    for (uint8_t level = PNG_LEVEL_STORED; level <= PNG_LEVEL_BEST; level++) {
+        char name[32];
+        snprintf(name, sizeof(name), "bench_%u.png", level);
+        t0 = esp_timer_get_time();
+        for (int r = 0; r < runs; r++) writePNG_RGB565(fs, name, frame.data(), w, h, level);
+        int64_t us = (esp_timer_get_time() - t0) / runs;
+        size_t bytes = file_size(dir + "/" + name);
+        const char* err = verify_png(dir + "/" + name, frame, w, h);
+        printf("%-12s %6lld us %9zu %6.1f%%  %s\n", names[level], (long long)us, bytes, 100.0 * bytes / bmp_bytes,
+               err ? err : "lossless");
+        if (err) ok = false;
+    }
+    printf("%s\n", ok ? "all PNGs decoded by zlib and match the frame" : "FAILED");
+    return ok ? 0 : 1;
+}
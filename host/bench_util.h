@@ -0,0 +1,46 @@
+#ifndef __BENCH_UTIL_H
+#define __BENCH_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "Arduino.h"
+#include "sd_read_write.h"
+
+// ==================== 主機基準測試共用函式 ====================
+
+// 24/16 位元 BMP → 本機順序 RGB565
+static bool load_bmp(const char* path, std::vector<uint16_t>& frame, uint16_t& w, uint16_t& h) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    BMPHeader hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.signature == BMP_SIGNATURE && (hdr.bpp == 24 || hdr.bpp == 16);
+    if (ok) {
+        w = hdr.width;
+        h = abs(hdr.height);
+        size_t row = ((size_t)w * hdr.bpp / 8 + 3) & ~(size_t)3;
+        std::vector<uint8_t> data(row * h);
+        fseek(f, hdr.dataOffset, SEEK_SET);
+        ok = fread(data.data(), 1, data.size(), f) == data.size();
+        frame.resize((size_t)w * h);
+        for (uint16_t y = 0; y < h && ok; y++) {
+            const uint8_t* src = data.data() + row * (hdr.height > 0 ? h - 1 - y : y);
+            for (uint16_t x = 0; x < w; x++) {
+                frame[(size_t)y * w + x] = hdr.bpp == 16 ? (uint16_t)(src[2 * x] | src[2 * x + 1] << 8)
+                    : (uint16_t)(((src[3 * x + 2] >> 3) << 11) | ((src[3 * x + 1] >> 2) << 5) | (src[3 * x] >> 3));
+            }
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// 檔案不存在時回傳 0
+static size_t file_size(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+#endif
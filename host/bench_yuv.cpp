@@ -0,0 +1,99 @@
+// ==================== YUV422 色度旋轉基準測試 (Linux 主機) ====================
+// 同一張影像的兩條濾鏡管線 (全域色調 + 飽和度):
+//   RGB565: 載入 (複製) + HSV 全色調 ColorAdjustment
+//   YUV422: 載入時在 Cb/Cr 上做 2x2 變換並轉成 RGB565 (單一步驟)
+// 並比較兩者輸出的色調差, 以及恆等變換的轉換誤差。
+//
+//   bench_yuv [width height] [runs]
+
+#include "Arduino.h"
+#include "../img_computing.h"
+#include "../yuv_pipeline.h"
+
+#include <random>
+#include <vector>
+
+static void to_yuyv(const uint8_t* p0, const uint8_t* p1, uint8_t* out) {
+    auto luma = [](const uint8_t* p) { return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8; };
+    int r = (p0[0] + p1[0] + 1) / 2, g = (p0[1] + p1[1] + 1) / 2, b = (p0[2] + p1[2] + 1) / 2;
+    out[0] = luma(p0);
+    out[1] = constrain((-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8, 0, 255);
+    out[2] = luma(p1);
+    out[3] = constrain((128 * r - 107 * g - 21 * b + 32768 + 128) >> 8, 0, 255);
+}
+
+int main(int argc, char** argv) {
+    uint16_t width = argc > 2 ? atoi(argv[1]) : 320;
+    uint16_t height = argc > 2 ? atoi(argv[2]) : 240;
+    int runs = argc > 3 ? atoi(argv[3]) : argc == 2 ? atoi(argv[1]) : 50;
+    host_set_realtime(false);
+    const int16_t hue_shift = 43, sat_shift = 51, sat_q8 = 307;
+    uint32_t pixels = (uint32_t)width * height;
+
+    // 平滑的彩色場景 (同一對像素色度相近, 與感測器輸出相符)
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> rgb(pixels * 3);
+    for (uint16_t y = 0; y < height; y++) {
+        for (uint16_t x = 0; x < width; x++) {
+            uint8_t* p = &rgb[((size_t)y * width + x) * 3];
+            p[0] = (x * 255 / width + rng() % 8) & 0xFF;
+            p[1] = (y * 255 / height + rng() % 8) & 0xFF;
+            p[2] = ((x + y) * 2 + rng() % 8) & 0xFF;
+        }
+    }
+    std::vector<uint16_t> rgb565(pixels), yuyv(pixels), work(pixels);
+    for (uint32_t i = 0; i < pixels; i++) {
+        const uint8_t* p = &rgb[i * 3];
+        rgb565[i] = __builtin_bswap16((p[0] >> 3) << 11 | (p[1] >> 2) << 5 | (p[2] >> 3));
+    }
+    for (uint32_t i = 0; i + 1 < pixels; i += 2) {
+        to_yuyv(&rgb[i * 3], &rgb[(i + 1) * 3], (uint8_t*)&yuyv[i]);
+    }
+
+    ColorAdjustment global = { 0, (int8_t)hue_shift, 128, (int8_t)sat_shift };
+    int64_t rgb_us = 0;
+    for (int i = 0; i < runs; i++) {
+        int64_t start = esp_timer_get_time();
+        memcpy(work.data(), rgb565.data(), pixels * sizeof(uint16_t));
+        for (uint16_t& px : work) px = __builtin_bswap16(px);
+        adjust_multiple_colors_parallel(work.data(), pixels, &global, 1);
+        rgb_us += esp_timer_get_time() - start;
+    }
+    std::vector<uint16_t> hsv_out = work;
+
+    ChromaTransform ct;
+    chroma_transform_set(&ct, hue_shift, sat_q8);
+    int64_t yuv_us = 0;
+    for (int i = 0; i < runs; i++) {
+        int64_t start = esp_timer_get_time();
+        yuv422_to_rgb565_parallel((const uint8_t*)yuyv.data(), work.data(), pixels, &ct);
+        yuv_us += esp_timer_get_time() - start;
+    }
+
+    // 色調差 (只看飽和度夠的像素)
+    uint64_t hue_diff = 0;
+    uint32_t counted = 0;
+    for (uint32_t i = 0; i < pixels; i++) {
+        HSV a = rgb565_to_hsv(hsv_out[i]);
+        HSV b = rgb565_to_hsv(__builtin_bswap16(work[i]));
+        if (a.s < 64 || b.s < 64 || a.v < 64) continue;
+        uint8_t d = abs(a.h - b.h);
+        hue_diff += min<uint8_t>(d, 255 - d);
+        counted++;
+    }
+
+    // 恆等變換的轉換誤差 (與 RGB565 擷取比較, 8 位元尺度)
+    yuv422_to_rgb565_parallel((const uint8_t*)yuyv.data(), work.data(), pixels);
+    uint64_t err = 0;
+    for (uint32_t i = 0; i < pixels; i++) {
+        uint16_t a = __builtin_bswap16(rgb565[i]), b = __builtin_bswap16(work[i]);
+        err += abs((a >> 11) - (b >> 11)) * 8 + abs(((a >> 5) & 0x3F) - ((b >> 5) & 0x3F)) * 4 + abs((a & 0x1F) - (b & 0x1F)) * 8;
+    }
+
+    printf("%ux%u, %d runs, hue %+d, saturation %d/256\n", width, height, runs, hue_shift, sat_q8);
+    printf("  RGB565 + HSV     : %lld us/frame\n", (long long)(rgb_us / runs));
+    printf("  YUV422 + chroma  : %lld us/frame (%.1fx)\n", (long long)(yuv_us / runs), yuv_us ? (double)rgb_us / yuv_us : 0.0);
+    printf("  hue difference   : %.2f (0-255 scale, %u saturated pixels)\n", counted ? (double)hue_diff / counted : 0.0, counted);
+    printf("  identity error   : %.2f per channel (8-bit scale, incl. 4:2:2 chroma)\n", (double)err / pixels / 3);
+    return 0;
+}
@@ -0,0 +1,345 @@
+// ==================== 序列埠影像接收端 (Linux 主機) ====================
+// 接收 serial_export.h 的影像封包, 寫成 BMP 或 PNG, 每秒列出有效幀率與吞吐量。
+// 封包之間的其他位元組 (文字記錄、遠端控制回覆) 轉到 stderr; 用 magic + 標頭 CRC 重新同步,
+// 資料 CRC 錯誤或序號跳號後, DELTA 影像要等下一個關鍵幀才能還原。
+//
+//   frame_receiver [--input /dev/ttyACM0|file|-] [--baud N] [--out dir] [--format bmp|png]
+//                  [--every N] [--seconds N] [--quiet]
+//   (--input - 讀 stdin, 例如 camera_host --export 3 | frame_receiver --input -)
+
+#include "Arduino.h"
+#include "../serial_export.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static double now_s() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t get16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static uint32_t get32(const uint8_t* p) { return get16(p) | (get16(p + 2) << 16); }
+
+// ---------- 序列埠 ----------
+
+static speed_t baud_constant(int baud) {
+    switch (baud) {
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 1500000: return B1500000;
+        case 2000000: return B2000000;
+        case 3000000: return B3000000;
+        case 4000000: return B4000000;
+        default: return 0;
+    }
+}
+
+// 原始模式; USB-CDC (ttyACM) 不理會鮑率, UART 轉接器 (ttyUSB) 要與板子一致
+static int open_input(const char* path, int baud) {
+    if (!strcmp(path, "-")) return STDIN_FILENO;
+    int fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0 || !isatty(fd)) return fd;
+    termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        speed_t speed = baud_constant(baud);
+        if (speed) cfsetspeed(&tio, speed);
+        else fprintf(stderr, "unsupported baud %d, keeping the port setting\n", baud);
+        tcsetattr(fd, TCSANOW, &tio);
+        tcflush(fd, TCIFLUSH);
+    }
+    return fd;
+}
+
+// ---------- 輸出 ----------
+
+// 感測器位元組順序的 RGB565 → RGB888
+static void rgb565_to_rgb888(const uint8_t* src, size_t pixels, uint8_t* dst) {
+    for (size_t i = 0; i < pixels; i++) {
+        uint16_t v = (src[2 * i] << 8) | src[2 * i + 1];
+        uint8_t r = v >> 11, g = (v >> 5) & 0x3F, b = v & 0x1F;
+        dst[3 * i] = (r << 3) | (r >> 2);
+        dst[3 * i + 1] = (g << 2) | (g >> 4);
+        dst[3 * i + 2] = (b << 3) | (b >> 2);
+    }
+}
+
+static bool write_bmp(const char* path, const uint8_t* rgb, uint16_t w, uint16_t h) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    uint32_t row = (w * 3 + 3) & ~3u;
+    uint32_t size = 54 + row * h;
+    uint8_t hdr[54] = { 'B', 'M' };
+    auto put32 = [&](int off, uint32_t v) { for (int i = 0; i < 4; i++) hdr[off + i] = v >> (8 * i); };
+    put32(2, size);
+    put32(10, 54);
+    put32(14, 40);
+    put32(18, w);
+    put32(22, h);
+    hdr[26] = 1;
+    hdr[28] = 24;
+    put32(34, row * h);
+    fwrite(hdr, 1, 54, f);
+    std::vector<uint8_t> line(row, 0);
+    for (int y = h - 1; y >= 0; y--) {
+        const uint8_t* p = rgb + (size_t)y * w * 3;
+        for (uint16_t x = 0; x < w; x++) {
+            line[3 * x] = p[3 * x + 2];
+            line[3 * x + 1] = p[3 * x + 1];
+            line[3 * x + 2] = p[3 * x];
+        }
+        fwrite(line.data(), 1, row, f);
+    }
+    return fclose(f) == 0;
+}
+
+static void png_chunk(FILE* f, const char* type, const uint8_t* data, size_t len) {
+    uint8_t be[4] = { (uint8_t)(len >> 24), (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len };
+    fwrite(be, 1, 4, f);
+    fwrite(type, 1, 4, f);
+    if (len) fwrite(data, 1, len, f);
+    uLong crc = crc32(0, (const Bytef*)type, 4);
+    if (len) crc = crc32(crc, data, len);   // crc32(crc, NULL, 0) 會回傳初值, 不是 crc
+    uint8_t c[4] = { (uint8_t)(crc >> 24), (uint8_t)(crc >> 16), (uint8_t)(crc >> 8), (uint8_t)crc };
+    fwrite(c, 1, 4, f);
+}
+
+// RGB8, 每列濾波 0, zlib 壓縮
+static bool write_png(const char* path, const uint8_t* rgb, uint16_t w, uint16_t h) {
+    std::vector<uint8_t> raw((size_t)(w * 3 + 1) * h);
+    for (uint16_t y = 0; y < h; y++) {
+        raw[(size_t)y * (w * 3 + 1)] = 0;
+        memcpy(&raw[(size_t)y * (w * 3 + 1) + 1], rgb + (size_t)y * w * 3, w * 3);
+    }
+    uLongf zlen = compressBound(raw.size());
+    std::vector<uint8_t> z(zlen);
+    if (compress2(z.data(), &zlen, raw.data(), raw.size(), 6) != Z_OK) return false;
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(sig, 1, 8, f);
+    uint8_t ihdr[13] = { (uint8_t)(w >> 24), (uint8_t)(w >> 16), (uint8_t)(w >> 8), (uint8_t)w,
+                         (uint8_t)(h >> 24), (uint8_t)(h >> 16), (uint8_t)(h >> 8), (uint8_t)h, 8, 2, 0, 0, 0 };
+    png_chunk(f, "IHDR", ihdr, 13);
+    png_chunk(f, "IDAT", z.data(), zlen);
+    png_chunk(f, "IEND", nullptr, 0);
+    return fclose(f) == 0;
+}
+
+// ---------- 解碼 ----------
+
+// PackBits (16 位元像素) 解到 out (bytes); ref 非空時 XOR。長度不符回傳 false
+static bool rle_decode(const uint8_t* in, size_t len, uint8_t* out, size_t out_len, const uint8_t* ref) {
+    size_t i = 0, o = 0;
+    while (i < len) {
+        uint8_t c = in[i++];
+        if (c < 128) {
+            size_t n = 2 * (c + 1);
+            if (i + n > len || o + n > out_len) return false;
+            memcpy(out + o, in + i, n);
+            i += n;
+            o += n;
+        } else {
+            size_t n = c - 126;
+            if (i + 2 > len || o + 2 * n > out_len) return false;
+            for (size_t k = 0; k < n; k++, o += 2) {
+                out[o] = in[i];
+                out[o + 1] = in[i + 1];
+            }
+            i += 2;
+        }
+    }
+    if (o != out_len) return false;
+    if (ref) for (size_t k = 0; k < out_len; k++) out[k] ^= ref[k];
+    return true;
+}
+
+// mkdir -p
+static bool make_dirs(const std::string& path) {
+    for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+        std::string part = path.substr(0, pos);
+        if (!part.empty() && mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (pos == std::string::npos) break;
+    }
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+struct Stats {
+    uint32_t frames = 0;
+    uint32_t crc_errors = 0;
+    uint32_t gaps = 0;            // 序號跳號 (中途遺失的封包)
+    uint32_t waiting = 0;         // 等關鍵幀而丟掉的 DELTA 影像
+    uint64_t wire = 0;
+    uint64_t raw = 0;
+};
+
+int main(int argc, char** argv) {
+    const char* input = "/dev/ttyACM0";
+    const char* out_dir = nullptr;
+    const char* format = "bmp";
+    int baud = EXPORT_UART_BAUD;   // 板子開啟匯出後 UART 的鮑率
+    uint32_t every = 1;
+    double seconds = 0;
+    bool quiet = false;
+    for (int i = 1; i < argc; i++) {
+        bool has_arg = i + 1 < argc;
+        if (!strcmp(argv[i], "--input") && has_arg) input = argv[++i];
+        else if (!strcmp(argv[i], "--baud") && has_arg) baud = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--out") && has_arg) out_dir = argv[++i];
+        else if (!strcmp(argv[i], "--format") && has_arg) format = argv[++i];
+        else if (!strcmp(argv[i], "--every") && has_arg) every = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--seconds") && has_arg) seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--quiet")) quiet = true;
+        else {
+            fprintf(stderr, "usage: %s [--input /dev/ttyACM0|file|-] [--baud N] [--out dir] [--format bmp|png]\n"
+                            "          [--every N] [--seconds N] [--quiet]\n", argv[0]);
+            return 1;
+        }
+    }
+    bool png = !strcmp(format, "png");
+    if (out_dir && !make_dirs(out_dir)) {
+        fprintf(stderr, "cannot create output directory %s: %s\n", out_dir, strerror(errno));
+        return 1;
+    }
+    int fd = open_input(input, baud);
+    if (fd < 0) {
+        perror(input);
+        return 1;
+    }
+
+    std::vector<uint8_t> buf;
+    std::vector<uint8_t> frame, previous, rgb;
+    bool have_previous = false;
+    uint32_t last_seq = 0;
+    Stats total, window;
+    double start = now_s(), tick = start;
+    uint8_t chunk[16384];
+
+    for (;;) {
+        if (seconds > 0 && now_s() - start >= seconds) break;
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0) break;
+        buf.insert(buf.end(), chunk, chunk + n);
+
+        size_t pos = 0;
+        while (buf.size() - pos >= EXPORT_HEADER_LEN) {
+            // 找 magic; 之前的位元組是文字
+            const uint8_t* p = &buf[pos];
+            if (p[0] != EXPORT_MAGIC0 || p[1] != EXPORT_MAGIC1 || p[2] != EXPORT_MAGIC2 || p[3] != EXPORT_MAGIC3) {
+                const uint8_t* m = (const uint8_t*)memchr(p + 1, EXPORT_MAGIC0, buf.size() - pos - 1);
+                size_t skip = m ? m - p : buf.size() - pos;
+                if (!quiet) fwrite(p, 1, skip, stderr);
+                pos += skip;
+                continue;
+            }
+            uint16_t w = get16(p + 12), h = get16(p + 14);
+            uint32_t len = get32(p + 20);
+            size_t raw = (size_t)w * h * 2;
+            if (get32(p + 24) != crc32(0, p, 24) || p[4] != EXPORT_VERSION || len > raw || p[6] != EXPORT_FORMAT_RGB565_BE) {
+                if (!quiet) fwrite(p, 1, 1, stderr);
+                pos++;
+                continue;
+            }
+            if (buf.size() - pos < EXPORT_HEADER_LEN + len + 4) break;   // 等剩下的資料
+            const uint8_t* payload = p + EXPORT_HEADER_LEN;
+            uint8_t codec = p[5];
+            bool keyframe = p[7] & EXPORT_FLAG_KEYFRAME;
+            uint32_t seq = get32(p + 8);
+            pos += EXPORT_HEADER_LEN + len + 4;
+            window.wire += EXPORT_HEADER_LEN + len + 4;
+            if (last_seq && seq != last_seq + 1) {
+                window.gaps++;
+                have_previous = false;
+            }
+            last_seq = seq;
+            if (get32(payload + len) != crc32(0, payload, len)) {
+                window.crc_errors++;
+                have_previous = false;
+                continue;
+            }
+
+            frame.resize(raw);
+            bool ok = true;
+            if (codec == EXPORT_RAW) {
+                ok = len == raw;
+                if (ok) memcpy(frame.data(), payload, raw);
+            } else if (codec == EXPORT_RLE || (codec == EXPORT_DELTA && keyframe)) {
+                ok = rle_decode(payload, len, frame.data(), raw, nullptr);
+            } else if (codec == EXPORT_DELTA) {
+                if (!have_previous || previous.size() != raw) {
+                    window.waiting++;
+                    continue;
+                }
+                ok = rle_decode(payload, len, frame.data(), raw, previous.data());
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                window.crc_errors++;
+                have_previous = false;
+                continue;
+            }
+            previous.swap(frame);
+            have_previous = true;
+            window.frames++;
+            window.raw += raw;
+
+            if (out_dir && (total.frames + window.frames - 1) % every == 0) {
+                rgb.resize((size_t)w * h * 3);
+                rgb565_to_rgb888(previous.data(), (size_t)w * h, rgb.data());
+                char path[512];
+                snprintf(path, sizeof(path), "%s/frame_%06u.%s", out_dir, seq, png ? "png" : "bmp");
+                if (!(png ? write_png(path, rgb.data(), w, h) : write_bmp(path, rgb.data(), w, h))) {
+                    fprintf(stderr, "cannot write %s\n", path);
+                }
+            }
+        }
+        buf.erase(buf.begin(), buf.begin() + pos);
+
+        double t = now_s();
+        if (t - tick >= 1.0) {
+            printf("%5.1f s: %5.1f fps, %7.1f KB/s, ratio %.2f, %u CRC errors, %u gaps, %u waiting for keyframe\n", t - start,
+                   window.frames / (t - tick), window.wire / 1024.0 / (t - tick), window.wire ? (double)window.raw / window.wire : 0.0,
+                   window.crc_errors, window.gaps, window.waiting);
+            fflush(stdout);
+            total.frames += window.frames;
+            total.crc_errors += window.crc_errors;
+            total.gaps += window.gaps;
+            total.waiting += window.waiting;
+            total.wire += window.wire;
+            total.raw += window.raw;
+            window = Stats();
+            tick = t;
+        }
+    }
+    total.frames += window.frames;
+    total.crc_errors += window.crc_errors;
+    total.gaps += window.gaps;
+    total.waiting += window.waiting;
+    total.wire += window.wire;
+    total.raw += window.raw;
+    double elapsed = now_s() - start;
+    printf("total: %u frames in %.1f s (%.1f fps), %.1f KB/s, ratio %.2f, %u CRC errors, %u gaps, %u waiting for keyframe\n",
+           total.frames, elapsed, total.frames / elapsed, total.wire / 1024.0 / elapsed,
+           total.wire ? (double)total.raw / total.wire : 0.0, total.crc_errors, total.gaps, total.waiting);
+    return 0;
+}
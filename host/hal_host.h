@@ -0,0 +1,519 @@
+#ifndef __HAL_HOST_H
+#define __HAL_HOST_H
+
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "Arduino.h"
+#include "SD_MMC.h"
+#include "esp_camera.h"
+#include "../hal.h"
+
+// ==================== Linux 主機版實作 ====================
+// 相機: 重播 BMP (24/16 位元) 或原始 RGB565 (.rgb565, 小端序) 檔案,
+//       依目前 frame_size 以最近鄰縮放後預先轉成感測器位元組順序 (大端序);
+//       沒有輸入檔時產生移動的彩色漸層。支援 PIXFORMAT_RGB565 與 PIXFORMAT_YUV422 (YUYV)。
+// 儲存: 以本機目錄作為 SD 卡根目錄。
+// 螢幕: 每 N 幀把推送的影像 (含疊加的外框) 寫成 BMP, 或直接丟棄。
+// 類比輸入: 固定值。
+// 網路: 有設定 SSID (任意字串) 就視為連線, 位址為 127.0.0.1 (socket 直接用 POSIX)。
+
+#ifndef TFT_BLACK
+#define TFT_BLACK 0x0000
+#endif
+#ifndef TFT_WHITE
+#define TFT_WHITE 0xFFFF
+#endif
+#ifndef TFT_GREEN
+#define TFT_GREEN 0x07E0
+#endif
+#ifndef TFT_RED
+#define TFT_RED   0xF800
+#endif
+
+#define HOST_CAMERA_SYNTHETIC_FRAMES 8
+
+// 來源影像 (RGB888), 縮放後快取成目前解析度的 fb
+struct HostImage {
+    uint16_t width;
+    uint16_t height;
+    std::vector<uint8_t> rgb;
+};
+
+static bool host_load_bmp(const char* path, HostImage* img) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return false;
+    uint8_t header[54];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) || header[0] != 'B' || header[1] != 'M') {
+        fclose(fp);
+        return false;
+    }
+    uint32_t offset = header[10] | header[11] << 8 | header[12] << 16 | header[13] << 24;
+    int32_t width = header[18] | header[19] << 8 | header[20] << 16 | header[21] << 24;
+    int32_t height = header[22] | header[23] << 8 | header[24] << 16 | header[25] << 24;
+    uint16_t bpp = header[28] | header[29] << 8;
+    bool bottom_up = height > 0;
+    height = abs(height);
+    if ((bpp != 24 && bpp != 16) || width <= 0 || height == 0) {
+        fclose(fp);
+        return false;
+    }
+
+    size_t row_size = ((size_t)width * (bpp / 8) + 3) & ~3;
+    std::vector<uint8_t> row(row_size);
+    img->width = width;
+    img->height = height;
+    img->rgb.resize((size_t)width * height * 3);
+    fseek(fp, offset, SEEK_SET);
+    for (int32_t y = 0; y < height; y++) {
+        if (fread(row.data(), 1, row_size, fp) != row_size) break;
+        uint8_t* dst = &img->rgb[(size_t)(bottom_up ? height - 1 - y : y) * width * 3];
+        for (int32_t x = 0; x < width; x++) {
+            if (bpp == 24) {
+                dst[x * 3 + 0] = row[x * 3 + 2];
+                dst[x * 3 + 1] = row[x * 3 + 1];
+                dst[x * 3 + 2] = row[x * 3 + 0];
+            } else {
+                uint16_t p = row[x * 2] | row[x * 2 + 1] << 8;
+                dst[x * 3 + 0] = ((p >> 11) & 0x1F) << 3;
+                dst[x * 3 + 1] = ((p >> 5) & 0x3F) << 2;
+                dst[x * 3 + 2] = (p & 0x1F) << 3;
+            }
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+// 原始 RGB565 沒有標頭: 依檔案大小從解析度表找出尺寸
+static bool host_load_rgb565(const char* path, HostImage* img) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return false;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    int fs = FRAMESIZE_INVALID;
+    for (int i = 0; i < FRAMESIZE_INVALID; i++) {
+        if ((long)resolution[i].width * resolution[i].height * 2 == size) {
+            fs = i;
+            break;
+        }
+    }
+    if (fs == FRAMESIZE_INVALID) {
+        fclose(fp);
+        return false;
+    }
+    std::vector<uint8_t> raw(size);
+    bool ok = fread(raw.data(), 1, size, fp) == (size_t)size;
+    fclose(fp);
+    img->width = resolution[fs].width;
+    img->height = resolution[fs].height;
+    img->rgb.resize((size_t)img->width * img->height * 3);
+    for (size_t i = 0; i < (size_t)img->width * img->height; i++) {
+        uint16_t p = raw[i * 2] | raw[i * 2 + 1] << 8;
+        img->rgb[i * 3 + 0] = ((p >> 11) & 0x1F) << 3;
+        img->rgb[i * 3 + 1] = ((p >> 5) & 0x3F) << 2;
+        img->rgb[i * 3 + 2] = (p & 0x1F) << 3;
+    }
+    return ok;
+}
+
+static bool host_ends_with(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+class HostCamera : public CameraSource {
+public:
+    HostCamera() {
+        memset(&sensorState, 0, sizeof(sensorState));
+        memset(registers, 0, sizeof(registers));
+    }
+
+    // 檔案或目錄 (目錄內的 .bmp / .rgb565 依檔名排序); 必須在 init 前呼叫
+    bool setInput(const char* path) {
+        sources.clear();
+        struct stat st;
+        if (stat(path, &st) != 0) return false;
+        std::vector<std::string> files;
+        if (S_ISDIR(st.st_mode)) {
+            DIR* dir = opendir(path);
+            struct dirent* entry;
+            while (dir && (entry = readdir(dir)) != nullptr) {
+                std::string name = entry->d_name;
+                if (host_ends_with(name, ".bmp") || host_ends_with(name, ".rgb565")) files.push_back(std::string(path) + "/" + name);
+            }
+            if (dir) closedir(dir);
+            std::sort(files.begin(), files.end());
+        } else {
+            files.push_back(path);
+        }
+        for (const std::string& file : files) {
+            HostImage img;
+            bool ok = host_ends_with(file, ".rgb565") ? host_load_rgb565(file.c_str(), &img) : host_load_bmp(file.c_str(), &img);
+            if (ok) sources.push_back(img);
+            else Serial.printf("Skipping unreadable input %s\n", file.c_str());
+        }
+        return !sources.empty();
+    }
+
+    esp_err_t init(const camera_config_t* config) override {
+        if (!supported(config->pixel_format)) return ESP_ERR_NOT_SUPPORTED;
+        pixelFormat = config->pixel_format;
+        initSensor(config);
+        if (sources.empty()) makeSynthetic();
+        return rebuildFrames(config->frame_size) ? ESP_OK : ESP_ERR_NO_MEM;
+    }
+
+    void deinit() override { frames.clear(); }
+
+    // 曝光模型: 手動曝光時, 輸入影像視為 aec_value x (agc_gain + 1) = reference 時拍到的畫面,
+    // 其他曝光以 gamma 2.2 換算亮度倍率並截在 255, 讓 AE 與 HDR 包圍曝光看得到曝光變化。0 = 關閉 (預設)
+    void setExposureModel(int reference) { exposureReference = reference; }
+
+    camera_fb_t* grab() override {
+        if (frames.empty()) return nullptr;
+        camera_fb_t* fb = &fbs[grabCount & 1];
+        std::vector<uint16_t>& frame = frames[grabCount % frames.size()];
+        fb->buf = (uint8_t*)frame.data();
+        if (exposureReference > 0 && !sensorState.s.status.aec) fb->buf = (uint8_t*)expose(frame, grabCount & 1);
+        fb->len = frame.size() * sizeof(uint16_t);
+        fb->width = frameWidth;
+        fb->height = frameHeight;
+        fb->format = pixelFormat;
+        int64_t now = esp_timer_get_time();
+        fb->timestamp.tv_sec = now / 1000000;
+        fb->timestamp.tv_usec = now % 1000000;
+        grabCount++;
+        return fb;
+    }
+
+    void release(camera_fb_t*) override {}
+
+    sensor_t* sensor() override { return frames.empty() ? nullptr : &sensorState.s; }
+
+    uint32_t framesGrabbed() const { return grabCount; }
+
+private:
+    // sensor_t 必須是第一個成員, 讓回呼可由 sensor_t* 找回相機
+    struct HostSensor {
+        sensor_t s;
+        HostCamera* camera;
+    };
+
+    static HostCamera* owner(sensor_t* s) { return ((HostSensor*)s)->camera; }
+
+#define HOST_SENSOR_SETTER(name, field) \
+    static int name(sensor_t* s, int v) { s->status.field = v; return 0; }
+    HOST_SENSOR_SETTER(setContrast, contrast)
+    HOST_SENSOR_SETTER(setBrightness, brightness)
+    HOST_SENSOR_SETTER(setSaturation, saturation)
+    HOST_SENSOR_SETTER(setSharpness, sharpness)
+    HOST_SENSOR_SETTER(setDenoise, denoise)
+    HOST_SENSOR_SETTER(setQuality, quality)
+    HOST_SENSOR_SETTER(setColorbar, colorbar)
+    HOST_SENSOR_SETTER(setWhitebal, awb)
+    HOST_SENSOR_SETTER(setGainCtrl, agc)
+    HOST_SENSOR_SETTER(setExposureCtrl, aec)
+    HOST_SENSOR_SETTER(setHmirror, hmirror)
+    HOST_SENSOR_SETTER(setVflip, vflip)
+    HOST_SENSOR_SETTER(setAec2, aec2)
+    HOST_SENSOR_SETTER(setAwbGain, awb_gain)
+    HOST_SENSOR_SETTER(setAgcGain, agc_gain)
+    HOST_SENSOR_SETTER(setAecValue, aec_value)
+    HOST_SENSOR_SETTER(setSpecialEffect, special_effect)
+    HOST_SENSOR_SETTER(setWbMode, wb_mode)
+    HOST_SENSOR_SETTER(setAeLevel, ae_level)
+    HOST_SENSOR_SETTER(setDcw, dcw)
+    HOST_SENSOR_SETTER(setBpc, bpc)
+    HOST_SENSOR_SETTER(setWpc, wpc)
+    HOST_SENSOR_SETTER(setRawGma, raw_gma)
+    HOST_SENSOR_SETTER(setLenc, lenc)
+#undef HOST_SENSOR_SETTER
+
+    static int setGainceiling(sensor_t* s, gainceiling_t g) { s->status.gainceiling = g; return 0; }
+    static bool supported(pixformat_t f) { return f == PIXFORMAT_RGB565 || f == PIXFORMAT_YUV422; }
+    static int setPixformat(sensor_t* s, pixformat_t f) {
+        if (!supported(f)) return -1;
+        s->pixformat = f;
+        owner(s)->pixelFormat = f;
+        return owner(s)->rebuildFrames((framesize_t)s->status.framesize) ? 0 : -1;
+    }
+    static int setFramesize(sensor_t* s, framesize_t f) { return owner(s)->rebuildFrames(f) ? 0 : -1; }
+    static int getReg(sensor_t* s, int reg, int mask) { return owner(s)->registers[reg & 0xFFFF] & mask; }
+    static int setReg(sensor_t* s, int reg, int mask, int value) {
+        uint8_t& r = owner(s)->registers[reg & 0xFFFF];
+        r = (r & ~mask) | (value & mask);
+        return 0;
+    }
+
+    void initSensor(const camera_config_t* config) {
+        sensor_t* s = &sensorState.s;
+        memset(s, 0, sizeof(sensor_t));
+        sensorState.camera = this;
+        s->id.PID = 0;                    // 不是任何已知型號, 型號專屬的暫存器路徑會被略過
+        s->pixformat = config->pixel_format;
+        s->xclk_freq_hz = config->xclk_freq_hz;
+        s->status.framesize = config->frame_size;
+        s->status.awb = s->status.aec = s->status.agc = 1;
+        s->set_pixformat = setPixformat;
+        s->set_framesize = setFramesize;
+        s->set_contrast = setContrast;
+        s->set_brightness = setBrightness;
+        s->set_saturation = setSaturation;
+        s->set_sharpness = setSharpness;
+        s->set_denoise = setDenoise;
+        s->set_gainceiling = setGainceiling;
+        s->set_quality = setQuality;
+        s->set_colorbar = setColorbar;
+        s->set_whitebal = setWhitebal;
+        s->set_gain_ctrl = setGainCtrl;
+        s->set_exposure_ctrl = setExposureCtrl;
+        s->set_hmirror = setHmirror;
+        s->set_vflip = setVflip;
+        s->set_aec2 = setAec2;
+        s->set_awb_gain = setAwbGain;
+        s->set_agc_gain = setAgcGain;
+        s->set_aec_value = setAecValue;
+        s->set_special_effect = setSpecialEffect;
+        s->set_wb_mode = setWbMode;
+        s->set_ae_level = setAeLevel;
+        s->set_dcw = setDcw;
+        s->set_bpc = setBpc;
+        s->set_wpc = setWpc;
+        s->set_raw_gma = setRawGma;
+        s->set_lenc = setLenc;
+        s->get_reg = getReg;
+        s->set_reg = setReg;
+    }
+
+    void makeSynthetic() {
+        for (int i = 0; i < HOST_CAMERA_SYNTHETIC_FRAMES; i++) {
+            HostImage img;
+            img.width = 320;
+            img.height = 240;
+            img.rgb.resize(320 * 240 * 3);
+            for (int y = 0; y < 240; y++) {
+                for (int x = 0; x < 320; x++) {
+                    uint8_t* p = &img.rgb[(y * 320 + x) * 3];
+                    p[0] = (x + i * 8) & 0xFF;
+                    p[1] = (y + i * 4) & 0xFF;
+                    p[2] = ((x ^ y) + i * 16) & 0xFF;
+                }
+            }
+            sources.push_back(img);
+        }
+    }
+
+    // 最近鄰縮放到 frame_size 並轉成大端序 RGB565 或 YUYV
+    bool rebuildFrames(framesize_t frame_size) {
+        if (frame_size >= FRAMESIZE_INVALID || sources.empty()) return false;
+        frameWidth = resolution[frame_size].width;
+        frameHeight = resolution[frame_size].height;
+        sensorState.s.status.framesize = frame_size;
+        frames.assign(sources.size(), std::vector<uint16_t>((size_t)frameWidth * frameHeight));
+        for (size_t i = 0; i < sources.size(); i++) {
+            const HostImage& src = sources[i];
+            uint16_t* dst = frames[i].data();
+            for (uint16_t y = 0; y < frameHeight; y++) {
+                const uint8_t* row = &src.rgb[(size_t)(y * src.height / frameHeight) * src.width * 3];
+                if (pixelFormat == PIXFORMAT_YUV422) {
+                    uint8_t* out = (uint8_t*)dst;
+                    for (uint16_t x = 0; x + 1 < frameWidth; x += 2) {
+                        const uint8_t* p0 = row + (size_t)(x * src.width / frameWidth) * 3;
+                        const uint8_t* p1 = row + (size_t)((x + 1) * src.width / frameWidth) * 3;
+                        toYuyv(p0, p1, out);
+                        out += 4;
+                    }
+                    dst += frameWidth;
+                    continue;
+                }
+                for (uint16_t x = 0; x < frameWidth; x++) {
+                    const uint8_t* p = row + (size_t)(x * src.width / frameWidth) * 3;
+                    uint16_t c = (p[0] >> 3) << 11 | (p[1] >> 2) << 5 | (p[2] >> 3);
+                    *dst++ = __builtin_bswap16(c);
+                }
+            }
+        }
+        return true;
+    }
+
+    uint16_t* expose(const std::vector<uint16_t>& frame, int slot) {
+        const camera_status_t& st = sensorState.s.status;
+        float ratio = (float)max<int>(st.aec_value, 1) * (st.agc_gain + 1) / exposureReference;
+        uint32_t scale_q8 = (uint32_t)(256.0f * powf(ratio, 1.0f / 2.2f) + 0.5f);
+        std::vector<uint16_t>& out = exposed[slot];
+        out.resize(frame.size());
+        if (pixelFormat == PIXFORMAT_YUV422) {
+            const uint8_t* src = (const uint8_t*)frame.data();
+            uint8_t* dst = (uint8_t*)out.data();
+            for (size_t i = 0; i < frame.size() * 2; i += 2) {
+                dst[i] = min<uint32_t>((src[i] * scale_q8 + 128) >> 8, 255);
+                dst[i + 1] = src[i + 1];
+            }
+            return out.data();
+        }
+        for (size_t i = 0; i < frame.size(); i++) {
+            uint16_t c = __builtin_bswap16(frame[i]);
+            uint32_t r = min<uint32_t>((((c >> 11) << 3) * scale_q8 + 128) >> 8, 255);
+            uint32_t g = min<uint32_t>(((((c >> 5) & 0x3F) << 2) * scale_q8 + 128) >> 8, 255);
+            uint32_t b = min<uint32_t>((((c & 0x1F) << 3) * scale_q8 + 128) >> 8, 255);
+            out[i] = __builtin_bswap16((uint16_t)((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3)));
+        }
+        return out.data();
+    }
+
+    // BT.601 全範圍 (JFIF), 兩個像素的色度取平均
+    static void toYuyv(const uint8_t* p0, const uint8_t* p1, uint8_t* out) {
+        auto luma = [](const uint8_t* p) { return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8; };
+        int r = (p0[0] + p1[0] + 1) / 2, g = (p0[1] + p1[1] + 1) / 2, b = (p0[2] + p1[2] + 1) / 2;
+        out[0] = luma(p0);
+        out[1] = constrain((-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8, 0, 255);
+        out[2] = luma(p1);
+        out[3] = constrain((128 * r - 107 * g - 21 * b + 32768 + 128) >> 8, 0, 255);
+    }
+
+    std::vector<HostImage> sources;
+    std::vector<std::vector<uint16_t>> frames;
+    pixformat_t pixelFormat = PIXFORMAT_RGB565;
+    uint16_t frameWidth = 0;
+    uint16_t frameHeight = 0;
+    uint32_t grabCount = 0;
+    camera_fb_t fbs[2] = {};
+    int exposureReference = 0;
+    std::vector<uint16_t> exposed[2];   // 曝光模型的輸出, 每個 fb 一份
+    HostSensor sensorState;
+    uint8_t registers[0x10000];
+};
+
+class DirectoryStorage : public Storage {
+public:
+    void setRoot(const char* dir) { SD_MMC.setRoot(dir); }
+    bool begin() override { return SD_MMC.begin(); }
+    fs::FS& fs() override { return SD_MMC; }
+};
+
+class HostDisplay : public Display {
+public:
+    ~HostDisplay() { flush(); }
+
+    // dir 為 nullptr 時丟棄所有影像; every 為每幾次推送寫一張
+    void setOutput(const char* dir, uint32_t every) {
+        outputDir = dir ? dir : "";
+        dumpEvery = every ? every : 1;
+        if (!outputDir.empty()) mkdir(outputDir.c_str(), 0755);
+    }
+
+    bool begin() override { return true; }
+
+    // 影像先留在記憶體, 讓之後的 drawRect (疊加外框) 也畫進去, 下一次推送時才寫檔
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data) override {
+        flush();
+        if (outputDir.empty() || pushCount++ % dumpEvery != 0) return;
+        pending.assign(data, data + (size_t)w * h);
+        pendingX = x;
+        pendingY = y;
+        pendingW = w;
+        pendingH = h;
+    }
+
+    void fillScreen(uint16_t) override {}
+
+    void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t color) override {
+        if (pending.empty()) return;
+        uint16_t c = __builtin_bswap16(color);
+        for (int32_t i = 0; i < w; i++) {
+            plot(x + i, y, c);
+            plot(x + i, y + h - 1, c);
+        }
+        for (int32_t j = 0; j < h; j++) {
+            plot(x, y + j, c);
+            plot(x + w - 1, y + j, c);
+        }
+    }
+
+    void println(const char* text) override { Serial.printf("[tft] %s\n", text); }
+
+private:
+    void plot(int32_t x, int32_t y, uint16_t c) {
+        x -= pendingX;
+        y -= pendingY;
+        if (x >= 0 && y >= 0 && x < pendingW && y < pendingH) pending[(size_t)y * pendingW + x] = c;
+    }
+
+    void flush() {
+        if (pending.empty()) return;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/frame_%05u.bmp", outputDir.c_str(), dumpCount++);
+        writeBmp(path, pendingW, pendingH, pending.data());
+        pending.clear();
+    }
+
+    static void writeBmp(const char* path, int32_t w, int32_t h, const uint16_t* data) {
+        FILE* fp = fopen(path, "wb");
+        if (!fp) return;
+        uint32_t row_size = (w * 3 + 3) & ~3;
+        uint32_t image_size = row_size * h;
+        uint8_t header[54] = {'B', 'M'};
+        uint32_t file_size = 54 + image_size;
+        memcpy(&header[2], &file_size, 4);
+        header[10] = 54;
+        header[14] = 40;
+        memcpy(&header[18], &w, 4);
+        int32_t top_down = -h;
+        memcpy(&header[22], &top_down, 4);
+        header[26] = 1;
+        header[28] = 24;
+        memcpy(&header[34], &image_size, 4);
+        fwrite(header, 1, sizeof(header), fp);
+        std::vector<uint8_t> row(row_size, 0);
+        for (int32_t y = 0; y < h; y++) {
+            for (int32_t x = 0; x < w; x++) {
+                uint16_t p = __builtin_bswap16(data[y * w + x]);
+                row[x * 3 + 0] = (p & 0x1F) << 3;
+                row[x * 3 + 1] = ((p >> 5) & 0x3F) << 2;
+                row[x * 3 + 2] = ((p >> 11) & 0x1F) << 3;
+            }
+            fwrite(row.data(), 1, row_size, fp);
+        }
+        fclose(fp);
+    }
+
+    std::string outputDir;
+    uint32_t dumpEvery = 1;
+    uint32_t pushCount = 0;
+    uint32_t dumpCount = 0;
+    std::vector<uint16_t> pending;
+    int32_t pendingX = 0;
+    int32_t pendingY = 0;
+    int32_t pendingW = 0;
+    int32_t pendingH = 0;
+};
+
+class HostInput : public AnalogInput {
+public:
+    explicit HostInput(uint8_t pin) : pin(pin) {}
+    uint16_t read() override { return analogRead(pin); }
+
+private:
+    uint8_t pin;
+};
+
+class LoopbackNetwork : public Network {
+public:
+    bool begin(const char* ssid, const char*) override { return up = ssid && ssid[0]; }
+    bool connected() override { return up; }
+    const char* address() override { return "127.0.0.1"; }
+
+private:
+    bool up = false;
+};
+
+typedef HostCamera PlatformCamera;
+typedef DirectoryStorage PlatformStorage;
+typedef HostDisplay PlatformDisplay;
+typedef HostInput PlatformInput;
+typedef LoopbackNetwork PlatformNetwork;
+
+#endif
@@ -0,0 +1,105 @@
+// ==================== Linux 主機版進入點 ====================
+// 把整個 sketch 編進來, 以 HAL 的主機實作跑 setup() + loop(), 量測每次 loop() 的耗時。
+//
+//   camera_host [--input file|dir] [--frames N] [--storage dir] [--display dir|none]
+//               [--display-every N] [--filter] [--capture-every N] [--value 0-4095] [--mode N] [--http-port N] [--realtime]
+//               [--export 0-3] [--timelapse ms] [--hdr] [--exposure ref]
+
+#include "Arduino.h"
+#include "../Camera_LCD.ino"
+
+#include <vector>
+
+static void usage(const char* argv0) {
+    printf("usage: %s [--input file|dir] [--frames N] [--storage dir] [--display dir|none]\n"
+           "          [--display-every N] [--filter] [--capture-every N] [--value 0-4095] [--mode N] [--http-port N] [--realtime]\n"
+           "          [--export 0-3] [--timelapse ms] [--hdr] [--exposure ref]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* input = nullptr;
+    const char* storage = "sdcard";
+    const char* display = "none";
+    uint32_t frames = 300;
+    uint32_t display_every = 30;
+    uint32_t capture_every = 0;
+    int value = 2048;
+    bool filter = false;
+    bool realtime = false;
+    int mode = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_arg = i + 1 < argc;
+        if (!strcmp(argv[i], "--input") && has_arg) input = argv[++i];
+        else if (!strcmp(argv[i], "--frames") && has_arg) frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--storage") && has_arg) storage = argv[++i];
+        else if (!strcmp(argv[i], "--display") && has_arg) display = argv[++i];
+        else if (!strcmp(argv[i], "--display-every") && has_arg) display_every = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--capture-every") && has_arg) capture_every = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--timelapse") && has_arg) TimeLapseInterval = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--value") && has_arg) value = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--mode") && has_arg) mode = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--http-port") && has_arg) {
+            // 控制埠 N, 串流埠 N + 1 (迴路網路)
+            HttpControlPort = atoi(argv[++i]);
+            HttpStreamPort = HttpControlPort + 1;
+            WifiSsid = "loopback";
+        }
+        else if (!strcmp(argv[i], "--export") && has_arg) {
+            // 影像封包與文字記錄一起寫到 stdout, 可直接接到 host/frame_receiver
+            SerialExportCodec = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--exposure") && has_arg) {
+            // 輸入影像的曝光量, 見 HostCamera::setExposureModel
+            halCamera.setExposureModel(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--hdr")) HdrBracketing = true;
+        else if (!strcmp(argv[i], "--filter")) filter = true;
+        else if (!strcmp(argv[i], "--realtime")) realtime = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    host_set_realtime(realtime);
+    host_set_pin(Value_PIN, value);
+    host_set_pin(NormalMode_PIN, filter ? LOW : HIGH);
+    if (input && !halCamera.setInput(input)) {
+        fprintf(stderr, "No readable frames in %s\n", input);
+        return 1;
+    }
+    halStorage.setRoot(storage);
+    halDisplay.setOutput(strcmp(display, "none") ? display : nullptr, display_every);
+
+    setup();
+    if (!cameraReady) return 1;
+    // 切換到 cameraModes[mode] (主機相機不支援的格式會回復原模式)
+    if (mode > 0) switchCameraMode(mode);
+
+    std::vector<int64_t> times;
+    times.reserve(frames);
+    for (uint32_t i = 0; i < frames; i++) {
+        // 拍照鍵按一次存檔, 再按一次解除畫面凍結 (模擬的按鍵不需要去彈跳)
+        if ((capture_every && i % capture_every == 0) || captureRequested == 2) {
+            debounceCapture.last_edge_us = INT64_MIN / 2;
+            host_trigger_interrupt(TRIGGER_PIN);
+        }
+        int64_t start = esp_timer_get_time();
+        loop();
+        times.push_back(esp_timer_get_time() - start);
+    }
+
+    int64_t total = 0, lo = INT64_MAX, hi = 0;
+    for (int64_t t : times) {
+        total += t;
+        lo = min(lo, t);
+        hi = max(hi, t);
+    }
+    if (times.empty()) return 0;
+    double avg = (double)total / times.size();
+    printf("\n%u loops, %ux%u %s: avg %.1f us, min %lld us, max %lld us, %.1f fps (grabbed %u frames)\n",
+           frames, camMode.width, camMode.height, GrabbingMode ? "normal" : "filter", avg,
+           (long long)lo, (long long)hi, avg > 0 ? 1e6 / avg : 0.0, halCamera.framesGrabbed());
+    return 0;
+}
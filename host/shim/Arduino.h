@@ -0,0 +1,131 @@
+#ifndef __HOST_ARDUINO_H
+#define __HOST_ARDUINO_H
+
+// ==================== Linux 主機版 Arduino 核心替身 ====================
+// 只提供影像路徑用到的 API; GPIO 中斷可由 host_trigger_interrupt() 模擬。
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+#include "esp32-hal.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+using std::min;
+using std::max;
+using std::abs;
+
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0x01
+#define OUTPUT  0x03
+#define INPUT_PULLUP 0x05
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+uint16_t analogRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+bool psramFound();
+void* ps_malloc(size_t size);
+
+// 主機專用: 設定腳位電位 / 觸發已註冊的中斷 / 關閉 delay (全速執行)
+void host_set_pin(uint8_t pin, int level);
+void host_trigger_interrupt(uint8_t pin);
+void host_set_realtime(bool realtime);
+
+class String {
+public:
+    String(const char* s = "") : str(s ? s : "") {}
+    String(const std::string& s) : str(s) {}
+    String(int v) : str(std::to_string(v)) {}
+    String(unsigned int v) : str(std::to_string(v)) {}
+    String(long v) : str(std::to_string(v)) {}
+    String(unsigned long v) : str(std::to_string(v)) {}
+    String operator+(const String& o) const { return String(str + o.str); }
+    String operator+(const char* o) const { return String(str + o); }
+    String& operator+=(const String& o) { str += o.str; return *this; }
+    bool operator==(const String& o) const { return str == o.str; }
+    const char* c_str() const { return str.c_str(); }
+    size_t length() const { return str.size(); }
+
+private:
+    std::string str;
+};
+
+inline String operator+(const char* a, const String& b) { return String(a) + b; }
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(const uint8_t* buf, size_t size) = 0;
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(long long v) { return printf("%lld", v); }
+    size_t print(unsigned long long v) { return printf("%llu", v); }
+    size_t print(double v) { return printf("%.2f", v); }
+    template <typename T> size_t println(T v) { size_t n = print(v); return n + print("\r\n"); }
+    size_t println() { return print("\r\n"); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    size_t readBytes(uint8_t* buf, size_t len) {
+        size_t n = 0;
+        while (n < len && available() > 0) buf[n++] = read();
+        return n;
+    }
+};
+
+// Serial → stdout (stdin 可作為輸入)
+class HostSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    void updateBaudRate(unsigned long) {}
+    void end() {}
+    operator bool() const { return true; }
+    size_t write(const uint8_t* buf, size_t size) override { return fwrite(buf, 1, size, stdout); }
+    int available() override;    // stdin 中已到達的位元組數 (不阻塞)
+    int read() override;
+    void flush() { fflush(stdout); }
+    void setTimeout(unsigned long) {}
+    using Print::write;
+};
+
+extern HostSerial Serial;
+
+#endif
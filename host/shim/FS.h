@@ -0,0 +1,72 @@
+#ifndef __HOST_FS_H
+#define __HOST_FS_H
+
+// ==================== fs::FS 替身: 以本機目錄作為檔案系統根目錄 ====================
+
+#include <memory>
+#include <string>
+#include "Arduino.h"
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FileImpl;
+
+class File : public Stream {
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : impl(impl) {}
+
+    operator bool() const;
+    size_t write(const uint8_t* buf, size_t size) override;
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t read(uint8_t* buf, size_t size);
+    int read() override;
+    int available() override;
+    bool seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void flush();
+    void close();
+    bool isDirectory();
+    File openNextFile();
+    const char* name() const;
+    const char* path() const;
+
+private:
+    std::shared_ptr<FileImpl> impl;
+};
+
+class FS {
+public:
+    explicit FS(const char* root = ".") : root(root) {}
+    void setRoot(const char* dir) { root = dir; }
+    const char* getRoot() const { return root.c_str(); }
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path);
+    bool mkdir(const char* path);
+    bool rmdir(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+
+private:
+    std::string full(const char* path) const;
+    std::string root;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif
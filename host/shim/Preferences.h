@@ -0,0 +1,23 @@
+#ifndef __HOST_PREFERENCES_H
+#define __HOST_PREFERENCES_H
+
+#include <string>
+#include "Arduino.h"
+
+// NVS 替身: 每個 namespace/key 存成 nvs/<namespace>.<key>.bin
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end() {}
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t getBytesLength(const char* key);
+    bool remove(const char* key);
+    bool isKey(const char* key) { return getBytesLength(key) > 0; }
+
+private:
+    std::string path(const char* key) const;
+    std::string ns;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef __HOST_SD_MMC_H
+#define __HOST_SD_MMC_H
+
+#include "FS.h"
+
+#define SDMMC_FREQ_DEFAULT 20000
+
+typedef enum { CARD_NONE, CARD_MMC, CARD_SD, CARD_SDHC, CARD_UNKNOWN } sdcard_type_t;
+
+// 主機版 SD 卡: 根目錄預設為 ./sdcard, begin() 時建立
+class SDMMCFS : public fs::FS {
+public:
+    SDMMCFS() : fs::FS("sdcard") {}
+    bool setPins(int, int, int) { return true; }
+    bool begin(const char* = "/sdcard", bool = true, bool = false, int = SDMMC_FREQ_DEFAULT, uint8_t = 5);
+    void end() {}
+    sdcard_type_t cardType() { return CARD_SDHC; }
+    uint64_t cardSize() { return 0; }
+    uint64_t totalBytes() { return 0; }
+    uint64_t usedBytes() { return 0; }
+};
+
+extern SDMMCFS SD_MMC;
+
+#endif
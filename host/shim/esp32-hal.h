@@ -0,0 +1,8 @@
+#ifndef __HOST_ESP32_HAL_H
+#define __HOST_ESP32_HAL_H
+
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#endif
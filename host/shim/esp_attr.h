@@ -0,0 +1,9 @@
+#ifndef __HOST_ESP_ATTR_H
+#define __HOST_ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_ATTR
+#define PROGMEM
+
+#endif
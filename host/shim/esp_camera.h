@@ -0,0 +1,47 @@
+#ifndef __HOST_ESP_CAMERA_H
+#define __HOST_ESP_CAMERA_H
+
+// esp32-camera 的型別; 主機版不提供 esp_camera_* 函式, 必須經由 HAL 的 CameraSource
+
+#include <stddef.h>
+#include <sys/time.h>
+#include "esp_err.h"
+#include "sensor.h"
+
+typedef enum { LEDC_CHANNEL_0, LEDC_CHANNEL_1 } ledc_channel_t;
+typedef enum { LEDC_TIMER_0, LEDC_TIMER_1 } ledc_timer_t;
+typedef enum { CAMERA_GRAB_WHEN_EMPTY, CAMERA_GRAB_LATEST } camera_grab_mode_t;
+typedef enum { CAMERA_FB_IN_PSRAM, CAMERA_FB_IN_DRAM } camera_fb_location_t;
+
+typedef struct {
+    int pin_pwdn;
+    int pin_reset;
+    int pin_xclk;
+    union { int pin_sccb_sda; int pin_sscb_sda; };
+    union { int pin_sccb_scl; int pin_sscb_scl; };
+    int pin_d7, pin_d6, pin_d5, pin_d4, pin_d3, pin_d2, pin_d1, pin_d0;
+    int pin_vsync;
+    int pin_href;
+    int pin_pclk;
+    int xclk_freq_hz;
+    ledc_timer_t ledc_timer;
+    ledc_channel_t ledc_channel;
+    pixformat_t pixel_format;
+    framesize_t frame_size;
+    int jpeg_quality;
+    size_t fb_count;
+    camera_fb_location_t fb_location;
+    camera_grab_mode_t grab_mode;
+    int sccb_i2c_port;
+} camera_config_t;
+
+typedef struct {
+    uint8_t* buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+    struct timeval timestamp;
+} camera_fb_t;
+
+#endif
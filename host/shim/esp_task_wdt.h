@@ -0,0 +1,3 @@
+#ifndef __HOST_ESP_TASK_WDT_H
+#define __HOST_ESP_TASK_WDT_H
+#endif
@@ -0,0 +1,10 @@
+#ifndef __HOST_ESP_TIMER_H
+#define __HOST_ESP_TIMER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// 從行程啟動起算的微秒 (對應目標板從開機起算)
+int64_t esp_timer_get_time(void);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef __HOST_FREERTOS_H
+#define __HOST_FREERTOS_H
+
+// ==================== FreeRTOS 替身 (std::thread) ====================
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define pdPASS          1
+#define pdFAIL          0
+#define portMAX_DELAY   0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void host_enter_critical();
+void host_exit_critical();
+#define portENTER_CRITICAL(mux)     host_enter_critical()
+#define portEXIT_CRITICAL(mux)      host_exit_critical()
+#define portENTER_CRITICAL_ISR(mux) host_enter_critical()
+#define portEXIT_CRITICAL_ISR(mux)  host_exit_critical()
+
+// 主執行緒視為核心 1 (Arduino loopTask), 任務依建立時指定的核心回報
+BaseType_t xPortGetCoreID();
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef __HOST_FREERTOS_SEMPHR_H
+#define __HOST_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+typedef struct HostSemaphore* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+#endif
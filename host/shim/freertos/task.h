@@ -0,0 +1,20 @@
+#ifndef __HOST_FREERTOS_TASK_H
+#define __HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef enum { eRunning = 0, eReady, eBlocked, eSuspended, eDeleted, eInvalid } eTaskState;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* handle);
+// 只支援刪除自己 (NULL); 任務函式回傳後執行緒結束
+void vTaskDelete(TaskHandle_t handle);
+eTaskState eTaskGetState(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+
+#endif
@@ -0,0 +1,94 @@
+// ==================== 主機版 JPEG 編碼 (libjpeg) ====================
+// 獨立的編譯單元: jpeglib.h 的 boolean 與 Arduino.h 的 typedef 衝突
+
+#include "img_converters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <vector>
+#include <jpeglib.h>
+
+bool fmt2jpg(uint8_t* src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format, uint8_t quality,
+             uint8_t** out, size_t* out_len) {
+    if (format != PIXFORMAT_RGB565 || src_len < (size_t)width * height * 2) return false;
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    unsigned char* mem = nullptr;
+    unsigned long mem_len = 0;
+    jpeg_mem_dest(&cinfo, &mem, &mem_len);
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    std::vector<uint8_t> row(width * 3);
+    while (cinfo.next_scanline < height) {
+        const uint8_t* p = src + (size_t)cinfo.next_scanline * width * 2;
+        for (uint16_t x = 0; x < width; x++) {
+            uint16_t c = p[x * 2] << 8 | p[x * 2 + 1];
+            row[x * 3 + 0] = ((c >> 11) << 3) | (c >> 13);
+            row[x * 3 + 1] = (((c >> 5) & 0x3F) << 2) | ((c >> 9) & 0x03);
+            row[x * 3 + 2] = ((c & 0x1F) << 3) | ((c >> 2) & 0x07);
+        }
+        JSAMPROW rows[1] = { row.data() };
+        jpeg_write_scanlines(&cinfo, rows, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    *out = (uint8_t*)malloc(mem_len);
+    if (*out) memcpy(*out, mem, mem_len);
+    *out_len = *out ? mem_len : 0;
+    free(mem);
+    return *out != nullptr;
+}
+
+// 解碼錯誤時 libjpeg 預設會 exit; 改為 longjmp 回來回傳 false
+struct HostJpegError {
+    jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+static void host_jpeg_error_exit(j_common_ptr cinfo) {
+    char msg[JMSG_LENGTH_MAX];
+    cinfo->err->format_message(cinfo, msg);
+    fprintf(stderr, "libjpeg: %s\n", msg);
+    longjmp(((HostJpegError*)cinfo->err)->jump, 1);
+}
+
+bool host_jpeg_decode_rgb888(const uint8_t* jpg, size_t len, uint8_t** rgb, uint16_t* width, uint16_t* height) {
+    jpeg_decompress_struct cinfo;
+    HostJpegError err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = host_jpeg_error_exit;
+    *rgb = nullptr;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        free(*rgb);
+        *rgb = nullptr;
+        return false;
+    }
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, jpg, len);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+    *width = cinfo.output_width;
+    *height = cinfo.output_height;
+    *rgb = (uint8_t*)malloc((size_t)cinfo.output_width * cinfo.output_height * 3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = *rgb + (size_t)cinfo.output_scanline * cinfo.output_width * 3;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    // 資料有誤但可復原時 libjpeg 只發警告 (例如缺少 RST 標記); 驗證時視為失敗
+    bool clean = err.mgr.num_warnings == 0;
+    jpeg_destroy_decompress(&cinfo);
+    if (!clean) fprintf(stderr, "libjpeg: %ld warnings\n", err.mgr.num_warnings);
+    return clean;
+}
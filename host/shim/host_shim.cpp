@@ -0,0 +1,372 @@
+// ==================== Linux 主機版替身實作 ====================
+
+#include "Arduino.h"
+#include "FS.h"
+#include "SD_MMC.h"
+#include "Preferences.h"
+#include "esp_camera.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+HostSerial Serial;
+
+int HostSerial::available() {
+    int n = 0;
+    return ioctl(STDIN_FILENO, FIONREAD, &n) == 0 ? n : 0;
+}
+
+int HostSerial::read() {
+    uint8_t c;
+    return available() > 0 && ::read(STDIN_FILENO, &c, 1) == 1 ? c : -1;
+}
+SDMMCFS SD_MMC;
+
+const resolution_info_t resolution[FRAMESIZE_INVALID] = {
+    {   96,   96, ASPECT_RATIO_1X1   }, /* 96x96 */
+    {  160,  120, ASPECT_RATIO_4X3   }, /* QQVGA */
+    {  176,  144, ASPECT_RATIO_5X4   }, /* QCIF  */
+    {  240,  176, ASPECT_RATIO_4X3   }, /* HQVGA */
+    {  240,  240, ASPECT_RATIO_1X1   }, /* 240x240 */
+    {  320,  240, ASPECT_RATIO_4X3   }, /* QVGA  */
+    {  400,  296, ASPECT_RATIO_4X3   }, /* CIF   */
+    {  480,  320, ASPECT_RATIO_3X2   }, /* HVGA  */
+    {  640,  480, ASPECT_RATIO_4X3   }, /* VGA   */
+    {  800,  600, ASPECT_RATIO_4X3   }, /* SVGA  */
+    { 1024,  768, ASPECT_RATIO_4X3   }, /* XGA   */
+    { 1280,  720, ASPECT_RATIO_16X9  }, /* HD    */
+    { 1280, 1024, ASPECT_RATIO_5X4   }, /* SXGA  */
+    { 1600, 1200, ASPECT_RATIO_4X3   }, /* UXGA  */
+    { 1920, 1080, ASPECT_RATIO_16X9  }, /* FHD   */
+    {  720, 1280, ASPECT_RATIO_9X16  }, /* Portrait HD   */
+    {  864, 1536, ASPECT_RATIO_9X16  }, /* Portrait 3MP  */
+    { 2048, 1536, ASPECT_RATIO_4X3   }, /* QXGA  */
+    { 2560, 1440, ASPECT_RATIO_16X9  }, /* QHD   */
+    { 2560, 1600, ASPECT_RATIO_16X10 }, /* WQXGA */
+    { 1080, 1920, ASPECT_RATIO_9X16  }, /* Portrait FHD  */
+    { 2560, 1920, ASPECT_RATIO_4X3   }, /* QSXGA */
+};
+
+// ---------- 時間 ----------
+
+static const std::chrono::steady_clock::time_point host_start = std::chrono::steady_clock::now();
+static bool host_realtime = true;
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - host_start).count();
+}
+
+unsigned long millis() { return esp_timer_get_time() / 1000; }
+unsigned long micros() { return esp_timer_get_time(); }
+
+void host_set_realtime(bool realtime) { host_realtime = realtime; }
+
+void delay(uint32_t ms) {
+    if (host_realtime) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    else std::this_thread::yield();
+}
+
+void delayMicroseconds(uint32_t us) {
+    if (host_realtime) std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// ---------- GPIO ----------
+
+static int host_pins[64];
+static void (*host_isrs[64])(void);
+
+void pinMode(uint8_t, uint8_t) {}
+int digitalRead(uint8_t pin) { return pin < 64 ? host_pins[pin] : 0; }
+void digitalWrite(uint8_t pin, uint8_t val) { if (pin < 64) host_pins[pin] = val; }
+uint16_t analogRead(uint8_t pin) { return pin < 64 ? host_pins[pin] : 0; }
+void attachInterrupt(uint8_t pin, void (*isr)(void), int) { if (pin < 64) host_isrs[pin] = isr; }
+void detachInterrupt(uint8_t pin) { if (pin < 64) host_isrs[pin] = nullptr; }
+
+void host_set_pin(uint8_t pin, int level) { if (pin < 64) host_pins[pin] = level; }
+
+void host_trigger_interrupt(uint8_t pin) {
+    if (pin < 64 && host_isrs[pin]) host_isrs[pin]();
+}
+
+bool psramFound() { return true; }
+void* ps_malloc(size_t size) { return malloc(size); }
+
+// ---------- Print ----------
+
+size_t Print::printf(const char* fmt, ...) {
+    char stack_buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(stack_buf, sizeof(stack_buf), fmt, args);
+    va_end(args);
+    if (n < 0) return 0;
+    if ((size_t)n < sizeof(stack_buf)) return write((const uint8_t*)stack_buf, n);
+    std::string heap_buf(n + 1, '\0');
+    va_start(args, fmt);
+    vsnprintf(&heap_buf[0], n + 1, fmt, args);
+    va_end(args);
+    return write((const uint8_t*)heap_buf.data(), n);
+}
+
+// ---------- FreeRTOS ----------
+
+struct HostTask {
+    std::atomic<int> state;
+    std::atomic<uint32_t> generation;   // 區塊被重新分配後, 舊任務結束時不可改動新任務的狀態
+};
+
+struct HostSemaphore {
+    std::mutex mutex;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+static std::recursive_mutex host_critical_mutex;
+static thread_local BaseType_t host_core_id = 1;
+static thread_local HostTask* host_current_task = nullptr;
+static thread_local uint32_t host_current_generation = 0;
+
+// 任務控制區塊循環使用: 呼叫端只會在建立後輪詢到 eDeleted 為止
+// (常駐任務如 HTTP 伺服器的區塊也會被重新分配, 以 generation 區分)
+#define HOST_TASK_POOL 64
+static HostTask host_task_pool[HOST_TASK_POOL];
+static std::atomic<uint32_t> host_task_next(0);
+
+void host_enter_critical() { host_critical_mutex.lock(); }
+void host_exit_critical() { host_critical_mutex.unlock(); }
+
+BaseType_t xPortGetCoreID() { return host_core_id; }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg,
+                                   UBaseType_t, TaskHandle_t* handle, BaseType_t core) {
+    HostTask* task = &host_task_pool[host_task_next++ % HOST_TASK_POOL];
+    uint32_t generation = ++task->generation;
+    task->state = eRunning;
+    if (handle) *handle = task;
+    std::thread([fn, arg, task, generation, core]() {
+        host_core_id = core < 0 ? 0 : core;
+        host_current_task = task;
+        host_current_generation = generation;
+        fn(arg);
+        if (task->generation == generation) task->state = eDeleted;
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    if (handle) {
+        handle->state = eDeleted;
+    } else if (host_current_task && host_current_task->generation == host_current_generation) {
+        host_current_task->state = eDeleted;
+    }
+}
+
+eTaskState eTaskGetState(TaskHandle_t handle) {
+    return handle ? (eTaskState)handle->state.load() : eInvalid;
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial) {
+    HostSemaphore* sem = new HostSemaphore();
+    sem->count = initial;
+    sem->max_count = max_count;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xSemaphoreCreateCounting(1, 0); }
+SemaphoreHandle_t xSemaphoreCreateMutex() { return xSemaphoreCreateCounting(1, 1); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(sem->mutex);
+    if (ticks == portMAX_DELAY) {
+        sem->cv.wait(lock, [sem] { return sem->count > 0; });
+    } else if (!sem->cv.wait_for(lock, std::chrono::milliseconds(ticks), [sem] { return sem->count > 0; })) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    std::lock_guard<std::mutex> lock(sem->mutex);
+    if (sem->count >= sem->max_count) return pdFALSE;
+    sem->count++;
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken) {
+    if (woken) *woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+// ---------- fs::FS ----------
+
+namespace fs {
+
+struct FileImpl {
+    FILE* fp = nullptr;
+    DIR* dir = nullptr;
+    std::string full_path;
+    std::string path;
+    std::string name;
+    std::string root;
+    ~FileImpl() {
+        if (fp) fclose(fp);
+        if (dir) closedir(dir);
+    }
+};
+
+static std::string base_name(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+File::operator bool() const { return impl && (impl->fp || impl->dir); }
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    return (impl && impl->fp) ? fwrite(buf, 1, size, impl->fp) : 0;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    return (impl && impl->fp) ? fread(buf, 1, size, impl->fp) : 0;
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::available() {
+    if (!impl || !impl->fp) return 0;
+    return (int)(size() - position());
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    return impl && impl->fp && fseek(impl->fp, pos, mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END) == 0;
+}
+
+size_t File::position() const { return (impl && impl->fp) ? ftell(impl->fp) : 0; }
+
+size_t File::size() const {
+    struct stat st;
+    if (!impl) return 0;
+    if (impl->fp) fflush(impl->fp);
+    return stat(impl->full_path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+void File::flush() { if (impl && impl->fp) fflush(impl->fp); }
+
+void File::close() { impl.reset(); }
+
+bool File::isDirectory() { return impl && impl->dir; }
+
+File File::openNextFile() {
+    if (!impl || !impl->dir) return File();
+    struct dirent* entry;
+    while ((entry = readdir(impl->dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        FS fs(impl->root.c_str());
+        std::string child = impl->path == "/" ? "/" + std::string(entry->d_name) : impl->path + "/" + entry->d_name;
+        return fs.open(child.c_str());
+    }
+    return File();
+}
+
+const char* File::name() const { return impl ? impl->name.c_str() : ""; }
+const char* File::path() const { return impl ? impl->path.c_str() : ""; }
+
+std::string FS::full(const char* path) const {
+    return root + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char* path, const char* mode, bool) {
+    auto impl = std::make_shared<FileImpl>();
+    impl->full_path = full(path);
+    impl->path = path;
+    impl->name = base_name(path);
+    impl->root = root;
+    struct stat st;
+    if (strcmp(mode, FILE_READ) == 0 && stat(impl->full_path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        impl->dir = opendir(impl->full_path.c_str());
+    } else {
+        const char* fmode = strcmp(mode, FILE_WRITE) == 0 ? "wb" : strcmp(mode, FILE_APPEND) == 0 ? "ab" : "rb";
+        impl->fp = fopen(impl->full_path.c_str(), fmode);
+    }
+    if (!impl->fp && !impl->dir) return File();
+    return File(impl);
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return stat(full(path).c_str(), &st) == 0;
+}
+
+bool FS::mkdir(const char* path) { return ::mkdir(full(path).c_str(), 0755) == 0; }
+bool FS::rmdir(const char* path) { return ::rmdir(full(path).c_str()) == 0; }
+bool FS::remove(const char* path) { return ::unlink(full(path).c_str()) == 0; }
+bool FS::rename(const char* from, const char* to) { return ::rename(full(from).c_str(), full(to).c_str()) == 0; }
+
+}  // namespace fs
+
+bool SDMMCFS::begin(const char*, bool, bool, int, uint8_t) {
+    ::mkdir(getRoot(), 0755);
+    struct stat st;
+    return stat(getRoot(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// ---------- Preferences ----------
+
+bool Preferences::begin(const char* name, bool) {
+    ns = name;
+    ::mkdir("nvs", 0755);
+    return true;
+}
+
+std::string Preferences::path(const char* key) const {
+    return "nvs/" + ns + "." + key + ".bin";
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    FILE* fp = fopen(path(key).c_str(), "wb");
+    if (!fp) return 0;
+    size_t n = fwrite(value, 1, len, fp);
+    fclose(fp);
+    return n;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    FILE* fp = fopen(path(key).c_str(), "rb");
+    if (!fp) return 0;
+    size_t n = fread(buf, 1, maxLen, fp);
+    fclose(fp);
+    return n;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    struct stat st;
+    return stat(path(key).c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+bool Preferences::remove(const char* key) { return ::unlink(path(key).c_str()) == 0; }
@@ -0,0 +1,18 @@
+#ifndef __HOST_IMG_CONVERTERS_H
+#define __HOST_IMG_CONVERTERS_H
+
+#include "esp_camera.h"
+
+typedef enum { JPG_SCALE_NONE, JPG_SCALE_2X, JPG_SCALE_4X, JPG_SCALE_8X, JPG_SCALE_MAX = JPG_SCALE_8X } jpg_scale_t;
+
+// 主機版沒有 JPEG 解碼器; 主機相機只產生 RGB565 / YUV422, 這個路徑不會被走到
+inline bool jpg2rgb565(const uint8_t*, size_t, uint8_t*, jpg_scale_t) { return false; }
+
+// 以 libjpeg 編碼 (串流用); 只支援大端序 RGB565, *out 以 malloc 配置, 呼叫端 free
+bool fmt2jpg(uint8_t* src, size_t src_len, uint16_t width, uint16_t height, pixformat_t format, uint8_t quality,
+             uint8_t** out, size_t* out_len);
+
+// 主機版額外提供: 以 libjpeg 解碼成 RGB888 (驗證 jpeg_encoder.h 用), *rgb 以 malloc 配置
+bool host_jpeg_decode_rgb888(const uint8_t* jpg, size_t len, uint8_t** rgb, uint16_t* width, uint16_t* height);
+
+#endif
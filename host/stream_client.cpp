@@ -0,0 +1,157 @@
+// ==================== 限速串流客戶端 (Linux 主機) ====================
+// 連到 camera_host --http-port N 的 /stream, 以固定速率讀取 (token bucket) 模擬慢的網路,
+// 每秒列出收到的幀率、平均影像大小與吞吐量, 並向控制埠查詢目前的串流品質。
+// 配合 camera_host 的 Serial 輸出 (drain / latency / quality) 觀察位元率控制是否收斂。
+//
+//   stream_client [--port N] [--rate KB/s] [--seconds N] [--rcvbuf bytes]
+//   (--port 為控制埠, 串流在 N + 1; --rate 0 = 不限速)
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+static double now_s() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static int connect_local(int port, int rcvbuf) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    // 接收緩衝要小, 否則限速會被核心緩衝吸收, 伺服器看不到慢的連線
+    if (rcvbuf > 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// GET 一個路徑, 回傳本文 (連線關閉為止)
+static std::string http_get(int port, const char* path) {
+    int fd = connect_local(port, 0);
+    if (fd < 0) return "";
+    std::string req = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(fd, req.data(), req.size(), 0);
+    std::string reply;
+    char buf[2048];
+    int n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) reply.append(buf, n);
+    close(fd);
+    size_t body = reply.find("\r\n\r\n");
+    return body == std::string::npos ? "" : reply.substr(body + 4);
+}
+
+static int json_int(const std::string& json, const char* key) {
+    std::string k = std::string("\"") + key + "\":";
+    size_t p = json.find(k);
+    return p == std::string::npos ? -1 : atoi(json.c_str() + p + k.size());
+}
+
+struct Throttle {
+    double rate;      // bytes/s, 0 = 不限速
+    double tokens;
+    double last;
+
+    // 最多可讀多少 bytes (必要時先睡到有額度)
+    size_t allow(size_t want) {
+        if (rate <= 0) return want;
+        for (;;) {
+            double t = now_s();
+            tokens = std::min(tokens + (t - last) * rate, rate * 0.05);
+            last = t;
+            if (tokens >= 1) return std::min(want, (size_t)tokens);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    int port = 8080;
+    double rate_kb = 50;
+    double seconds = 20;
+    int rcvbuf = 4096;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i + 1 < argc) port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rate") && i + 1 < argc) rate_kb = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--rcvbuf") && i + 1 < argc) rcvbuf = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--port N] [--rate KB/s] [--seconds N] [--rcvbuf bytes]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int fd = connect_local(port + 1, rcvbuf);
+    if (fd < 0) {
+        fprintf(stderr, "cannot connect to stream port %d\n", port + 1);
+        return 1;
+    }
+    const char* req = "GET /stream HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(fd, req, strlen(req), 0);
+
+    Throttle throttle = { rate_kb * 1024, 0, now_s() };
+    std::string pending;            // 還沒解析的資料
+    size_t body_left = 0;           // 目前影像還剩多少 bytes
+    char buf[4096];
+    double start = now_s(), tick = start;
+    unsigned frames = 0, total_frames = 0;
+    size_t bytes = 0, frame_bytes = 0, total_bytes = 0;
+
+    while (now_s() - start < seconds) {
+        int n = recv(fd, buf, throttle.allow(sizeof(buf)), 0);
+        if (n <= 0) break;
+        throttle.tokens -= n;
+        bytes += n;
+        total_bytes += n;
+        pending.append(buf, n);
+        // 跳過影像本文, 在 part 標頭中找 Content-Length
+        for (;;) {
+            if (body_left) {
+                size_t take = std::min(body_left, pending.size());
+                pending.erase(0, take);
+                body_left -= take;
+                if (body_left) break;
+                frames++;
+                total_frames++;
+            }
+            size_t end = pending.find("\r\n\r\n");
+            if (end == std::string::npos) break;
+            size_t len = pending.find("Content-Length: ");
+            std::string head = pending.substr(0, end);
+            pending.erase(0, end + 4);
+            if (len != std::string::npos && len < end) {
+                body_left = strtoul(head.c_str() + len + 16, nullptr, 10);
+                frame_bytes += body_left;
+            }
+        }
+
+        double t = now_s();
+        if (t - tick >= 1.0) {
+            std::string status = http_get(port, "/status");
+            printf("%5.1f s: %4.1f fps, %6.0f bytes/frame, %6.1f KB/s, stream quality %d\n", t - start, frames / (t - tick),
+                   frames ? (double)frame_bytes / frames : 0.0, bytes / 1024.0 / (t - tick), json_int(status, "stream_quality"));
+            fflush(stdout);
+            tick = t;
+            frames = 0;
+            bytes = frame_bytes = 0;
+        }
+    }
+    close(fd);
+    double elapsed = now_s() - start;
+    printf("total: %u frames in %.1f s (%.1f fps), %.1f KB/s\n", total_frames, elapsed, total_frames / elapsed, total_bytes / 1024.0 / elapsed);
+    return 0;
+}
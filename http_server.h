@@ -0,0 +1,847 @@
+#ifndef __HTTP_SERVER_H
+#define __HTTP_SERVER_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "jpeg_encoder.h"
+#include "camera_index.h"
+#include "frame_broadcast.h"
+#include "remote_control.h"
+#ifdef HOST_BUILD
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#else
+#include "lwip/sockets.h"
+#endif
+#include <strings.h>
+
+// ==================== HTTP 伺服器 (BSD socket) ====================
+// 與 camera_index.h 網頁相容的端點:
+//   控制埠 (80): /  (依感測器 PID 回傳 gzip 網頁)  /status  /control  /capture
+//                /reg  /greg  /xclk  /resolution  /pll  /stream_stats
+//                /rc   (POST, remote_control.h 二進位封包; 回覆在本文)
+//                /ws   (WebSocket, 二進位訊框內為 remote_control.h 封包)
+//   串流埠 (81): /stream  (multipart/x-mixed-replace MJPEG)
+// 執行緒模型:
+//   - 每個埠一個接受連線的任務; 控制請求在接受任務中依序處理, 每個串流客戶端一個任務
+//   - 碰到感測器的請求 (status / control / reg ...) 交給 loop() 的 http_server_service 執行,
+//     伺服器任務等待結果, 感測器只會被 loop() 存取 (SCCB 沒有鎖)
+//   - 遠端控制封包交給 remote_control.h 的佇列, 回覆由 loop() 經 RcSink 送回 (/rc 等回覆後才回應)
+//   - 影像由 loop() 在有客戶端等待時編碼一次 (http_server_publish_*), 交給 frame_broadcast.h
+//     分送: 所有串流客戶端與 /capture 共用同一份 JPEG, 慢的客戶端各自丟幀
+
+#define HTTP_CONTROL_PORT        80
+#define HTTP_STREAM_PORT         81
+#define HTTP_MAX_STREAMS         BROADCAST_MAX_CLIENTS
+#define HTTP_REQUEST_MAX         1024
+#define HTTP_REPLY_MAX           1024
+#define HTTP_JPEG_QUALITY        80       // jpeg_encoder.h 品質 (1-100, 越高越好)
+#define HTTP_COMMAND_TIMEOUT_MS  1000
+#define HTTP_CAPTURE_TIMEOUT_MS  3000
+#define HTTP_STREAM_WAIT_MS      1000     // 串流任務等新影像的逾時 (逾時後檢查伺服器是否停止)
+#define HTTP_STREAM_SNDBUF       4096     // 串流 socket 送出緩衝 (與 lwIP 的 TCP_SND_BUF 同級): 太大會把慢客戶端的積壓藏在核心裡
+#define HTTP_SOCKET_TIMEOUT_S    5
+#define HTTP_STREAM_BOUNDARY     "123456789000000000000987654321"
+#define HTTP_RC_BODY_MAX         512      // /rc 本文上限 (約 7 個最大封包)
+#define HTTP_MAX_WEBSOCKETS      2
+#define HTTP_WS_PAYLOAD_MAX      512
+#define HTTP_WS_GUID             "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+enum HttpCommandType : uint8_t {
+    HTTP_CMD_STATUS = 0,
+    HTTP_CMD_CONTROL,
+    HTTP_CMD_SET_REG,
+    HTTP_CMD_GET_REG,
+    HTTP_CMD_XCLK,
+    HTTP_CMD_RESOLUTION,
+    HTTP_CMD_PLL
+};
+
+// /rc 的回覆收集 (控制請求依序處理, 一個就夠)
+struct HttpRcReply {
+    RcSink sink;
+    SemaphoreHandle_t lock;
+    SemaphoreHandle_t replied;            // 每收到一個回覆給一次
+    uint8_t data[HTTP_RC_BODY_MAX];
+    size_t len;
+};
+
+struct HttpWebSocket {
+    RcSink sink;
+    RcParser parser;
+    SemaphoreHandle_t send_lock;          // loop() 送回覆與連線任務送 pong / close 共用
+    struct HttpServer* srv;
+    int fd;
+    bool used;
+};
+
+// 交給 loop() 執行的請求與結果
+struct HttpCommand {
+    HttpCommandType type;
+    char var[24];                 // /control 的變數名稱
+    int32_t args[12];             // 數值參數, 依 type 解讀
+    int32_t result;               // 0 = 成功; /greg 為讀到的值
+    char reply[HTTP_REPLY_MAX];   // /status 的 JSON
+};
+
+struct HttpServer {
+    uint16_t control_port;
+    uint16_t stream_port;
+    int control_fd;
+    int stream_fd;
+    uint16_t sensor_pid;          // 決定回傳哪一份網頁
+    uint8_t jpeg_quality;
+    bool running;
+
+    SemaphoreHandle_t lock;       // 保護 command_pending
+    FrameBroadcaster broadcast;   // 串流客戶端與 /capture 共用的 JPEG
+
+    SemaphoreHandle_t command_lock;   // 一次只有一個請求在等待 loop()
+    SemaphoreHandle_t command_done;
+    HttpCommand command;
+    volatile bool command_pending;
+
+    // 應用程式處理的變數 (例如 framesize 需經過 camera_mode); 回傳 -1 表示不處理
+    int (*control_hook)(const char* var, int value);
+
+    RemoteControl* remote;        // nullptr = 不提供 /rc 與 /ws
+    HttpRcReply rc_reply;
+    RcParser rc_parser;
+    HttpWebSocket websockets[HTTP_MAX_WEBSOCKETS];
+
+    uint32_t requests;
+};
+
+// ---------- socket 輔助 ----------
+
+static bool http_send_all(int fd, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+        int n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool http_send_text(int fd, const char* text) {
+    return http_send_all(fd, text, strlen(text));
+}
+
+static void http_set_timeouts(int fd) {
+    struct timeval tv = { HTTP_SOCKET_TIMEOUT_S, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static int http_listen(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0) return -1;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 4) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 讀到標頭結束 (\r\n\r\n); 回傳讀到的位元組數 (可能含部分本文), 失敗回傳 -1
+static int http_read_request(int fd, char* buf, size_t size) {
+    size_t used = 0;
+    while (used < size - 1) {
+        int n = recv(fd, buf + used, size - 1 - used, 0);
+        if (n <= 0) return -1;
+        used += n;
+        buf[used] = '\0';
+        if (strstr(buf, "\r\n\r\n")) return used;
+    }
+    return -1;
+}
+
+// 在標頭中找 name (不分大小寫), 值複製到 out
+static bool http_header_value(const char* req, const char* name, char* out, size_t out_len) {
+    size_t name_len = strlen(name);
+    const char* line = strstr(req, "\r\n");
+    while (line && line[2] != '\r') {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char* v = line + name_len + 1;
+            while (*v == ' ') v++;
+            size_t n = strcspn(v, "\r");
+            if (n >= out_len) n = out_len - 1;
+            memcpy(out, v, n);
+            out[n] = '\0';
+            return true;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return false;
+}
+
+// "GET /path?query HTTP/1.1" → path 與 query (就地切開); post 為 nullptr 時只接受 GET
+static bool http_parse_request_line(char* buf, char** path, char** query, bool* post = nullptr) {
+    bool is_post = post && strncmp(buf, "POST ", 5) == 0;
+    if (!is_post && strncmp(buf, "GET ", 4) != 0) return false;
+    if (post) *post = is_post;
+    char* p = buf + (is_post ? 5 : 4);
+    char* end = strchr(p, ' ');
+    if (end == nullptr) return false;
+    *end = '\0';
+    *path = p;
+    char* q = strchr(p, '?');
+    *query = q ? q + 1 : end;
+    if (q) *q = '\0';
+    return true;
+}
+
+// 取出查詢參數 (不做 URL 解碼, 網頁只送數字與變數名稱)
+static bool http_query_value(const char* query, const char* key, char* out, size_t out_len) {
+    size_t key_len = strlen(key);
+    const char* p = query;
+    while (p && *p) {
+        if (strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            p += key_len + 1;
+            size_t n = strcspn(p, "&");
+            if (n >= out_len) n = out_len - 1;
+            memcpy(out, p, n);
+            out[n] = '\0';
+            return true;
+        }
+        p = strchr(p, '&');
+        if (p) p++;
+    }
+    return false;
+}
+
+static bool http_query_int(const char* query, const char* key, int32_t* value) {
+    char buf[16];
+    if (!http_query_value(query, key, buf, sizeof(buf))) return false;
+    *value = strtol(buf, nullptr, 0);
+    return true;
+}
+
+static void http_send_status(int fd, int code, const char* reason) {
+    char head[160];
+    snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+             code, reason);
+    http_send_text(fd, head);
+}
+
+static void http_send_body(int fd, const char* type, const char* extra_headers, const void* body, size_t len) {
+    char head[256];
+    snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %u\r\n%sAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+             type, (unsigned)len, extra_headers ? extra_headers : "");
+    if (http_send_text(fd, head)) http_send_all(fd, body, len);
+}
+
+// ---------- 交給 loop() 的請求 ----------
+
+// 送出 srv->command 並等待 loop() 執行完; 逾時回傳 false
+static bool http_run_command(HttpServer* srv) {
+    xSemaphoreTake(srv->lock, portMAX_DELAY);
+    srv->command_pending = true;
+    xSemaphoreGive(srv->lock);
+    if (xSemaphoreTake(srv->command_done, pdMS_TO_TICKS(HTTP_COMMAND_TIMEOUT_MS)) == pdTRUE) return true;
+    // 逾時: loop() 還沒取走就撤回, 已取走就等它做完
+    xSemaphoreTake(srv->lock, portMAX_DELAY);
+    bool cancelled = srv->command_pending;
+    srv->command_pending = false;
+    xSemaphoreGive(srv->lock);
+    if (!cancelled) xSemaphoreTake(srv->command_done, portMAX_DELAY);
+    return !cancelled;
+}
+
+static int http_apply_control(HttpServer* srv, sensor_t* s, const char* var, int val) {
+    if (srv->control_hook) {
+        int res = srv->control_hook(var, val);
+        if (res != -1) return res;
+    }
+    if (!strcmp(var, "quality")) {
+        // 網頁的 4..63 (越小越好) 對應串流編碼品質
+        srv->jpeg_quality = constrain(map(val, 63, 4, 10, 95), 10, 95);
+        return s->set_quality ? s->set_quality(s, val) : 0;
+    }
+    if (!strcmp(var, "contrast")) return s->set_contrast(s, val);
+    if (!strcmp(var, "brightness")) return s->set_brightness(s, val);
+    if (!strcmp(var, "saturation")) return s->set_saturation(s, val);
+    if (!strcmp(var, "sharpness")) return s->set_sharpness(s, val);
+    if (!strcmp(var, "denoise")) return s->set_denoise(s, val);
+    if (!strcmp(var, "gainceiling")) return s->set_gainceiling(s, (gainceiling_t)val);
+    if (!strcmp(var, "colorbar")) return s->set_colorbar(s, val);
+    if (!strcmp(var, "awb")) return s->set_whitebal(s, val);
+    if (!strcmp(var, "agc")) return s->set_gain_ctrl(s, val);
+    if (!strcmp(var, "aec")) return s->set_exposure_ctrl(s, val);
+    if (!strcmp(var, "hmirror")) return s->set_hmirror(s, val);
+    if (!strcmp(var, "vflip")) return s->set_vflip(s, val);
+    if (!strcmp(var, "awb_gain")) return s->set_awb_gain(s, val);
+    if (!strcmp(var, "agc_gain")) return s->set_agc_gain(s, val);
+    if (!strcmp(var, "aec_value")) return s->set_aec_value(s, val);
+    if (!strcmp(var, "aec2")) return s->set_aec2(s, val);
+    if (!strcmp(var, "dcw")) return s->set_dcw(s, val);
+    if (!strcmp(var, "bpc")) return s->set_bpc(s, val);
+    if (!strcmp(var, "wpc")) return s->set_wpc(s, val);
+    if (!strcmp(var, "raw_gma")) return s->set_raw_gma(s, val);
+    if (!strcmp(var, "lenc")) return s->set_lenc(s, val);
+    if (!strcmp(var, "special_effect")) return s->set_special_effect(s, val);
+    if (!strcmp(var, "wb_mode")) return s->set_wb_mode(s, val);
+    if (!strcmp(var, "ae_level")) return s->set_ae_level(s, val);
+    return -1;
+}
+
+static void http_format_status(HttpServer* srv, sensor_t* s, char* out, size_t len) {
+    const camera_status_t& st = s->status;
+    int n = snprintf(out, len,
+        "{\"xclk\":%u,\"pixformat\":%u,\"framesize\":%u,\"quality\":%u,\"brightness\":%d,\"contrast\":%d,"
+        "\"saturation\":%d,\"sharpness\":%d,\"special_effect\":%u,\"wb_mode\":%u,\"awb\":%u,\"awb_gain\":%u,"
+        "\"aec\":%u,\"aec2\":%u,\"ae_level\":%d,\"aec_value\":%u,\"agc\":%u,\"agc_gain\":%u,\"gainceiling\":%u,"
+        "\"bpc\":%u,\"wpc\":%u,\"raw_gma\":%u,\"lenc\":%u,\"hmirror\":%u,\"dcw\":%u,\"colorbar\":%u,\"vflip\":%u,"
+        "\"stream_quality\":%u,\"stream_clients\":%u}",
+        (unsigned)(s->xclk_freq_hz / 1000000), s->pixformat, st.framesize, st.quality, st.brightness, st.contrast,
+        st.saturation, st.sharpness, st.special_effect, st.wb_mode, st.awb, st.awb_gain,
+        st.aec, st.aec2, st.ae_level, st.aec_value, st.agc, st.agc_gain, st.gainceiling,
+        st.bpc, st.wpc, st.raw_gma, st.lenc, st.hmirror, st.dcw, st.colorbar, st.vflip,
+        srv->jpeg_quality, srv->broadcast.client_count);
+    if (n >= (int)len) out[len - 1] = '\0';
+}
+
+// loop() 每次呼叫一次 (不持有 fb 時): 執行伺服器任務交來的感測器請求
+void http_server_service(HttpServer* srv, sensor_t* s) {
+    if (srv->lock == nullptr || !srv->command_pending) return;
+    xSemaphoreTake(srv->lock, portMAX_DELAY);
+    bool pending = srv->command_pending;
+    srv->command_pending = false;
+    xSemaphoreGive(srv->lock);
+    if (!pending) return;
+
+    HttpCommand* cmd = &srv->command;
+    int32_t* a = cmd->args;
+    if (s == nullptr) {
+        cmd->result = -1;
+    } else switch (cmd->type) {
+        case HTTP_CMD_STATUS:
+            http_format_status(srv, s, cmd->reply, sizeof(cmd->reply));
+            cmd->result = 0;
+            break;
+        case HTTP_CMD_CONTROL:
+            cmd->result = http_apply_control(srv, s, cmd->var, a[0]);
+            break;
+        case HTTP_CMD_SET_REG:
+            cmd->result = s->set_reg(s, a[0], a[1], a[2]);
+            break;
+        case HTTP_CMD_GET_REG:
+            cmd->result = s->get_reg(s, a[0], a[1]);
+            break;
+        case HTTP_CMD_XCLK:
+            cmd->result = s->set_xclk ? s->set_xclk(s, LEDC_TIMER_0, a[0]) : -1;
+            break;
+        case HTTP_CMD_RESOLUTION:
+            cmd->result = s->set_res_raw ? s->set_res_raw(s, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]) : -1;
+            break;
+        case HTTP_CMD_PLL:
+            cmd->result = s->set_pll ? s->set_pll(s, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]) : -1;
+            break;
+    }
+    xSemaphoreGive(srv->command_done);
+}
+
+// ---------- 影像發布 (loop() 呼叫) ----------
+
+__attribute__((always_inline)) inline bool http_server_wants_frame(const HttpServer* srv) {
+    return srv->running && broadcast_wants_frame(&srv->broadcast);
+}
+
+// 感測器已輸出 JPEG: 直接複製
+bool http_server_publish_jpeg(HttpServer* srv, const uint8_t* jpeg, size_t len) {
+    if (!http_server_wants_frame(srv)) return false;
+    uint8_t* copy = (uint8_t*)malloc(len);
+    if (copy == nullptr) return false;
+    memcpy(copy, jpeg, len);
+    srv->broadcast.encode_us = 0;
+    broadcast_publish(&srv->broadcast, shared_frame_wrap(copy, len));
+    return true;
+}
+
+// 處理後的影像 (感測器位元組順序的 RGB565) 編碼一次, 所有客戶端共用; 上下兩半在兩個核心編碼
+bool http_server_publish_rgb565(HttpServer* srv, const uint16_t* buffer, uint16_t width, uint16_t height) {
+    if (!http_server_wants_frame(srv)) return false;
+    uint8_t* jpeg = nullptr;
+    size_t len = 0;
+    int64_t start = esp_timer_get_time();
+    if (!jpeg_encode_rgb565(buffer, width, height, srv->jpeg_quality, JPEG_SUBSAMPLE_420, true, &jpeg, &len)) {
+        return false;
+    }
+    srv->broadcast.encode_us = esp_timer_get_time() - start;
+    broadcast_publish(&srv->broadcast, shared_frame_wrap(jpeg, len));
+    return true;
+}
+
+// ---------- 遠端控制: POST /rc ----------
+
+static void http_rc_reply_send(RcSink* sink, const uint8_t* frame, size_t len) {
+    HttpRcReply* r = (HttpRcReply*)sink->context;
+    xSemaphoreTake(r->lock, portMAX_DELAY);
+    if (sink->open && r->len + len <= sizeof(r->data)) {
+        memcpy(r->data + r->len, frame, len);
+        r->len += len;
+    }
+    xSemaphoreGive(r->lock);
+    xSemaphoreGive(r->replied);
+}
+
+// 本文是一個或多個封包; 等每個封包的回覆 (帶 APPLY 的要等顯示) 後一起回傳
+static void http_handle_rc(HttpServer* srv, int fd, const uint8_t* body, size_t have, size_t length) {
+    if (srv->remote == nullptr) {
+        http_send_status(fd, 404, "Not Found");
+        return;
+    }
+    if (length == 0 || length > HTTP_RC_BODY_MAX) {
+        http_send_status(fd, 413, "Payload Too Large");
+        return;
+    }
+    uint8_t data[HTTP_RC_BODY_MAX];
+    have = min(have, length);
+    memcpy(data, body, have);
+    while (have < length) {
+        int n = recv(fd, data + have, length - have, 0);
+        if (n <= 0) return;
+        have += n;
+    }
+
+    HttpRcReply* r = &srv->rc_reply;
+    xSemaphoreTake(r->lock, portMAX_DELAY);
+    r->len = 0;
+    r->sink.open = true;
+    xSemaphoreGive(r->lock);
+    while (xSemaphoreTake(r->replied, 0) == pdTRUE) {}
+    memset(&srv->rc_parser, 0, sizeof(RcParser));
+    uint8_t expected = rc_submit(srv->remote, &srv->rc_parser, data, length, &r->sink);
+    unsigned long start = millis();
+    uint8_t got = 0;
+    while (got < expected) {
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= HTTP_COMMAND_TIMEOUT_MS || xSemaphoreTake(r->replied, pdMS_TO_TICKS(HTTP_COMMAND_TIMEOUT_MS - elapsed)) != pdTRUE) break;
+        got++;
+    }
+    // 之後才到的回覆 (逾時) 不再寫入
+    xSemaphoreTake(r->lock, portMAX_DELAY);
+    r->sink.open = false;
+    r->sink.generation++;
+    xSemaphoreGive(r->lock);
+    if (expected == 0) http_send_status(fd, 400, "Bad Request");
+    else if (got < expected && r->len == 0) http_send_status(fd, 503, "Service Unavailable");
+    else http_send_body(fd, "application/octet-stream", nullptr, r->data, r->len);
+}
+
+// ---------- 遠端控制: WebSocket /ws ----------
+
+static void http_base64(const uint8_t* data, size_t len, char* out) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = data[i] << 16 | (i + 1 < len ? data[i + 1] << 8 : 0) | (i + 2 < len ? data[i + 2] : 0);
+        *out++ = table[(v >> 18) & 0x3F];
+        *out++ = table[(v >> 12) & 0x3F];
+        *out++ = i + 1 < len ? table[(v >> 6) & 0x3F] : '=';
+        *out++ = i + 2 < len ? table[v & 0x3F] : '=';
+    }
+    *out = '\0';
+}
+
+// 伺服器送出的訊框不加遮罩
+static bool http_ws_send_frame(HttpWebSocket* ws, uint8_t opcode, const uint8_t* data, size_t len) {
+    uint8_t head[4] = { (uint8_t)(0x80 | opcode) };
+    size_t head_len = 2;
+    if (len < 126) {
+        head[1] = len;
+    } else {
+        head[1] = 126;
+        head[2] = len >> 8;
+        head[3] = len & 0xFF;
+        head_len = 4;
+    }
+    xSemaphoreTake(ws->send_lock, portMAX_DELAY);
+    bool ok = ws->sink.open && http_send_all(ws->fd, head, head_len) && (len == 0 || http_send_all(ws->fd, data, len));
+    xSemaphoreGive(ws->send_lock);
+    return ok;
+}
+
+static void http_ws_sink_send(RcSink* sink, const uint8_t* frame, size_t len) {
+    http_ws_send_frame((HttpWebSocket*)sink->context, 0x2, frame, len);
+}
+
+static bool http_recv_all(int fd, uint8_t* buf, size_t len) {
+    while (len > 0) {
+        int n = recv(fd, buf, len, 0);
+        if (n <= 0) return false;
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void http_ws_close(HttpWebSocket* ws, uint16_t code) {
+    uint8_t reason[2] = { (uint8_t)(code >> 8), (uint8_t)(code & 0xFF) };
+    http_ws_send_frame(ws, 0x8, reason, 2);
+}
+
+static void http_websocket_task(void* p) {
+    HttpWebSocket* ws = (HttpWebSocket*)p;
+    HttpServer* srv = ws->srv;
+    uint8_t payload[HTTP_WS_PAYLOAD_MAX];
+    while (srv->running) {
+        uint8_t head[2], ext[8], mask[4];
+        if (!http_recv_all(ws->fd, head, 2)) break;
+        uint8_t opcode = head[0] & 0x0F;
+        uint64_t len = head[1] & 0x7F;
+        if (len == 126) {
+            if (!http_recv_all(ws->fd, ext, 2)) break;
+            len = ext[0] << 8 | ext[1];
+        } else if (len == 127) {
+            if (!http_recv_all(ws->fd, ext, 8)) break;
+            len = 0;
+            for (uint8_t i = 0; i < 8; i++) len = len << 8 | ext[i];
+        }
+        // 客戶端訊框必須加遮罩; 不支援分段
+        if (!(head[1] & 0x80) || !(head[0] & 0x80) || len > HTTP_WS_PAYLOAD_MAX) {
+            http_ws_close(ws, len > HTTP_WS_PAYLOAD_MAX ? 1009 : 1002);
+            break;
+        }
+        if (!http_recv_all(ws->fd, mask, 4) || !http_recv_all(ws->fd, payload, len)) break;
+        for (size_t i = 0; i < len; i++) payload[i] ^= mask[i & 3];
+
+        if (opcode == 0x2) {
+            rc_submit(srv->remote, &ws->parser, payload, len, &ws->sink);
+        } else if (opcode == 0x9) {
+            http_ws_send_frame(ws, 0xA, payload, len);
+        } else if (opcode == 0x8) {
+            http_ws_close(ws, 1000);
+            break;
+        } else if (opcode != 0xA) {
+            http_ws_close(ws, 1003);   // 只接受二進位
+            break;
+        }
+    }
+    // 先關閉 sink 再關 socket: loop() 不會把回覆寫到被重複使用的 fd
+    xSemaphoreTake(ws->send_lock, portMAX_DELAY);
+    ws->sink.open = false;
+    ws->sink.generation++;
+    close(ws->fd);
+    ws->fd = -1;
+    xSemaphoreGive(ws->send_lock);
+    xSemaphoreTake(srv->lock, portMAX_DELAY);
+    ws->used = false;
+    xSemaphoreGive(srv->lock);
+    vTaskDelete(NULL);
+}
+
+// 完成握手並交給 WebSocket 任務; 回傳 false 時由呼叫端回應錯誤並關閉
+static bool http_websocket_accept(HttpServer* srv, int fd, const char* key) {
+    if (srv->remote == nullptr) return false;
+    HttpWebSocket* ws = nullptr;
+    xSemaphoreTake(srv->lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < HTTP_MAX_WEBSOCKETS && ws == nullptr; i++) {
+        if (!srv->websockets[i].used) {
+            ws = &srv->websockets[i];
+            ws->used = true;
+            ws->fd = fd;
+        }
+    }
+    xSemaphoreGive(srv->lock);
+    if (ws == nullptr) return false;
+
+    char text[64];
+    uint8_t digest[20];
+    char accept[32];
+    snprintf(text, sizeof(text), "%s" HTTP_WS_GUID, key);
+    sha1(text, strlen(text), digest);
+    http_base64(digest, sizeof(digest), accept);
+    char head[192];
+    snprintf(head, sizeof(head), "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", accept);
+    // 控制指令可能很久才來一次: 不設接收逾時
+    struct timeval tv = { 0, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    memset(&ws->parser, 0, sizeof(RcParser));
+    ws->sink.open = true;
+    if (!http_send_text(fd, head) ||
+        xTaskCreatePinnedToCore(http_websocket_task, "http_ws", 4096, ws, 1, nullptr, 0) != pdPASS) {
+        ws->sink.open = false;
+        xSemaphoreTake(srv->lock, portMAX_DELAY);
+        ws->used = false;
+        xSemaphoreGive(srv->lock);
+        return false;
+    }
+    return true;
+}
+
+// ---------- 控制埠 ----------
+
+static void http_handle_index(HttpServer* srv, int fd) {
+    const uint8_t* page = index_ov2640_html_gz;
+    size_t len = index_ov2640_html_gz_len;
+    if (srv->sensor_pid == OV3660_PID) {
+        page = index_ov3660_html_gz;
+        len = index_ov3660_html_gz_len;
+    } else if (srv->sensor_pid == OV5640_PID) {
+        page = index_ov5640_html_gz;
+        len = index_ov5640_html_gz_len;
+    }
+    http_send_body(fd, "text/html", "Content-Encoding: gzip\r\n", page, len);
+}
+
+static void http_handle_capture(HttpServer* srv, int fd) {
+    // 一定等一張新的: 舊的可能已經是幾秒前
+    SharedFrame* f = broadcast_snapshot(&srv->broadcast, HTTP_CAPTURE_TIMEOUT_MS);
+    if (f) {
+        http_send_body(fd, "image/jpeg", "Content-Disposition: inline; filename=capture.jpg\r\n", f->data, f->len);
+        shared_frame_release(f);
+    } else {
+        http_send_status(fd, 503, "Service Unavailable");
+    }
+}
+
+static void http_handle_stream_stats(HttpServer* srv, int fd) {
+    char json[HTTP_REPLY_MAX];
+    size_t len = broadcast_stats_json(&srv->broadcast, json, sizeof(json));
+    http_send_body(fd, "application/json", nullptr, json, len);
+}
+
+// 需要 loop() 執行的請求: 填好 command 後等待
+static void http_handle_command(HttpServer* srv, int fd, HttpCommandType type, const char* query) {
+    static const char* const keys[][12] = {
+        { nullptr },
+        { "val" },
+        { "reg", "mask", "val" },
+        { "reg", "mask" },
+        { "xclk" },
+        { "sx", "sy", "ex", "ey", "offx", "offy", "tx", "ty", "ox", "oy", "scale", "binning" },
+        { "bypass", "mul", "sys", "root", "pre", "seld5", "pclken", "pclk" },
+    };
+    if (xSemaphoreTake(srv->command_lock, pdMS_TO_TICKS(HTTP_COMMAND_TIMEOUT_MS)) != pdTRUE) {
+        http_send_status(fd, 503, "Service Unavailable");
+        return;
+    }
+    HttpCommand* cmd = &srv->command;
+    memset(cmd->args, 0, sizeof(cmd->args));
+    cmd->type = type;
+    bool ok = true;
+    for (uint8_t i = 0; i < 12 && keys[type][i]; i++) {
+        ok &= http_query_int(query, keys[type][i], &cmd->args[i]);
+    }
+    if (type == HTTP_CMD_CONTROL) ok &= http_query_value(query, "var", cmd->var, sizeof(cmd->var));
+    if (!ok) {
+        xSemaphoreGive(srv->command_lock);
+        http_send_status(fd, 400, "Bad Request");
+        return;
+    }
+    if (!http_run_command(srv)) {
+        xSemaphoreGive(srv->command_lock);
+        http_send_status(fd, 503, "Service Unavailable");
+        return;
+    }
+    if (type == HTTP_CMD_STATUS) {
+        http_send_body(fd, "application/json", nullptr, cmd->reply, strlen(cmd->reply));
+    } else if (type == HTTP_CMD_GET_REG) {
+        char text[16];
+        snprintf(text, sizeof(text), "%d", (int)cmd->result);
+        if (cmd->result < 0) http_send_status(fd, 500, "Internal Server Error");
+        else http_send_body(fd, "text/plain", nullptr, text, strlen(text));
+    } else if (cmd->result < 0) {
+        http_send_status(fd, 500, "Internal Server Error");
+    } else {
+        http_send_body(fd, "text/plain", nullptr, "", 0);
+    }
+    xSemaphoreGive(srv->command_lock);
+}
+
+// 回傳 true 表示 socket 已交給 WebSocket 任務, 呼叫端不要關閉
+static bool http_handle_control_client(HttpServer* srv, int fd) {
+    char req[HTTP_REQUEST_MAX];
+    char *path, *query;
+    bool post;
+    int used = http_read_request(fd, req, sizeof(req));
+    char* body = used > 0 ? strstr(req, "\r\n\r\n") + 4 : nullptr;
+    char upgrade[16] = "", key[32] = "", length[12] = "";
+    if (body) {
+        http_header_value(req, "Upgrade", upgrade, sizeof(upgrade));
+        http_header_value(req, "Sec-WebSocket-Key", key, sizeof(key));
+        http_header_value(req, "Content-Length", length, sizeof(length));
+    }
+    if (body == nullptr || !http_parse_request_line(req, &path, &query, &post)) {
+        http_send_status(fd, 400, "Bad Request");
+        return false;
+    }
+    srv->requests++;
+    if (post) {
+        if (!strcmp(path, "/rc")) http_handle_rc(srv, fd, (const uint8_t*)body, req + used - body, strtoul(length, nullptr, 10));
+        else http_send_status(fd, 404, "Not Found");
+        return false;
+    }
+    if (!strcmp(path, "/ws")) {
+        if (strcasecmp(upgrade, "websocket") != 0 || key[0] == '\0') http_send_status(fd, 400, "Bad Request");
+        else if (http_websocket_accept(srv, fd, key)) return true;
+        else http_send_status(fd, 503, "Service Unavailable");
+        return false;
+    }
+    if (!strcmp(path, "/") || !strcmp(path, "/index.html")) http_handle_index(srv, fd);
+    else if (!strcmp(path, "/capture")) http_handle_capture(srv, fd);
+    else if (!strcmp(path, "/stream_stats")) http_handle_stream_stats(srv, fd);
+    else if (!strcmp(path, "/status")) http_handle_command(srv, fd, HTTP_CMD_STATUS, query);
+    else if (!strcmp(path, "/control")) http_handle_command(srv, fd, HTTP_CMD_CONTROL, query);
+    else if (!strcmp(path, "/reg")) http_handle_command(srv, fd, HTTP_CMD_SET_REG, query);
+    else if (!strcmp(path, "/greg")) http_handle_command(srv, fd, HTTP_CMD_GET_REG, query);
+    else if (!strcmp(path, "/xclk")) http_handle_command(srv, fd, HTTP_CMD_XCLK, query);
+    else if (!strcmp(path, "/resolution")) http_handle_command(srv, fd, HTTP_CMD_RESOLUTION, query);
+    else if (!strcmp(path, "/pll")) http_handle_command(srv, fd, HTTP_CMD_PLL, query);
+    else http_send_status(fd, 404, "Not Found");
+    return false;
+}
+
+static void http_control_task(void* p) {
+    HttpServer* srv = (HttpServer*)p;
+    while (srv->running) {
+        int fd = accept(srv->control_fd, nullptr, nullptr);
+        if (fd < 0) {
+            delay(10);
+            continue;
+        }
+        http_set_timeouts(fd);
+        if (!http_handle_control_client(srv, fd)) close(fd);
+    }
+    vTaskDelete(NULL);
+}
+
+// ---------- 串流埠 ----------
+
+struct HttpStreamClient {
+    HttpServer* srv;
+    BroadcastClient* slot;
+    int fd;
+};
+
+static void http_stream_client_task(void* p) {
+    HttpStreamClient* client = (HttpStreamClient*)p;
+    HttpServer* srv = client->srv;
+    BroadcastClient* slot = client->slot;
+    int fd = client->fd;
+    delete client;
+
+    static const char* header =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: multipart/x-mixed-replace;boundary=" HTTP_STREAM_BOUNDARY "\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Cache-Control: no-cache\r\n\r\n";
+    bool ok = http_send_text(fd, header);
+    while (ok && srv->running) {
+        // 送的期間發布的影像只留最新一張, 其餘在 broadcast_publish 中丟掉
+        SharedFrame* f = broadcast_next(&srv->broadcast, slot, HTTP_STREAM_WAIT_MS);
+        if (f == nullptr) continue;
+        int64_t start = esp_timer_get_time();
+        char part[160];
+        snprintf(part, sizeof(part), "\r\n--" HTTP_STREAM_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %lld.%06lld\r\n\r\n",
+                 (unsigned)f->len, (long long)(f->timestamp_us / 1000000), (long long)(f->timestamp_us % 1000000));
+        ok = http_send_text(fd, part) && http_send_all(fd, f->data, f->len);
+        if (ok) broadcast_delivered(&srv->broadcast, slot, f, esp_timer_get_time() - start);
+        else shared_frame_release(f);
+    }
+    close(fd);
+    broadcast_leave(&srv->broadcast, slot);
+    vTaskDelete(NULL);
+}
+
+static void http_stream_task(void* p) {
+    HttpServer* srv = (HttpServer*)p;
+    while (srv->running) {
+        int fd = accept(srv->stream_fd, nullptr, nullptr);
+        if (fd < 0) {
+            delay(10);
+            continue;
+        }
+        http_set_timeouts(fd);
+        char req[HTTP_REQUEST_MAX];
+        char *path, *query;
+        if (http_read_request(fd, req, sizeof(req)) < 0 || !http_parse_request_line(req, &path, &query) || strcmp(path, "/stream") != 0) {
+            http_send_status(fd, 404, "Not Found");
+            close(fd);
+            continue;
+        }
+        BroadcastClient* slot = broadcast_join(&srv->broadcast);
+        if (slot == nullptr) {
+            http_send_status(fd, 503, "Service Unavailable");
+            close(fd);
+            continue;
+        }
+        int sndbuf = HTTP_STREAM_SNDBUF;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        HttpStreamClient* client = new HttpStreamClient{ srv, slot, fd };
+        if (xTaskCreatePinnedToCore(http_stream_client_task, "http_client", 8192, client, 1, nullptr, 0) != pdPASS) {
+            delete client;
+            close(fd);
+            broadcast_leave(&srv->broadcast, slot);
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+// ---------- 啟動 ----------
+
+// 網路連上後呼叫 (任何任務皆可); 之後 loop() 需呼叫 http_server_service 與 http_server_publish_*
+bool http_server_begin(HttpServer* srv, uint16_t control_port, uint16_t stream_port, uint16_t sensor_pid) {
+    srv->control_port = control_port;
+    srv->stream_port = stream_port;
+    srv->sensor_pid = sensor_pid;
+    if (srv->jpeg_quality == 0) srv->jpeg_quality = HTTP_JPEG_QUALITY;
+    srv->lock = xSemaphoreCreateMutex();
+    srv->command_lock = xSemaphoreCreateMutex();
+    srv->command_done = xSemaphoreCreateBinary();
+    if (srv->lock == nullptr || srv->command_lock == nullptr || srv->command_done == nullptr) return false;
+    if (!broadcast_init(&srv->broadcast)) return false;
+    srv->rc_reply.lock = xSemaphoreCreateMutex();
+    srv->rc_reply.replied = xSemaphoreCreateCounting(RC_QUEUE_LEN, 0);
+    if (srv->rc_reply.lock == nullptr || srv->rc_reply.replied == nullptr) return false;
+    srv->rc_reply.sink.send = http_rc_reply_send;
+    srv->rc_reply.sink.context = &srv->rc_reply;
+    for (uint8_t i = 0; i < HTTP_MAX_WEBSOCKETS; i++) {
+        HttpWebSocket* ws = &srv->websockets[i];
+        ws->srv = srv;
+        ws->fd = -1;
+        ws->send_lock = xSemaphoreCreateMutex();
+        ws->sink.send = http_ws_sink_send;
+        ws->sink.context = ws;
+        if (ws->send_lock == nullptr) return false;
+    }
+
+    srv->control_fd = http_listen(control_port);
+    srv->stream_fd = http_listen(stream_port);
+    if (srv->control_fd < 0 || srv->stream_fd < 0) {
+        Serial.printf("HTTP: cannot listen on %u/%u\n", control_port, stream_port);
+        if (srv->control_fd >= 0) close(srv->control_fd);
+        if (srv->stream_fd >= 0) close(srv->stream_fd);
+        return false;
+    }
+    srv->running = true;
+    // 網路任務放在核心 0, 影像處理 (loop) 在核心 1
+    if (xTaskCreatePinnedToCore(http_control_task, "http_ctrl", 8192, srv, 1, nullptr, 0) != pdPASS ||
+        xTaskCreatePinnedToCore(http_stream_task, "http_stream", 4096, srv, 1, nullptr, 0) != pdPASS) {
+        Serial.println("HTTP: failed to create server tasks");
+        srv->running = false;
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -1,7 +1,11 @@
+#ifndef __IMG_COMPUTING_H
+#define __IMG_COMPUTING_H
+
 #include <stdint.h>
 #include "esp32-hal.h"
 #include <Arduino.h>
 #include "esp_task_wdt.h"
+#include "esp_heap_caps.h"
 
 // 查表法轉換表格 (PROGMEM 存儲在Flash中)
 static const uint8_t five_to_eight[] PROGMEM = {
@@ -109,6 +113,289 @@ __attribute__((always_inline)) inline uint16_t IRAM_ATTR hsv_to_rgb565(HSV hsv)
     return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
 }
 
+// ==================== 畫面統計 (AE/AWB 用) ====================
+
+// 每 FRAME_STATS_STRIDE 個像素取樣一次, 在既有的處理迴圈中順便累加
+#define FRAME_STATS_STRIDE 16
+
+struct FrameStats {
+    uint32_t sum_r;      // 8-bit R 總和
+    uint32_t sum_g;      // 8-bit G 總和
+    uint32_t sum_b;      // 8-bit B 總和
+    uint32_t sum_y;      // 亮度總和
+    uint32_t clipped;    // 過曝取樣數 (Y >= 250)
+    uint32_t count;      // 取樣數
+};
+
+__attribute__((always_inline)) inline void IRAM_ATTR frame_stats_reset(FrameStats* stats) {
+    memset(stats, 0, sizeof(FrameStats));
+}
+
+__attribute__((always_inline)) inline void IRAM_ATTR frame_stats_sample(FrameStats* stats, uint16_t rgb) {
+    uint8_t r = five_to_eight[(rgb >> 11) & 0x1F];
+    uint8_t g = six_to_eight[(rgb >> 5) & 0x3F];
+    uint8_t b = five_to_eight[rgb & 0x1F];
+    uint8_t y = (77 * r + 150 * g + 29 * b) >> 8;
+    stats->sum_r += r;
+    stats->sum_g += g;
+    stats->sum_b += b;
+    stats->sum_y += y;
+    stats->clipped += (y >= 250);
+    stats->count++;
+}
+
+__attribute__((always_inline)) inline void frame_stats_merge(FrameStats* dst, const FrameStats* src) {
+    dst->sum_r += src->sum_r;
+    dst->sum_g += src->sum_g;
+    dst->sum_b += src->sum_b;
+    dst->sum_y += src->sum_y;
+    dst->clipped += src->clipped;
+    dst->count += src->count;
+}
+
+// 預覽模式沒有逐像素處理, 單獨做一次稀疏取樣 (byte_swapped: 緩衝區仍是感測器的大端序)
+void IRAM_ATTR collect_frame_stats(const uint16_t* buffer, uint32_t pixel_count, FrameStats* stats, bool byte_swapped) {
+    frame_stats_reset(stats);
+    for (uint32_t i = 0; i < pixel_count; i += FRAME_STATS_STRIDE) {
+        uint16_t px = buffer[i];
+        frame_stats_sample(stats, byte_swapped ? __builtin_bswap16(px) : px);
+    }
+}
+
+// ==================== 通道增益查表 (AWB 用) ====================
+
+// 每個通道的 RGB565 欄位直接映射到已移位的輸出欄位, 每像素 3 次查表
+struct ChannelGainLUT {
+    uint16_t r[32];
+    uint16_t g[64];
+    uint16_t b[32];
+    bool identity;
+};
+
+// 增益為 Q8 (256 = 1.0)
+void build_channel_gain_lut(ChannelGainLUT* lut, uint16_t gain_r, uint16_t gain_g, uint16_t gain_b) {
+    lut->identity = (gain_r == 256 && gain_g == 256 && gain_b == 256);
+    for (uint8_t i = 0; i < 32; i++) {
+        lut->r[i] = min(31, (i * gain_r + 128) >> 8) << 11;
+        lut->b[i] = min(31, (i * gain_b + 128) >> 8);
+    }
+    for (uint8_t i = 0; i < 64; i++) {
+        lut->g[i] = min(63, (i * gain_g + 128) >> 8) << 5;
+    }
+}
+
+__attribute__((always_inline)) inline uint16_t IRAM_ATTR apply_channel_gain(const ChannelGainLUT* lut, uint16_t rgb) {
+    return lut->r[rgb >> 11] | lut->g[(rgb >> 5) & 0x3F] | lut->b[rgb & 0x1F];
+}
+
+// 預覽模式用: 只套用通道增益 (byte_swapped: 緩衝區是感測器的大端序)
+void IRAM_ATTR apply_channel_gain_buffer(uint16_t* buffer, uint32_t pixel_count, const ChannelGainLUT* lut, bool byte_swapped) {
+    if (lut == nullptr || lut->identity) return;
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        if (byte_swapped) {
+            buffer[i] = __builtin_bswap16(apply_channel_gain(lut, __builtin_bswap16(buffer[i])));
+        } else {
+            buffer[i] = apply_channel_gain(lut, buffer[i]);
+        }
+    }
+}
+
+// ==================== 色彩校正矩陣 + 色調曲線 ====================
+// out = tone[clamp((M * in + 128) >> 8, 0, 255)], M 為 Q8 的 3x3 矩陣 (列 = 輸出 R/G/B)
+// 矩陣先乘進每個輸入通道的查表 (32 + 64 + 32 組, 已含捨入), 每像素只剩 3 次查表、6 次加法;
+// 色調曲線直接輸出已移位的 RGB565 欄位。
+// 換矩陣只重建 128 組乘積, 換曲線只重建 768 個 uint16, 每幀都可以改。
+
+struct ColorCorrectionTerm {
+    int32_t r, g, b;            // 對輸出 R / G / B 的貢獻 (Q8)
+};
+
+struct ColorCorrection {
+    int16_t matrix[9];
+    ColorCorrectionTerm from_r[32];
+    ColorCorrectionTerm from_g[64];
+    ColorCorrectionTerm from_b[32];
+    uint16_t tone_r[256];
+    uint16_t tone_g[256];
+    uint16_t tone_b[256];
+    bool identity;              // 矩陣與曲線都是恆等, 整段略過
+    bool identity_matrix;
+    bool identity_tone;
+};
+
+void color_correction_set_matrix(ColorCorrection* cc, const int16_t matrix[9]) {
+    memcpy(cc->matrix, matrix, sizeof(cc->matrix));
+    for (uint8_t i = 0; i < 32; i++) {
+        int32_t r = five_to_eight[i];
+        int32_t b = five_to_eight[i];
+        cc->from_r[i] = { matrix[0] * r + 128, matrix[3] * r + 128, matrix[6] * r + 128 };
+        cc->from_b[i] = { matrix[2] * b, matrix[5] * b, matrix[8] * b };
+    }
+    for (uint8_t i = 0; i < 64; i++) {
+        int32_t g = six_to_eight[i];
+        cc->from_g[i] = { matrix[1] * g, matrix[4] * g, matrix[7] * g };
+    }
+    static const int16_t unit[9] = { 256, 0, 0, 0, 256, 0, 0, 0, 256 };
+    cc->identity_matrix = memcmp(matrix, unit, sizeof(unit)) == 0;
+    cc->identity = cc->identity_matrix && cc->identity_tone;
+}
+
+// 各通道的 8 位元曲線, nullptr = 恆等
+void color_correction_set_tone(ColorCorrection* cc, const uint8_t* curve_r, const uint8_t* curve_g, const uint8_t* curve_b) {
+    cc->identity_tone = curve_r == nullptr && curve_g == nullptr && curve_b == nullptr;
+    for (uint16_t v = 0; v < 256; v++) {
+        cc->tone_r[v] = ((curve_r ? curve_r[v] : v) >> 3) << 11;
+        cc->tone_g[v] = ((curve_g ? curve_g[v] : v) >> 2) << 5;
+        cc->tone_b[v] = (curve_b ? curve_b[v] : v) >> 3;
+    }
+    cc->identity = cc->identity_matrix && cc->identity_tone;
+}
+
+// 三通道共用的 gamma 曲線 (gamma_q8: 256 = 1.0 恆等, >256 提亮暗部)
+void color_correction_set_gamma(ColorCorrection* cc, uint16_t gamma_q8) {
+    if (gamma_q8 == 256 || gamma_q8 == 0) {
+        color_correction_set_tone(cc, nullptr, nullptr, nullptr);
+        return;
+    }
+    uint8_t curve[256];
+    float inv = 256.0f / gamma_q8;
+    for (uint16_t v = 0; v < 256; v++) {
+        curve[v] = (uint8_t)(255.0f * powf(v / 255.0f, inv) + 0.5f);
+    }
+    color_correction_set_tone(cc, curve, curve, curve);
+}
+
+// 保持亮度的飽和度矩陣 (sat_q8: 256 = 不變, 0 = 灰階)
+void color_correction_saturation_matrix(int16_t matrix[9], int16_t sat_q8) {
+    static const int16_t luma[3] = { 77, 150, 29 };
+    for (uint8_t row = 0; row < 3; row++) {
+        for (uint8_t col = 0; col < 3; col++) {
+            matrix[row * 3 + col] = ((256 - sat_q8) * luma[col] + 128) / 256 + (row == col ? sat_q8 : 0);
+        }
+    }
+}
+
+void color_correction_init(ColorCorrection* cc) {
+    static const int16_t unit[9] = { 256, 0, 0, 0, 256, 0, 0, 0, 256 };
+    color_correction_set_tone(cc, nullptr, nullptr, nullptr);
+    color_correction_set_matrix(cc, unit);
+}
+
+__attribute__((always_inline)) inline uint16_t IRAM_ATTR apply_color_correction(const ColorCorrection* cc, uint16_t rgb) {
+    const ColorCorrectionTerm& r = cc->from_r[rgb >> 11];
+    const ColorCorrectionTerm& g = cc->from_g[(rgb >> 5) & 0x3F];
+    const ColorCorrectionTerm& b = cc->from_b[rgb & 0x1F];
+    int32_t out_r = constrain((r.r + g.r + b.r) >> 8, 0, 255);
+    int32_t out_g = constrain((r.g + g.g + b.g) >> 8, 0, 255);
+    int32_t out_b = constrain((r.b + g.b + b.b) >> 8, 0, 255);
+    return cc->tone_r[out_r] | cc->tone_g[out_g] | cc->tone_b[out_b];
+}
+
+// ==================== 時間域降噪 (多幀 EWMA) ====================
+// 每像素一個 uint32 累加器 (PSRAM), 三通道各自保留 4 位小數:
+//   R[20..28] G[10..19] B[0..8]
+// acc += (cur - acc) >> shift, shift 依該像素與累加值的差距查表:
+// 差距小 (雜訊) → 平均較多幀; 差距大 (移動) → shift 0, 直接採用目前像素, 避免殘影。
+// 更新與通道增益 / 顏色調整在同一個逐像素迴圈中完成。
+
+#define TEMPORAL_FRAC_BITS       4
+#define TEMPORAL_MAX_SHIFT       3      // 最多約等於 8 幀平均
+
+struct TemporalDenoise {
+    uint32_t* acc;               // 每像素累加器
+    uint32_t pixels;             // 累加器大小
+    bool primed;                 // false: 下一幀直接寫入累加器
+    uint8_t motion_shift[64];    // 差距 (6 位元尺度) → shift
+};
+
+// strength: 靜止像素的 shift (1 - TEMPORAL_MAX_SHIFT); noise: 視為雜訊的最大差距; motion: 視為移動的差距
+void temporal_denoise_init(TemporalDenoise* td, uint8_t strength, uint8_t noise, uint8_t motion) {
+    td->acc = nullptr;
+    td->pixels = 0;
+    td->primed = false;
+    strength = constrain(strength, 1, TEMPORAL_MAX_SHIFT);
+    motion = max<uint8_t>(motion, noise + 1);
+    for (int d = 0; d < 64; d++) {
+        if (d <= noise) td->motion_shift[d] = strength;
+        else if (d >= motion) td->motion_shift[d] = 0;
+        else td->motion_shift[d] = strength - (strength * (d - noise) + (motion - noise) / 2) / (motion - noise);
+    }
+}
+
+// 尺寸改變時重新配置 (優先 PSRAM); 之後第一幀重新填入
+bool temporal_denoise_alloc(TemporalDenoise* td, uint32_t pixels) {
+    if (pixels != td->pixels || td->acc == nullptr) {
+        heap_caps_free(td->acc);
+        td->acc = (uint32_t*)heap_caps_malloc(pixels * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+        if (td->acc == nullptr) {
+            td->acc = (uint32_t*)heap_caps_malloc(pixels * sizeof(uint32_t), MALLOC_CAP_8BIT);
+        }
+        td->pixels = td->acc ? pixels : 0;
+        td->primed = false;
+    }
+    return td->acc != nullptr;
+}
+
+// 有幀沒經過累加器時呼叫, 避免之後混入過時的畫面
+__attribute__((always_inline)) inline void temporal_denoise_reset(TemporalDenoise* td) {
+    td->primed = false;
+}
+
+__attribute__((always_inline)) inline uint32_t IRAM_ATTR temporal_pack(uint16_t rgb) {
+    return ((uint32_t)(rgb >> 11) << (20 + TEMPORAL_FRAC_BITS)) |
+           ((uint32_t)((rgb >> 5) & 0x3F) << (10 + TEMPORAL_FRAC_BITS)) |
+           ((uint32_t)(rgb & 0x1F) << TEMPORAL_FRAC_BITS);
+}
+
+// 單通道 EWMA, 朝零捨入讓 acc 不會因負向位移偏低
+__attribute__((always_inline)) inline int32_t IRAM_ATTR temporal_blend(int32_t acc, int32_t cur, uint8_t shift) {
+    int32_t d = cur - acc;
+    return acc + (d >= 0 ? d >> shift : -((-d) >> shift));
+}
+
+// 更新一個像素的累加器並回傳降噪後的 RGB565
+__attribute__((always_inline)) inline uint16_t IRAM_ATTR temporal_update(uint32_t* acc, const uint8_t* motion_shift, uint16_t rgb) {
+    uint32_t a = *acc;
+    int32_t ar = (a >> 20) & 0x1FF, ag = (a >> 10) & 0x3FF, ab = a & 0x1FF;
+    int32_t cr = (rgb >> 11) << TEMPORAL_FRAC_BITS;
+    int32_t cg = ((rgb >> 5) & 0x3F) << TEMPORAL_FRAC_BITS;
+    int32_t cb = (rgb & 0x1F) << TEMPORAL_FRAC_BITS;
+
+    // 差距以 6 位元尺度的最大通道差計
+    int32_t d = max(max(abs(cr - ar) << 1, abs(cg - ag)), abs(cb - ab) << 1) >> TEMPORAL_FRAC_BITS;
+    uint8_t shift = motion_shift[min(d, 63)];
+
+    ar = temporal_blend(ar, cr, shift);
+    ag = temporal_blend(ag, cg, shift);
+    ab = temporal_blend(ab, cb, shift);
+    *acc = ((uint32_t)ar << 20) | ((uint32_t)ag << 10) | (uint32_t)ab;
+
+    const int32_t half = 1 << (TEMPORAL_FRAC_BITS - 1);
+    return (min<int32_t>((ar + half) >> TEMPORAL_FRAC_BITS, 31) << 11) |
+           (min<int32_t>((ag + half) >> TEMPORAL_FRAC_BITS, 63) << 5) |
+           min<int32_t>((ab + half) >> TEMPORAL_FRAC_BITS, 31);
+}
+
+// ==================== 色調遮罩 (色塊追蹤用) ====================
+// 在顏色處理迴圈中順便標出落在指定色調範圍內的像素, 每行 stride 個 uint32 位元
+// (每行從新的 word 開始, 兩個核心各自負責整數行, 不會寫到同一個 word)。
+
+struct HueMask {
+    uint32_t* bits;
+    uint16_t width;
+    uint16_t height;
+    uint16_t stride;        // 每行 uint32 數
+    uint8_t target_hue;     // 與 ColorAdjustment 相同的 0-255 色調
+    uint8_t range;
+    uint8_t min_sat;        // 太灰的像素色調不可靠
+    uint8_t min_val;        // 太暗的像素色調不可靠
+};
+
+__attribute__((always_inline)) inline bool IRAM_ATTR hue_mask_match(const HueMask* mask, HSV hsv) {
+    uint8_t diff = abs(hsv.h - mask->target_hue);
+    return (diff <= mask->range || (255 - diff) <= mask->range) && hsv.s >= mask->min_sat && hsv.v >= mask->min_val;
+}
+
 // ==================== 平行處理結構 ====================
 
 struct MultiColorParams {
@@ -116,55 +403,136 @@ struct MultiColorParams {
     uint32_t len;
     ColorAdjustment* adjustments;
     uint8_t num_adjustments;
+    const ChannelGainLUT* gains;   // 可為 nullptr
+    const ColorCorrection* ccm;    // 可為 nullptr
+    FrameStats* stats;             // 可為 nullptr
+    TemporalDenoise* temporal;     // 可為 nullptr
+    uint32_t* temporal_acc;        // 這一段對應的累加器起點
+    HueMask* mask;                 // 可為 nullptr; 非空時 buf 必須從 first_row 的行首開始
+    uint16_t first_row;
 };
 
+// ==================== 單一像素顏色調整 ====================
+
+// 已經算好 HSV 時使用 (色調遮罩與顏色調整共用一次轉換)
+__attribute__((always_inline)) inline uint16_t IRAM_ATTR adjust_pixel_colors_hsv(uint16_t rgb, HSV hsv, ColorAdjustment* adjustments, uint8_t num_adjustments) {
+    for (uint8_t j = 0; j < num_adjustments; j++) {
+        ColorAdjustment adj = adjustments[j];
+        uint8_t diff = abs(hsv.h - adj.target_hue);
+
+        // 檢查色調範圍
+        if (diff <= adj.range || (255 - diff) <= adj.range) {
+            // 應用色調調整
+            int32_t new_hue = hsv.h + adj.hue_shift;
+            if (new_hue < 0) new_hue += 256;
+            hsv.h = new_hue & 0xFF;
+
+            // 應用飽和度調整
+            if (adj.sat_shift > 0) {
+                hsv.s = min(255, hsv.s + adj.sat_shift);
+            } else if (adj.sat_shift < 0) {
+                hsv.s = max(0, hsv.s - abs(adj.sat_shift));
+            }
+
+            return hsv_to_rgb565(hsv);
+        }
+    }
+    return rgb;
+}
+
+__attribute__((always_inline)) inline uint16_t IRAM_ATTR adjust_pixel_colors(uint16_t rgb, ColorAdjustment* adjustments, uint8_t num_adjustments) {
+    return adjust_pixel_colors_hsv(rgb, rgb565_to_hsv(rgb), adjustments, num_adjustments);
+}
+
+// 處理一段連續像素: 取樣統計 (原始像素) → 時間域降噪 → 通道增益 → 色彩校正 → 色調遮罩 → 顏色調整
+void IRAM_ATTR adjust_colors_span(MultiColorParams* args) {
+    uint16_t* buf = args->buf;
+    const ChannelGainLUT* gains = (args->gains && !args->gains->identity) ? args->gains : nullptr;
+    const ColorCorrection* ccm = (args->ccm && !args->ccm->identity) ? args->ccm : nullptr;
+    FrameStats* stats = args->stats;
+    uint32_t* acc = args->temporal ? args->temporal_acc : nullptr;
+    const uint8_t* motion_shift = args->temporal ? args->temporal->motion_shift : nullptr;
+    bool prime = args->temporal && !args->temporal->primed;
+    const HueMask* mask = args->mask;
+    uint32_t* mask_row = mask ? mask->bits + (size_t)args->first_row * mask->stride : nullptr;
+    uint16_t mask_x = 0;
+    uint32_t mask_word = 0;
+    if (stats) frame_stats_reset(stats);
+
+    for (uint32_t i = 0; i < args->len; i++) {
+        uint16_t px = buf[i];
+        if (stats && (i % FRAME_STATS_STRIDE) == 0) {
+            frame_stats_sample(stats, px);
+        }
+        if (prime) {
+            acc[i] = temporal_pack(px);
+        } else if (acc) {
+            px = temporal_update(&acc[i], motion_shift, px);
+        }
+        if (gains) {
+            px = apply_channel_gain(gains, px);
+        }
+        if (ccm) {
+            px = apply_color_correction(ccm, px);
+        }
+        if (mask) {
+            HSV hsv = rgb565_to_hsv(px);
+            mask_word |= (uint32_t)hue_mask_match(mask, hsv) << (mask_x & 31);
+            if ((mask_x & 31) == 31 || mask_x == mask->width - 1) {
+                mask_row[mask_x >> 5] = mask_word;
+                mask_word = 0;
+            }
+            if (++mask_x == mask->width) {
+                mask_x = 0;
+                mask_row += mask->stride;
+            }
+            if (args->num_adjustments) {
+                px = adjust_pixel_colors_hsv(px, hsv, args->adjustments, args->num_adjustments);
+            }
+        } else if (args->num_adjustments) {
+            px = adjust_pixel_colors(px, args->adjustments, args->num_adjustments);
+        }
+        buf[i] = px;
+    }
+}
+
 // ==================== 多重顏色平行處理 ====================
 
 void IRAM_ATTR adjust_multiple_colors_parallel(uint16_t* buffer, uint32_t pixel_count, 
-                                             ColorAdjustment* adjustments, uint8_t num_adjustments) {
-    if (num_adjustments == 0 || buffer == nullptr) return;
+                                             ColorAdjustment* adjustments, uint8_t num_adjustments,
+                                             const ChannelGainLUT* gains = nullptr, FrameStats* stats = nullptr,
+                                             TemporalDenoise* temporal = nullptr, HueMask* mask = nullptr,
+                                             const ColorCorrection* ccm = nullptr) {
+    if (buffer == nullptr) return;
+    if (temporal && (temporal->acc == nullptr || temporal->pixels != pixel_count)) temporal = nullptr;
+    if (mask && (mask->bits == nullptr || (uint32_t)mask->width * mask->height != pixel_count)) mask = nullptr;
+    if (num_adjustments == 0 && (gains == nullptr || gains->identity) && (ccm == nullptr || ccm->identity) &&
+        stats == nullptr && temporal == nullptr && mask == nullptr) return;
     
     TaskHandle_t task_handle = nullptr;
+    FrameStats second_stats;
+    // 有遮罩時以整行切分
+    uint16_t split_row = mask ? mask->height / 2 : 0;
+    uint32_t split = mask ? (uint32_t)split_row * mask->width : pixel_count / 2;
     
     // 為第二核心建立參數
     MultiColorParams* params = new MultiColorParams();
-    params->buf = buffer + pixel_count / 2;
-    params->len = pixel_count - pixel_count / 2;
+    params->buf = buffer + split;
+    params->len = pixel_count - split;
     params->adjustments = adjustments;
     params->num_adjustments = num_adjustments;
+    params->gains = gains;
+    params->ccm = ccm;
+    params->stats = stats ? &second_stats : nullptr;
+    params->temporal = temporal;
+    params->temporal_acc = temporal ? temporal->acc + split : nullptr;
+    params->mask = mask;
+    params->first_row = split_row;
 
     // 第二核心任務函數
     auto task_func = [](void* p) {
         MultiColorParams* args = (MultiColorParams*)p;
-        
-        for (uint32_t i = 0; i < args->len; i++) {
-            HSV hsv = rgb565_to_hsv(args->buf[i]);
-            bool adjusted = false;
-            
-            for (uint8_t j = 0; j < args->num_adjustments && !adjusted; j++) {
-                ColorAdjustment adj = args->adjustments[j];
-                uint8_t diff = abs(hsv.h - adj.target_hue);
-                
-                // 檢查色調範圍
-                if (diff <= adj.range || (255 - diff) <= adj.range) {
-                    // 應用色調調整
-                    int32_t new_hue = hsv.h + adj.hue_shift;
-                    if (new_hue < 0) new_hue += 256;
-                    hsv.h = new_hue & 0xFF;
-                    
-                    // 應用飽和度調整
-                    if (adj.sat_shift > 0) {
-                        hsv.s = min(255, hsv.s + adj.sat_shift);
-                    } else if (adj.sat_shift < 0) {
-                        hsv.s = max(0, hsv.s - abs(adj.sat_shift));
-                    }
-                    
-                    args->buf[i] = hsv_to_rgb565(hsv);
-                    adjusted = true;
-                }
-            }
-        }
-        
+        adjust_colors_span(args);
         delete args;
         vTaskDelete(NULL);
     };
@@ -182,63 +550,287 @@ void IRAM_ATTR adjust_multiple_colors_parallel(uint16_t* buffer, uint32_t pixel_
 
     if (result != pdPASS) {
         Serial.println("Failed to create task! Falling back to single core.");
-        delete params;
         // 單核心備援處理
-        for (uint32_t i = 0; i < pixel_count; i++) {
-            HSV hsv = rgb565_to_hsv(buffer[i]);
-            bool adjusted = false;
-            
-            for (uint8_t j = 0; j < num_adjustments && !adjusted; j++) {
-                ColorAdjustment adj = adjustments[j];
-                uint8_t diff = abs(hsv.h - adj.target_hue);
-                
-                if (diff <= adj.range || (255 - diff) <= adj.range) {
-                    int32_t new_hue = hsv.h + adj.hue_shift;
-                    if (new_hue < 0) new_hue += 256;
-                    hsv.h = new_hue & 0xFF;
-                    
-                    if (adj.sat_shift > 0) {
-                        hsv.s = min(255, hsv.s + adj.sat_shift);
-                    } else if (adj.sat_shift < 0) {
-                        hsv.s = max(0, hsv.s - abs(adj.sat_shift));
-                    }
-                    
-                    buffer[i] = hsv_to_rgb565(hsv);
-                    adjusted = true;
-                }
-            }
-        }
+        params->buf = buffer;
+        params->len = pixel_count;
+        params->stats = stats;
+        params->temporal_acc = temporal ? temporal->acc : nullptr;
+        params->first_row = 0;
+        adjust_colors_span(params);
+        delete params;
+        if (temporal) temporal->primed = true;
         return;
     }
 
     // 第一核心處理前半部分
-    uint32_t half_count = pixel_count / 2;
-    for (uint32_t i = 0; i < half_count; i++) {
-        HSV hsv = rgb565_to_hsv(buffer[i]);
-        bool adjusted = false;
-        
-        for (uint8_t j = 0; j < num_adjustments && !adjusted; j++) {
-            ColorAdjustment adj = adjustments[j];
-            uint8_t diff = abs(hsv.h - adj.target_hue);
-            
-            if (diff <= adj.range || (255 - diff) <= adj.range) {
-                int32_t new_hue = hsv.h + adj.hue_shift;
-                if (new_hue < 0) new_hue += 256;
-                hsv.h = new_hue & 0xFF;
-                
-                if (adj.sat_shift > 0) {
-                    hsv.s = min(255, hsv.s + adj.sat_shift);
-                } else if (adj.sat_shift < 0) {
-                    hsv.s = max(0, hsv.s - abs(adj.sat_shift));
-                }
-                
-                buffer[i] = hsv_to_rgb565(hsv);
-                adjusted = true;
+    MultiColorParams first = { buffer, split, adjustments, num_adjustments, gains, ccm, stats,
+                               temporal, temporal ? temporal->acc : nullptr, mask, 0 };
+    adjust_colors_span(&first);
+
+    // 等待第二核心任務完成
+    if (task_handle != nullptr) {
+        while (eTaskGetState(task_handle) != eDeleted) {
+            delay(1);
+        }
+    }
+    if (stats) frame_stats_merge(stats, &second_stats);
+    if (temporal) temporal->primed = true;
+}
+
+// ==================== 3x3 降噪 (滾動行緩衝) ====================
+// 三種濾波器, 輸入/輸出皆為原生位元組順序 RGB565, 就地處理:
+//   - DENOISE_BOX      : 可分離 3x3 平均, 水平和在載入行時算一次 (三通道打包在 uint32 一起加)
+//   - DENOISE_MEDIAN   : 3x3 中值, 每欄先以排序網路排好, 再取 max(低) / 中(中) / min(高) 的中值
+//   - DENOISE_BILATERAL: 雙邊濾波近似, 空間權重 1-2-1, 色差權重查表
+// 每個核心只保留 3 行原始資料 (環狀) + 1 行下邊界備份, 放在內部 SRAM, 不需整幀暫存。
+// 上半部在目前核心, 下半部在另一個核心; 兩半交界的行在開工前先複製好。
+
+enum DenoiseFilter : uint8_t {
+    DENOISE_OFF = 0,
+    DENOISE_BOX,
+    DENOISE_MEDIAN,
+    DENOISE_BILATERAL
+};
+
+#define DENOISE_BILATERAL_SIGMA  6     // 色差標準差 (6 位元通道尺度)
+
+struct DenoiseParams {
+    uint16_t* buf;
+    uint16_t width;
+    uint16_t height;
+    uint16_t y_start;        // 負責的行 [y_start, y_end)
+    uint16_t y_end;
+    DenoiseFilter filter;
+    uint32_t* lines;         // 3 行環狀緩衝 + 1 行邊界備份, 每行 width 個 uint32
+};
+
+static uint8_t denoise_range_lut[64];
+static bool denoise_range_lut_ready = false;
+static uint32_t* denoise_line_pool = nullptr;
+static size_t denoise_line_pool_words = 0;
+
+static void denoise_build_range_lut() {
+    for (int d = 0; d < 64; d++) {
+        float w = expf(-(float)(d * d) / (2.0f * DENOISE_BILATERAL_SIGMA * DENOISE_BILATERAL_SIGMA));
+        denoise_range_lut[d] = (uint8_t)(w * 255.0f + 0.5f);
+    }
+    denoise_range_lut_ready = true;
+}
+
+// 把 RGB565 展開成 R[22..31] G[11..21] B[0..10], 九個像素相加也不會互相溢位
+__attribute__((always_inline)) inline uint32_t IRAM_ATTR denoise_expand(uint16_t p) {
+    return ((uint32_t)(p & 0xF800) << 11) | ((uint32_t)(p & 0x07E0) << 6) | (p & 0x001F);
+}
+
+__attribute__((always_inline)) inline void IRAM_ATTR denoise_sort2(uint8_t &a, uint8_t &b) {
+    uint8_t lo = min(a, b);
+    b = max(a, b);
+    a = lo;
+}
+
+__attribute__((always_inline)) inline uint8_t IRAM_ATTR denoise_med3(uint8_t a, uint8_t b, uint8_t c) {
+    return max(min(a, b), min(max(a, b), c));
+}
+
+// 邏輯行 y (可為 -1 或 height) 放進環狀緩衝; 邊界以複製最近的行處理
+static void IRAM_ATTR denoise_load_row(DenoiseParams* p, int32_t y) {
+    int32_t src_y = constrain(y, 0, p->height - 1);
+    const uint16_t* src = p->buf + (size_t)src_y * p->width;
+    if (src_y >= p->y_end) {
+        src = (const uint16_t*)(p->lines + 3 * p->width);   // 另一個核心負責的行, 用開工前的備份
+    }
+    uint32_t* slot = p->lines + ((y + 3) % 3) * p->width;
+    uint16_t w = p->width;
+
+    if (p->filter == DENOISE_BOX) {
+        // 水平 3 點和
+        uint32_t left = denoise_expand(src[0]);
+        uint32_t center = left;
+        for (uint16_t x = 0; x < w; x++) {
+            uint32_t right = denoise_expand(src[x + 1 < w ? x + 1 : x]);
+            slot[x] = left + center + right;
+            left = center;
+            center = right;
+        }
+    } else {
+        memcpy(slot, src, w * sizeof(uint16_t));
+    }
+}
+
+static void IRAM_ATTR denoise_box_row(uint16_t* out, const uint32_t* a, const uint32_t* b, const uint32_t* c, uint16_t w) {
+    for (uint16_t x = 0; x < w; x++) {
+        uint32_t s = a[x] + b[x] + c[x];
+        // x * 57 >> 9 ≈ x / 9
+        uint16_t r = (((s >> 22) & 0x3FF) * 57) >> 9;
+        uint16_t g = (((s >> 11) & 0x7FF) * 57) >> 9;
+        uint16_t bl = ((s & 0x7FF) * 57) >> 9;
+        out[x] = (r << 11) | (g << 5) | bl;
+    }
+}
+
+// 一欄三個像素, 每通道排序後的 低/中/高
+struct DenoiseColumn {
+    uint8_t lo[3];
+    uint8_t mid[3];
+    uint8_t hi[3];
+};
+
+__attribute__((always_inline)) inline void IRAM_ATTR denoise_sort_column(uint16_t p0, uint16_t p1, uint16_t p2, DenoiseColumn* col) {
+    static const uint8_t shift[3] = {11, 5, 0};
+    static const uint8_t mask[3] = {0x1F, 0x3F, 0x1F};
+    for (int c = 0; c < 3; c++) {
+        uint8_t v0 = (p0 >> shift[c]) & mask[c];
+        uint8_t v1 = (p1 >> shift[c]) & mask[c];
+        uint8_t v2 = (p2 >> shift[c]) & mask[c];
+        denoise_sort2(v0, v1);
+        denoise_sort2(v1, v2);
+        denoise_sort2(v0, v1);
+        col->lo[c] = v0;
+        col->mid[c] = v1;
+        col->hi[c] = v2;
+    }
+}
+
+static void IRAM_ATTR denoise_median_row(uint16_t* out, const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t w) {
+    // 滑動視窗: 每欄只排序一次, 三個位置共用 (cols 以 x % 3 輪替, 免去複製)
+    DenoiseColumn cols[3];
+    denoise_sort_column(a[0], b[0], c[0], &cols[2]);
+    cols[0] = cols[2];
+    for (uint16_t x = 0; x < w; x++) {
+        uint16_t xr = x + 1 < w ? x + 1 : x;
+        DenoiseColumn& l = cols[(x + 2) % 3];
+        DenoiseColumn& m = cols[x % 3];
+        DenoiseColumn& r = cols[(x + 1) % 3];
+        denoise_sort_column(a[xr], b[xr], c[xr], &r);
+        uint8_t ch[3];
+        for (int k = 0; k < 3; k++) {
+            uint8_t lo = max(max(l.lo[k], m.lo[k]), r.lo[k]);
+            uint8_t mid = denoise_med3(l.mid[k], m.mid[k], r.mid[k]);
+            uint8_t hi = min(min(l.hi[k], m.hi[k]), r.hi[k]);
+            ch[k] = denoise_med3(lo, mid, hi);
+        }
+        out[x] = (ch[0] << 11) | (ch[1] << 5) | ch[2];
+    }
+}
+
+static void IRAM_ATTR denoise_bilateral_row(uint16_t* out, const uint16_t* a, const uint16_t* b, const uint16_t* c, uint16_t w) {
+    static const uint8_t spatial[9] = {1, 2, 1, 2, 4, 2, 1, 2, 1};
+    const uint16_t* rows[3] = {a, b, c};
+    for (uint16_t x = 0; x < w; x++) {
+        uint16_t xs[3] = {(uint16_t)(x ? x - 1 : 0), x, (uint16_t)(x + 1 < w ? x + 1 : x)};
+        uint16_t cp = b[x];
+        int cr = (cp >> 11) << 1, cg = (cp >> 5) & 0x3F, cb = (cp & 0x1F) << 1;
+        uint32_t sum_r = 0, sum_g = 0, sum_b = 0, sum_w = 0;
+        for (int j = 0; j < 3; j++) {
+            for (int i = 0; i < 3; i++) {
+                uint16_t np = rows[j][xs[i]];
+                uint8_t r = np >> 11, g = (np >> 5) & 0x3F, bl = np & 0x1F;
+                // 色差以 6 位元尺度的最大通道差計
+                int d = max(max(abs((r << 1) - cr), abs(g - cg)), abs((bl << 1) - cb));
+                uint32_t wgt = spatial[j * 3 + i] * denoise_range_lut[d];
+                sum_r += r * wgt;
+                sum_g += g * wgt;
+                sum_b += bl * wgt;
+                sum_w += wgt;
             }
         }
+        // 中心點權重 4 * 255 > 0, 不會除以零
+        uint32_t half = sum_w >> 1;
+        out[x] = (((sum_r + half) / sum_w) << 11) | (((sum_g + half) / sum_w) << 5) | ((sum_b + half) / sum_w);
     }
+}
+
+// 開工前 (單執行緒) 把上邊界兩行與下邊界備份好
+static void denoise_prepare(DenoiseParams* p) {
+    if (p->y_end < p->height) {
+        memcpy(p->lines + 3 * p->width, p->buf + (size_t)p->y_end * p->width, p->width * sizeof(uint16_t));
+    }
+    denoise_load_row(p, (int32_t)p->y_start - 1);
+    denoise_load_row(p, p->y_start);
+}
+
+static void IRAM_ATTR denoise_rows(DenoiseParams* p) {
+    uint16_t w = p->width;
+    for (int32_t y = p->y_start; y < p->y_end; y++) {
+        denoise_load_row(p, y + 1);
+        uint32_t* above = p->lines + ((y + 2) % 3) * w;
+        uint32_t* center = p->lines + (y % 3) * w;
+        uint32_t* below = p->lines + ((y + 1) % 3) * w;
+        uint16_t* out = p->buf + (size_t)y * w;
+        switch (p->filter) {
+            case DENOISE_BOX:
+                denoise_box_row(out, above, center, below, w);
+                break;
+            case DENOISE_MEDIAN:
+                denoise_median_row(out, (uint16_t*)above, (uint16_t*)center, (uint16_t*)below, w);
+                break;
+            case DENOISE_BILATERAL:
+                denoise_bilateral_row(out, (uint16_t*)above, (uint16_t*)center, (uint16_t*)below, w);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// 行緩衝只在寬度變大時重新配置 (優先內部 SRAM)
+static uint32_t* denoise_alloc_lines(size_t words) {
+    if (words <= denoise_line_pool_words) return denoise_line_pool;
+    heap_caps_free(denoise_line_pool);
+    denoise_line_pool = (uint32_t*)heap_caps_malloc(words * sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (denoise_line_pool == nullptr) {
+        denoise_line_pool = (uint32_t*)heap_caps_malloc(words * sizeof(uint32_t), MALLOC_CAP_8BIT);
+    }
+    denoise_line_pool_words = denoise_line_pool ? words : 0;
+    return denoise_line_pool;
+}
+
+void process_noisy_image(uint16_t* buffer, uint16_t width, uint16_t height, DenoiseFilter filter = DENOISE_MEDIAN) {
+    if (buffer == nullptr || filter == DENOISE_OFF || width < 2 || height < 2) return;
+    if (filter == DENOISE_BILATERAL && !denoise_range_lut_ready) denoise_build_range_lut();
+
+    size_t lines_per_core = 4 * (size_t)width;
+    uint32_t* lines = denoise_alloc_lines(2 * lines_per_core);
+    if (lines == nullptr) {
+        Serial.println("Denoise line buffer alloc failed");
+        return;
+    }
+
+    TaskHandle_t task_handle = nullptr;
+    uint16_t mid = height / 2;
+    DenoiseParams first = { buffer, width, height, 0, mid, filter, lines };
+    DenoiseParams* second = new DenoiseParams{ buffer, width, height, mid, height, filter, lines + lines_per_core };
+    // 兩半都先備份交界行, 之後才開始覆寫
+    denoise_prepare(&first);
+    denoise_prepare(second);
+
+    auto task_func = [](void* p) {
+        DenoiseParams* args = (DenoiseParams*)p;
+        denoise_rows(args);
+        delete args;
+        vTaskDelete(NULL);
+    };
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        task_func,
+        "denoise_task",
+        4096,
+        second,
+        1,
+        &task_handle,
+        !xPortGetCoreID()
+    );
+
+    if (result != pdPASS) {
+        Serial.println("Failed to create task! Falling back to single core.");
+        denoise_rows(&first);
+        denoise_rows(second);
+        delete second;
+        return;
+    }
+
+    denoise_rows(&first);
 
-    // 等待第二核心任務完成
     if (task_handle != nullptr) {
         while (eTaskGetState(task_handle) != eDeleted) {
             delay(1);
@@ -289,3 +881,4 @@ void IRAM_ATTR adjust_multiple_colors_parallel(uint16_t* buffer, uint32_t pixel_
 //     }
 // }
 
+#endif
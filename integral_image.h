@@ -0,0 +1,166 @@
+#ifndef __INTEGRAL_IMAGE_H
+#define __INTEGRAL_IMAGE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "esp_heap_caps.h"
+#include "img_computing.h"
+
+// ==================== 積分影像 (亮度) ====================
+// ii[y][x] = 左上角 (0,0) 到 (x-1,y-1) 的亮度總和, 大小 (width+1) x (height+1),
+// 第 0 行 / 第 0 列為 0, 任何矩形的總和只需 4 次讀取。
+// 建立分兩階段, 兩個核心各做一半:
+//   1. 上下兩半各自做局部積分 (下半部假設上方全為 0)
+//   2. 下半部每一行加上上半部最後一行 (兩個核心再各分一半的行)
+// 8 位元亮度在 VGA 以下總和不會超過 uint32。
+
+struct IntegralImage {
+    uint32_t* data;
+    uint16_t width;         // 原影像寬
+    uint16_t height;        // 原影像高
+    uint32_t capacity;      // data 可容納的 uint32 數
+};
+
+struct IntegralParams {
+    IntegralImage* ii;
+    const uint16_t* buffer;
+    uint16_t y_start;       // 原影像行 [y_start, y_end)
+    uint16_t y_end;
+    bool byte_swapped;
+    uint8_t phase;          // 1 = 局部積分, 2 = 加上上半部最後一行
+};
+
+__attribute__((always_inline)) inline uint8_t IRAM_ATTR integral_luma(uint16_t rgb) {
+    return (77 * five_to_eight[rgb >> 11] + 150 * six_to_eight[(rgb >> 5) & 0x3F] + 29 * five_to_eight[rgb & 0x1F]) >> 8;
+}
+
+bool integral_image_alloc(IntegralImage* ii, uint16_t width, uint16_t height) {
+    uint32_t words = (uint32_t)(width + 1) * (height + 1);
+    if (words > ii->capacity) {
+        heap_caps_free(ii->data);
+        ii->data = (uint32_t*)heap_caps_malloc(words * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+        if (ii->data == nullptr) {
+            ii->data = (uint32_t*)heap_caps_malloc(words * sizeof(uint32_t), MALLOC_CAP_8BIT);
+        }
+        ii->capacity = ii->data ? words : 0;
+        if (ii->data == nullptr) return false;
+    }
+    ii->width = width;
+    ii->height = height;
+    return true;
+}
+
+// 階段 1: 局部積分, 以 y_start 的上一行為 0
+static void IRAM_ATTR integral_local_rows(IntegralParams* p) {
+    IntegralImage* ii = p->ii;
+    uint32_t stride = ii->width + 1;
+    uint32_t* above = ii->data + (uint32_t)p->y_start * stride;
+    if (p->y_start == 0) memset(above, 0, stride * sizeof(uint32_t));
+    for (uint16_t y = p->y_start; y < p->y_end; y++) {
+        const uint16_t* src = p->buffer + (size_t)y * ii->width;
+        uint32_t* row = ii->data + (uint32_t)(y + 1) * stride;
+        uint32_t run = 0;
+        row[0] = 0;
+        for (uint16_t x = 0; x < ii->width; x++) {
+            uint16_t px = p->byte_swapped ? __builtin_bswap16(src[x]) : src[x];
+            run += integral_luma(px);
+            // 下半部第一行不加上一行 (上一行屬於另一個核心, 階段 2 才補)
+            row[x + 1] = run + (y == p->y_start ? 0 : above[x + 1]);
+        }
+        above = row;
+    }
+}
+
+// 階段 2: 把 carry 行加到 [y_start, y_end) 的積分行
+static void IRAM_ATTR integral_carry_rows(IntegralParams* p) {
+    IntegralImage* ii = p->ii;
+    uint32_t stride = ii->width + 1;
+    const uint32_t* carry = ii->data + (uint32_t)(ii->height / 2) * stride;
+    for (uint16_t y = p->y_start; y < p->y_end; y++) {
+        uint32_t* row = ii->data + (uint32_t)(y + 1) * stride;
+        for (uint16_t x = 1; x <= ii->width; x++) {
+            row[x] += carry[x];
+        }
+    }
+}
+
+static void IRAM_ATTR integral_run_phase(IntegralParams* p) {
+    if (p->phase == 1) integral_local_rows(p);
+    else integral_carry_rows(p);
+}
+
+// 另一個核心做 remote, 本核心做 local; 建立任務失敗時依序執行
+static void integral_run_pair(IntegralParams* local, IntegralParams* remote) {
+    TaskHandle_t task_handle = nullptr;
+    IntegralParams* params = new IntegralParams(*remote);
+
+    auto task_func = [](void* p) {
+        IntegralParams* args = (IntegralParams*)p;
+        integral_run_phase(args);
+        delete args;
+        vTaskDelete(NULL);
+    };
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        task_func,
+        "integral_task",
+        4096,
+        params,
+        1,
+        &task_handle,
+        !xPortGetCoreID()
+    );
+
+    if (result != pdPASS) {
+        Serial.println("Failed to create task! Falling back to single core.");
+        integral_run_phase(params);
+        delete params;
+        integral_run_phase(local);
+        return;
+    }
+
+    integral_run_phase(local);
+
+    if (task_handle != nullptr) {
+        while (eTaskGetState(task_handle) != eDeleted) {
+            delay(1);
+        }
+    }
+}
+
+// 建立整幀的積分影像 (byte_swapped: 緩衝區是感測器的大端序)
+bool integral_image_build(IntegralImage* ii, const uint16_t* buffer, uint16_t width, uint16_t height, bool byte_swapped) {
+    if (buffer == nullptr || width == 0 || height == 0) return false;
+    if (!integral_image_alloc(ii, width, height)) return false;
+
+    uint16_t mid = height / 2;
+    IntegralParams top = { ii, buffer, 0, mid, byte_swapped, 1 };
+    IntegralParams bottom = { ii, buffer, mid, height, byte_swapped, 1 };
+    if (mid == 0) {
+        integral_local_rows(&bottom);
+        return true;
+    }
+    integral_run_pair(&top, &bottom);
+
+    // 下半部 (mid+1 .. height 的積分行) 加上第 mid 行
+    uint16_t quarter = mid + (height - mid) / 2;
+    IntegralParams carry_a = { ii, buffer, mid, quarter, byte_swapped, 2 };
+    IntegralParams carry_b = { ii, buffer, quarter, height, byte_swapped, 2 };
+    integral_run_pair(&carry_a, &carry_b);
+    return true;
+}
+
+// 矩形 [x, x+w) x [y, y+h) 的亮度總和, 呼叫端負責範圍
+__attribute__((always_inline)) inline uint32_t integral_image_sum(const IntegralImage* ii, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    uint32_t stride = ii->width + 1;
+    const uint32_t* top = ii->data + (uint32_t)y * stride;
+    const uint32_t* bottom = ii->data + (uint32_t)(y + h) * stride;
+    return bottom[x + w] - bottom[x] - top[x + w] + top[x];
+}
+
+__attribute__((always_inline)) inline uint8_t integral_image_mean(const IntegralImage* ii, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    uint32_t area = (uint32_t)w * h;
+    return area ? (integral_image_sum(ii, x, y, w, h) + area / 2) / area : 0;
+}
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef __ISP_OFFLOAD_H
+#define __ISP_OFFLOAD_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "img_computing.h"
+
+// ==================== 感測器 ISP 濾鏡分流 ====================
+// 依感測器 PID 決定哪些調整交給感測器硬體, 剩下的才由軟體逐像素處理:
+//   飽和度    : 三款感測器都有 set_saturation (-2..2), 餘量交給軟體
+//   特效      : 三款感測器都有 set_special_effect (0..6)
+//   AWB 增益  : OV3660 / OV5640 的 0x3400-0x3405 手動增益暫存器
+//   全域色調  : 只有 OV5640 的 SDE 有色調旋轉 (0x5580-0x5588)
+// 針對特定色調的 ColorAdjustment 感測器做不到, 一律留在軟體。
+// 全域色調交給感測器時, 軟體收到的像素已經旋轉過, 針對性調整 (與色塊追蹤) 的目標色調要跟著偏移。
+
+#define ISP_MAX_SW_ADJUSTMENTS  8
+#define ISP_SAT_PER_LEVEL       32    // 一級 set_saturation 約等於 HSV 飽和度 ±32
+#define ISP_SAT_RESIDUAL_MIN    8     // 餘量小於此值就忽略
+#define ISP_HUE_FULL_RANGE      128   // range=128 的 ColorAdjustment 涵蓋所有色調
+
+// OV3660 / OV5640 暫存器
+#define OV_REG_AWB_R_GAIN_H     0x3400
+#define OV_REG_AWB_R_GAIN_L     0x3401
+#define OV_REG_AWB_G_GAIN_H     0x3402
+#define OV_REG_AWB_G_GAIN_L     0x3403
+#define OV_REG_AWB_B_GAIN_H     0x3404
+#define OV_REG_AWB_B_GAIN_L     0x3405
+#define OV_REG_AWB_MANUAL       0x3406
+#define OV5640_REG_SDE_CTRL0    0x5580
+#define OV5640_REG_SDE_HUE_COS  0x5581
+#define OV5640_REG_SDE_HUE_SIN  0x5582
+#define OV5640_REG_SDE_SIGN     0x5588
+
+// 使用者要求的濾鏡 (與感測器無關)
+struct FilterRequest {
+    int16_t saturation;           // 全域飽和度偏移 (與 sat_shift 同單位)
+    int16_t hue_shift;            // 全域色調偏移 (0-255 為一圈)
+    uint8_t special_effect;       // 0=無 1=負片 2=灰階 3=紅 4=綠 5=藍 6=復古
+    ColorAdjustment* adjustments; // 針對特定色調的調整
+    uint8_t num_adjustments;
+};
+
+// 分流結果
+struct FilterPlan {
+    uint16_t sensor_pid;
+    int8_t hw_saturation;         // 已寫入感測器的飽和度等級
+    bool hw_hue;                  // 全域色調由感測器處理
+    int16_t hw_hue_shift;         // 感測器已旋轉的色調; 軟體看到的色調都已偏移這麼多
+    bool hw_effect;               // 特效由感測器處理
+    bool hw_awb;                  // AWB 增益可寫入感測器
+    ColorAdjustment sw_adjustments[ISP_MAX_SW_ADJUSTMENTS];
+    uint8_t sw_count;             // 軟體仍需處理的調整數 (0 = 不需要 HSV 處理)
+};
+
+__attribute__((always_inline)) inline int8_t isp_clamp_int8(int32_t v) {
+    return (int8_t)constrain(v, -128, 127);
+}
+
+// 色調偏移折回 -128..127
+__attribute__((always_inline)) inline int8_t isp_wrap_hue(int32_t v) {
+    return (int8_t)(((v % 256) + 256 + 128) % 256 - 128);
+}
+
+// OV5640 SDE 色調旋轉; YCbCr 平面旋轉, 與 HSV 色調偏移近似
+static void ov5640_set_hue(sensor_t* s, int16_t hue_shift) {
+    if (hue_shift == 0) {
+        s->set_reg(s, OV5640_REG_SDE_CTRL0, 0x01, 0x00);
+        return;
+    }
+    float rad = hue_shift * (2.0f * PI / 256.0f);
+    int32_t deg = (int32_t)hue_shift * 360 / 256;
+    uint8_t cos_q7 = min(128, (int)lroundf(fabsf(cosf(rad)) * 128.0f));
+    uint8_t sin_q7 = min(128, (int)lroundf(fabsf(sinf(rad)) * 128.0f));
+    // 0x5588 符號位元 (依 OV5640 應用手冊的色調表)
+    uint8_t sign;
+    if (deg >= 0 && deg < 90)         sign = 0x01;
+    else if (deg >= 90)               sign = 0x31;
+    else if (deg >= -90)              sign = 0x02;
+    else                              sign = 0x32;
+
+    s->set_reg(s, OV5640_REG_SDE_CTRL0, 0x01, 0x01);
+    s->set_reg(s, OV5640_REG_SDE_HUE_COS, 0xFF, cos_q7);
+    s->set_reg(s, OV5640_REG_SDE_HUE_SIN, 0xFF, sin_q7);
+    s->set_reg(s, OV5640_REG_SDE_SIGN, 0xFF, sign);
+}
+
+// 寫入 AWB 手動增益 (Q8 → 感測器的 12-bit Q10)
+void isp_apply_awb_gains(sensor_t* s, uint16_t gain_r, uint16_t gain_g, uint16_t gain_b) {
+    uint16_t r = min(0x0FFF, gain_r << 2);
+    uint16_t g = min(0x0FFF, gain_g << 2);
+    uint16_t b = min(0x0FFF, gain_b << 2);
+    s->set_reg(s, OV_REG_AWB_MANUAL, 0x01, 0x01);
+    s->set_reg(s, OV_REG_AWB_R_GAIN_H, 0x0F, r >> 8);
+    s->set_reg(s, OV_REG_AWB_R_GAIN_L, 0xFF, r & 0xFF);
+    s->set_reg(s, OV_REG_AWB_G_GAIN_H, 0x0F, g >> 8);
+    s->set_reg(s, OV_REG_AWB_G_GAIN_L, 0xFF, g & 0xFF);
+    s->set_reg(s, OV_REG_AWB_B_GAIN_H, 0x0F, b >> 8);
+    s->set_reg(s, OV_REG_AWB_B_GAIN_L, 0xFF, b & 0xFF);
+}
+
+// 規劃並寫入感測器; 之後軟體只處理 plan->sw_adjustments
+void isp_plan_filters(sensor_t* s, const FilterRequest* req, FilterPlan* plan) {
+    memset(plan, 0, sizeof(FilterPlan));
+    plan->sensor_pid = s ? s->id.PID : 0;
+
+    bool known = plan->sensor_pid == OV2640_PID || plan->sensor_pid == OV3660_PID || plan->sensor_pid == OV5640_PID;
+    plan->hw_effect = known;
+    plan->hw_hue = plan->sensor_pid == OV5640_PID;
+    plan->hw_awb = plan->sensor_pid == OV3660_PID || plan->sensor_pid == OV5640_PID;
+
+    // ---------- 飽和度 ----------
+    int16_t sat_residual = req->saturation;
+    if (known) {
+        int level = constrain((req->saturation + (req->saturation >= 0 ? ISP_SAT_PER_LEVEL / 2 : -ISP_SAT_PER_LEVEL / 2)) / ISP_SAT_PER_LEVEL, -2, 2);
+        s->set_saturation(s, level);
+        plan->hw_saturation = level;
+        sat_residual = req->saturation - level * ISP_SAT_PER_LEVEL;
+    }
+    if (abs(sat_residual) < ISP_SAT_RESIDUAL_MIN) sat_residual = 0;
+
+    // ---------- 特效 ----------
+    if (plan->hw_effect) {
+        s->set_special_effect(s, req->special_effect);
+    } else if (req->special_effect != 0) {
+        Serial.println("ISP: special effect not supported by this sensor");
+    }
+
+    // ---------- 全域色調 ----------
+    int16_t hue_residual = req->hue_shift;
+    if (plan->hw_hue) {
+        ov5640_set_hue(s, req->hue_shift);
+        plan->hw_hue_shift = req->hue_shift;
+        hue_residual = 0;
+    }
+
+    // ---------- 軟體餘量 ----------
+    // 針對性調整比對原始色調 (感測器旋轉過的要跟著移), 全域餘量疊加進去; 最後補一條涵蓋全色調的調整
+    uint8_t n = min<uint8_t>(req->num_adjustments, ISP_MAX_SW_ADJUSTMENTS - 1);
+    for (uint8_t i = 0; i < n; i++) {
+        ColorAdjustment adj = req->adjustments[i];
+        adj.target_hue = (uint8_t)(adj.target_hue + plan->hw_hue_shift);
+        adj.hue_shift = isp_wrap_hue(adj.hue_shift + hue_residual);
+        adj.sat_shift = isp_clamp_int8(adj.sat_shift + sat_residual);
+        plan->sw_adjustments[plan->sw_count++] = adj;
+    }
+    if (hue_residual != 0 || sat_residual != 0) {
+        ColorAdjustment global = { 0, isp_wrap_hue(hue_residual), ISP_HUE_FULL_RANGE, isp_clamp_int8(sat_residual) };
+        plan->sw_adjustments[plan->sw_count++] = global;
+    }
+
+    Serial.printf("ISP plan: PID 0x%x, hw sat %d, hw hue %d, hw effect %d, hw awb %d, sw adjustments %u\n",
+                  plan->sensor_pid, plan->hw_saturation, plan->hw_hue, plan->hw_effect, plan->hw_awb, plan->sw_count);
+}
+
+#endif
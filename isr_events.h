@@ -0,0 +1,87 @@
+#ifndef __ISR_EVENTS_H
+#define __ISR_EVENTS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_timer.h"
+#include "esp_attr.h"
+
+// ==================== 中斷事件類型 ====================
+
+enum IsrEventType : uint8_t {
+    EVT_CAPTURE = 0,     // 拍照按鈕
+    EVT_MODE_NORMAL,     // 切換到預覽模式
+    EVT_MODE_FILTER,     // 切換到濾鏡模式
+    EVT_DIR_A,           // 方向鍵 A
+    EVT_DIR_B,           // 方向鍵 B
+    EVT_COUNT
+};
+
+// 事件內容: 類型 + 觸發時間 (esp_timer 微秒)
+struct IsrEvent {
+    int64_t timestamp_us;
+    uint8_t type;
+};
+
+// ==================== 單生產者/單消費者無鎖環形佇列 ====================
+// 生產者: GPIO 中斷 (所有 GPIO ISR 都由同一核心的 GPIO 中斷分派, 不會互相搶佔)
+// 消費者: loop()
+// N 必須是 2 的次方
+
+template <size_t N>
+class IsrEventQueue {
+    static_assert((N & (N - 1)) == 0, "IsrEventQueue size must be a power of two");
+
+public:
+    // 只能從 ISR (生產者) 呼叫
+    __attribute__((always_inline)) inline bool IRAM_ATTR push(uint8_t type, int64_t timestamp_us) {
+        uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+        uint32_t t = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+        if (h - t >= N) {
+            __atomic_store_n(&dropped, dropped + 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        slots[h & (N - 1)].timestamp_us = timestamp_us;
+        slots[h & (N - 1)].type = type;
+        __atomic_store_n(&head, h + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // 只能從 loop() (消費者) 呼叫
+    bool pop(IsrEvent &out) {
+        uint32_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+        uint32_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        if (t == h) return false;
+        out = slots[t & (N - 1)];
+        __atomic_store_n(&tail, t + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // 佇列滿時被丟棄的事件數
+    uint32_t droppedCount() const {
+        return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    }
+
+private:
+    IsrEvent slots[N];
+    uint32_t head = 0;     // 只由生產者寫入
+    uint32_t tail = 0;     // 只由消費者寫入
+    uint32_t dropped = 0;  // 只由生產者寫入
+};
+
+// ==================== 硬體計時器防彈跳 ====================
+// 使用 esp_timer (64 位元硬體系統計時器, 微秒) 取代 millis() 運算:
+// ISR 內可安全讀取, 不會溢位, 解析度足以量測觸發延遲。
+// 只有被接受的邊緣會記錄時間: 之後 window_us 內的彈跳全部忽略, 持續彈跳也不會延長鎖定。
+
+struct IsrDebounce {
+    int64_t last_edge_us;   // 最近一次被接受的邊緣
+};
+
+__attribute__((always_inline)) inline bool IRAM_ATTR isr_debounce_accept(IsrDebounce &d, int64_t now_us, int64_t window_us) {
+    if ((now_us - d.last_edge_us) <= window_us) return false;
+    d.last_edge_us = now_us;
+    return true;
+}
+
+#endif
@@ -0,0 +1,632 @@
+#ifndef __JPEG_ENCODER_H
+#define __JPEG_ENCODER_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "img_computing.h"
+
+// ==================== 基線 JPEG 編碼器 (RGB565 → JFIF) ====================
+// 處理完的影像直接編成 JPEG (含軟體顏色調整), 取代 BMP 存檔與 fmt2jpg:
+//   - 色彩轉換 JFIF 定點 (Q8); 色度 4:2:0 (MCU 16x16) 或 4:2:2 (MCU 16x8), 先平均 RGB 再轉 Cb/Cr
+//   - AAN 前向 DCT 8 位元定點 (與 libjpeg jfdctfst 相同), AAN 比例併進量化除數,
+//     量化以 16 位元倒數相乘取代除法
+//   - 標準 Huffman 表 (ITU T.81 附錄 K), 碼表在第一次使用時建好
+//   - 逐 MCU 列處理: 串流 API (jpeg_encoder_begin / write_lines / end) 一次只存一個 MCU 列的
+//     RGB565 (16 行), 輸出分段交給 sink (例如 SD 卡檔案), 不需要整張 JPEG 的緩衝
+//   - 整張影像的 API (jpeg_encode_rgb565) 每個 MCU 列後放一個重新同步標記 (RSTn),
+//     各列的 DC 預測互相獨立, 上下兩半可以在兩個核心各自編碼再接起來
+// 輸出是標準的 baseline JPEG, 任何解碼器都能讀 (主機以 libjpeg 驗證: host/bench_jpeg.cpp)。
+
+#define JPEG_QUALITY_DEFAULT   80
+#define JPEG_SINK_CHUNK        4096     // 串流 API 每次交給 sink 的位元組數
+
+enum JpegSubsampling : uint8_t {
+    JPEG_SUBSAMPLE_420 = 0,             // Cb/Cr 長寬各半
+    JPEG_SUBSAMPLE_422                  // Cb/Cr 寬度減半
+};
+
+// 回傳 false 表示寫入失敗 (編碼中止)
+typedef bool (*JpegSink)(void* context, const uint8_t* data, size_t len);
+
+// ---------- 常數表 ----------
+
+// 之字形第 k 個係數在 8x8 區塊中的位置
+static const uint8_t jpeg_natural_order[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// 附錄 K 的量化表 (自然順序), 品質 50
+static const uint8_t jpeg_std_luma_quant[64] = {
+    16, 11, 10, 16,  24,  40,  51,  61,
+    12, 12, 14, 19,  26,  58,  60,  55,
+    14, 13, 16, 24,  40,  57,  69,  56,
+    14, 17, 22, 29,  51,  87,  80,  62,
+    18, 22, 37, 56,  68, 109, 103,  77,
+    24, 35, 55, 64,  81, 104, 113,  92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103,  99
+};
+
+static const uint8_t jpeg_std_chroma_quant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// AAN DCT 的輸出比例 (Q14): cos(k*pi/16) * sqrt(2), k = 0 時為 1
+static const uint16_t jpeg_aan_scales[64] = {
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    22725, 31521, 29692, 26722, 22725, 17855, 12299,  6270,
+    21407, 29692, 27969, 25172, 21407, 16819, 11585,  5906,
+    19266, 26722, 25172, 22654, 19266, 15137, 10426,  5315,
+    16384, 22725, 21407, 19266, 16384, 12873,  8867,  4520,
+    12873, 17855, 16819, 15137, 12873, 10114,  6967,  3552,
+     8867, 12299, 11585, 10426,  8867,  6967,  4799,  2446,
+     4520,  6270,  5906,  5315,  4520,  3552,  2446,  1247
+};
+
+// 附錄 K 的 Huffman 表: 各長度的碼數 (1-16) 與符號
+static const uint8_t jpeg_dc_luma_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t jpeg_dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t jpeg_dc_values[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t jpeg_ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const uint8_t jpeg_ac_luma_values[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static const uint8_t jpeg_ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t jpeg_ac_chroma_values[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+// 符號 → (碼, 長度)
+struct JpegHuffman {
+    uint16_t code[256];
+    uint8_t size[256];
+};
+
+// 0 亮度 DC, 1 色度 DC, 2 亮度 AC, 3 色度 AC
+static JpegHuffman jpeg_huffman[4];
+static bool jpeg_huffman_ready = false;
+
+static void jpeg_build_huffman(JpegHuffman* h, const uint8_t* bits, const uint8_t* values) {
+    memset(h, 0, sizeof(JpegHuffman));
+    uint16_t code = 0;
+    uint8_t k = 0;
+    for (uint8_t len = 1; len <= 16; len++) {
+        for (uint8_t i = 0; i < bits[len - 1]; i++, k++) {
+            h->code[values[k]] = code++;
+            h->size[values[k]] = len;
+        }
+        code <<= 1;
+    }
+}
+
+// 在 loop() 中 (啟動第二核心之前) 呼叫
+static void jpeg_init_huffman() {
+    if (jpeg_huffman_ready) return;
+    jpeg_build_huffman(&jpeg_huffman[0], jpeg_dc_luma_bits, jpeg_dc_values);
+    jpeg_build_huffman(&jpeg_huffman[1], jpeg_dc_chroma_bits, jpeg_dc_values);
+    jpeg_build_huffman(&jpeg_huffman[2], jpeg_ac_luma_bits, jpeg_ac_luma_values);
+    jpeg_build_huffman(&jpeg_huffman[3], jpeg_ac_chroma_bits, jpeg_ac_chroma_values);
+    jpeg_huffman_ready = true;
+}
+
+// ---------- 位元輸出 ----------
+
+struct JpegWriter {
+    uint8_t* buf;
+    size_t len;
+    size_t cap;
+    uint32_t acc;                // 尚未輸出的位元 (低 bits 位有效)
+    uint8_t bits;
+    JpegSink sink;               // nullptr: buf 依需要 realloc 變大
+    void* context;
+    bool failed;
+};
+
+static bool jpeg_writer_init(JpegWriter* w, size_t cap, JpegSink sink, void* context) {
+    memset(w, 0, sizeof(JpegWriter));
+    w->buf = (uint8_t*)malloc(cap);
+    w->cap = w->buf ? cap : 0;
+    w->sink = sink;
+    w->context = context;
+    w->failed = w->buf == nullptr;
+    return !w->failed;
+}
+
+// 緩衝已滿: 交給 sink 或加倍; 失敗後丟掉之後的輸出
+static bool jpeg_writer_make_room(JpegWriter* w) {
+    if (w->failed) return false;
+    if (w->sink) {
+        w->failed = !w->sink(w->context, w->buf, w->len);
+        w->len = 0;
+        return !w->failed;
+    }
+    uint8_t* grown = (uint8_t*)realloc(w->buf, w->cap * 2);
+    if (grown == nullptr) {
+        w->failed = true;
+        return false;
+    }
+    w->buf = grown;
+    w->cap *= 2;
+    return true;
+}
+
+__attribute__((always_inline)) inline void jpeg_put_byte(JpegWriter* w, uint8_t b) {
+    if (w->len == w->cap && !jpeg_writer_make_room(w)) return;
+    w->buf[w->len++] = b;
+}
+
+static void jpeg_put_bytes(JpegWriter* w, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) jpeg_put_byte(w, data[i]);
+}
+
+// 熵編碼資料: 0xFF 之後補 0x00
+__attribute__((always_inline)) inline void jpeg_put_bits(JpegWriter* w, uint32_t code, uint8_t size) {
+    w->acc = (w->acc << size) | (code & ((1u << size) - 1));
+    w->bits += size;
+    while (w->bits >= 8) {
+        w->bits -= 8;
+        uint8_t b = (uint8_t)(w->acc >> w->bits);
+        jpeg_put_byte(w, b);
+        if (b == 0xFF) jpeg_put_byte(w, 0x00);
+    }
+}
+
+// 補 1 到位元組邊界
+static void jpeg_flush_bits(JpegWriter* w) {
+    if (w->bits) jpeg_put_bits(w, 0x7F, 8 - w->bits);
+    w->acc = 0;
+    w->bits = 0;
+}
+
+static void jpeg_put_marker(JpegWriter* w, uint8_t marker, uint16_t length) {
+    jpeg_put_byte(w, 0xFF);
+    jpeg_put_byte(w, marker);
+    if (length) {
+        jpeg_put_byte(w, length >> 8);
+        jpeg_put_byte(w, length & 0xFF);
+    }
+}
+
+// ---------- 編碼器 ----------
+
+struct JpegEncoder {
+    uint16_t width;
+    uint16_t height;
+    uint8_t subsampling;
+    bool byte_swapped;           // 輸入為感測器位元組順序 (高位元組在前)
+    bool restart_rows;           // 每個 MCU 列後放 RSTn
+    uint8_t mcu_height;          // 16 (4:2:0) 或 8 (4:2:2)
+    uint16_t mcus_per_row;
+    uint16_t mcu_rows;
+    uint8_t quant[2][64];        // 之字形順序, 寫進 DQT
+    uint16_t half[2][64];        // 量化除數 / 2 (自然順序, 含 AAN 比例)
+    uint16_t recip[2][64];       // 65536 / 除數 (無條件進位)
+
+    // 串流 API
+    JpegWriter out;
+    uint16_t* strip;             // 一個 MCU 列的 RGB565
+    uint16_t strip_lines;
+    uint16_t lines_done;         // 已收到的行數
+    uint16_t next_row;           // 下一個要編碼的 MCU 列
+    int16_t dc[3];
+};
+
+// 一段連續 MCU 列的熵編碼狀態 (兩核心各一個)
+struct JpegScan {
+    JpegWriter* out;
+    int16_t dc[3];
+};
+
+static void jpeg_set_quality(JpegEncoder* enc, uint8_t quality) {
+    quality = constrain(quality, 1, 100);
+    uint32_t scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+    for (uint8_t t = 0; t < 2; t++) {
+        const uint8_t* base = t ? jpeg_std_chroma_quant : jpeg_std_luma_quant;
+        for (uint8_t k = 0; k < 64; k++) {
+            uint8_t n = jpeg_natural_order[k];
+            uint32_t q = constrain((base[n] * scale + 50) / 100, 1u, 255u);
+            enc->quant[t][k] = q;
+            // DCT 輸出放大 8 倍並帶 AAN 比例: 除數 = q * aan / 2^(14 - 3)
+            uint32_t div = max<uint32_t>((q * jpeg_aan_scales[n] + (1 << 10)) >> 11, 1);
+            enc->half[t][n] = div >> 1;
+            enc->recip[t][n] = (uint16_t)min<uint32_t>((65536 + div - 1) / div, 65535);
+        }
+    }
+}
+
+static void jpeg_setup(JpegEncoder* enc, uint16_t width, uint16_t height, uint8_t quality, JpegSubsampling subsampling,
+                       bool byte_swapped, bool restart_rows) {
+    jpeg_init_huffman();
+    enc->width = width;
+    enc->height = height;
+    enc->subsampling = subsampling;
+    enc->byte_swapped = byte_swapped;
+    enc->restart_rows = restart_rows;
+    enc->mcu_height = subsampling == JPEG_SUBSAMPLE_420 ? 16 : 8;
+    enc->mcus_per_row = (width + 15) / 16;
+    enc->mcu_rows = (height + enc->mcu_height - 1) / enc->mcu_height;
+    jpeg_set_quality(enc, quality);
+}
+
+static void jpeg_write_headers(const JpegEncoder* enc, JpegWriter* w) {
+    jpeg_put_marker(w, 0xD8, 0);                              // SOI
+    static const uint8_t jfif[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    jpeg_put_marker(w, 0xE0, 16);                             // APP0
+    jpeg_put_bytes(w, jfif, sizeof(jfif));
+    jpeg_put_marker(w, 0xDB, 2 + 2 * 65);                     // DQT
+    for (uint8_t t = 0; t < 2; t++) {
+        jpeg_put_byte(w, t);
+        jpeg_put_bytes(w, enc->quant[t], 64);
+    }
+    jpeg_put_marker(w, 0xC0, 17);                             // SOF0
+    jpeg_put_byte(w, 8);
+    jpeg_put_byte(w, enc->height >> 8);
+    jpeg_put_byte(w, enc->height & 0xFF);
+    jpeg_put_byte(w, enc->width >> 8);
+    jpeg_put_byte(w, enc->width & 0xFF);
+    jpeg_put_byte(w, 3);
+    const uint8_t comps[9] = { 1, (uint8_t)(enc->subsampling == JPEG_SUBSAMPLE_420 ? 0x22 : 0x21), 0, 2, 0x11, 1, 3, 0x11, 1 };
+    jpeg_put_bytes(w, comps, sizeof(comps));
+    const uint8_t* bits[4] = { jpeg_dc_luma_bits, jpeg_dc_chroma_bits, jpeg_ac_luma_bits, jpeg_ac_chroma_bits };
+    const uint8_t* values[4] = { jpeg_dc_values, jpeg_dc_values, jpeg_ac_luma_values, jpeg_ac_chroma_values };
+    static const uint8_t classes[4] = { 0x00, 0x01, 0x10, 0x11 };
+    for (uint8_t t = 0; t < 4; t++) {                         // DHT
+        uint16_t count = 0;
+        for (uint8_t i = 0; i < 16; i++) count += bits[t][i];
+        jpeg_put_marker(w, 0xC4, 2 + 1 + 16 + count);
+        jpeg_put_byte(w, classes[t]);
+        jpeg_put_bytes(w, bits[t], 16);
+        jpeg_put_bytes(w, values[t], count);
+    }
+    if (enc->restart_rows) {                                  // DRI
+        jpeg_put_marker(w, 0xDD, 4);
+        jpeg_put_byte(w, enc->mcus_per_row >> 8);
+        jpeg_put_byte(w, enc->mcus_per_row & 0xFF);
+    }
+    jpeg_put_marker(w, 0xDA, 12);                             // SOS
+    static const uint8_t sos[10] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+    jpeg_put_bytes(w, sos, sizeof(sos));
+}
+
+// ---------- DCT、量化、熵編碼 ----------
+
+#define JPEG_FIX_0_382683433   98
+#define JPEG_FIX_0_541196100   139
+#define JPEG_FIX_0_707106781   181
+#define JPEG_FIX_1_306562965   334
+#define JPEG_MULTIPLY(v, c)    (((v) * (c)) >> 8)
+
+// 一維 AAN: 8 個樣本 (間隔 stride), 原地輸出
+__attribute__((always_inline)) inline void IRAM_ATTR jpeg_fdct_1d(int32_t* d, uint8_t stride) {
+    int32_t tmp0 = d[0] + d[7 * stride], tmp7 = d[0] - d[7 * stride];
+    int32_t tmp1 = d[stride] + d[6 * stride], tmp6 = d[stride] - d[6 * stride];
+    int32_t tmp2 = d[2 * stride] + d[5 * stride], tmp5 = d[2 * stride] - d[5 * stride];
+    int32_t tmp3 = d[3 * stride] + d[4 * stride], tmp4 = d[3 * stride] - d[4 * stride];
+
+    int32_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+    int32_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[4 * stride] = tmp10 - tmp11;
+    int32_t z1 = JPEG_MULTIPLY(tmp12 + tmp13, JPEG_FIX_0_707106781);
+    d[2 * stride] = tmp13 + z1;
+    d[6 * stride] = tmp13 - z1;
+
+    tmp10 = tmp4 + tmp5;
+    tmp11 = tmp5 + tmp6;
+    tmp12 = tmp6 + tmp7;
+    int32_t z5 = JPEG_MULTIPLY(tmp10 - tmp12, JPEG_FIX_0_382683433);
+    int32_t z2 = JPEG_MULTIPLY(tmp10, JPEG_FIX_0_541196100) + z5;
+    int32_t z4 = JPEG_MULTIPLY(tmp12, JPEG_FIX_1_306562965) + z5;
+    int32_t z3 = JPEG_MULTIPLY(tmp11, JPEG_FIX_0_707106781);
+    int32_t z11 = tmp7 + z3, z13 = tmp7 - z3;
+    d[5 * stride] = z13 + z2;
+    d[3 * stride] = z13 - z2;
+    d[stride] = z11 + z4;
+    d[7 * stride] = z11 - z4;
+}
+
+__attribute__((always_inline)) inline uint8_t jpeg_bit_count(uint32_t v) {
+    return v ? 32 - __builtin_clz(v) : 0;
+}
+
+// block: 已減 128 的樣本 (自然順序); DCT → 量化 → Huffman
+static void IRAM_ATTR jpeg_encode_block(const JpegEncoder* enc, JpegWriter* w, int32_t* block, uint8_t table, int16_t* dc_pred) {
+    for (uint8_t r = 0; r < 8; r++) jpeg_fdct_1d(block + 8 * r, 1);
+    for (uint8_t c = 0; c < 8; c++) jpeg_fdct_1d(block + c, 8);
+
+    const uint16_t* half = enc->half[table];
+    const uint16_t* recip = enc->recip[table];
+    int16_t coef[64];
+    for (uint8_t k = 0; k < 64; k++) {
+        uint8_t n = jpeg_natural_order[k];
+        int32_t v = block[n];
+        if (v < 0) coef[k] = -(int16_t)(((uint32_t)(-v + half[n]) * recip[n]) >> 16);
+        else coef[k] = (int16_t)(((uint32_t)(v + half[n]) * recip[n]) >> 16);
+    }
+
+    const JpegHuffman* dc = &jpeg_huffman[table];
+    const JpegHuffman* ac = &jpeg_huffman[2 + table];
+    int32_t diff = coef[0] - *dc_pred;
+    *dc_pred = coef[0];
+    uint32_t mag = diff < 0 ? -diff : diff;
+    uint8_t nbits = jpeg_bit_count(mag);
+    jpeg_put_bits(w, dc->code[nbits], dc->size[nbits]);
+    if (nbits) jpeg_put_bits(w, diff < 0 ? diff - 1 : diff, nbits);
+
+    uint8_t run = 0;
+    for (uint8_t k = 1; k < 64; k++) {
+        int32_t v = coef[k];
+        if (v == 0) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            jpeg_put_bits(w, ac->code[0xF0], ac->size[0xF0]);   // ZRL
+            run -= 16;
+        }
+        mag = v < 0 ? -v : v;
+        nbits = jpeg_bit_count(mag);
+        uint8_t symbol = (run << 4) | nbits;
+        jpeg_put_bits(w, ac->code[symbol], ac->size[symbol]);
+        jpeg_put_bits(w, v < 0 ? v - 1 : v, nbits);
+        run = 0;
+    }
+    if (run) jpeg_put_bits(w, ac->code[0x00], ac->size[0x00]);   // EOB
+}
+
+// ---------- MCU 列 ----------
+
+// 一個 MCU 列: rows 指向第一行, lines 為有效行數 (不足 mcu_height 時重複最後一行),
+// 寬度不是 16 的倍數時重複最後一欄
+static void IRAM_ATTR jpeg_encode_mcu_row(const JpegEncoder* enc, JpegScan* scan, const uint16_t* rows, uint16_t stride, uint16_t lines) {
+    const uint8_t mh = enc->mcu_height;
+    const uint8_t y_blocks = mh / 8 * 2;
+    const uint8_t cy_shift = enc->subsampling == JPEG_SUBSAMPLE_420 ? 1 : 0;
+    int32_t y_block[4][64];
+    int32_t cb_block[64], cr_block[64];
+    int32_t sum_r[64], sum_g[64], sum_b[64];
+
+    for (uint16_t mx = 0; mx < enc->mcus_per_row; mx++) {
+        memset(sum_r, 0, sizeof(sum_r));
+        memset(sum_g, 0, sizeof(sum_g));
+        memset(sum_b, 0, sizeof(sum_b));
+        for (uint8_t y = 0; y < mh; y++) {
+            const uint16_t* line = rows + (size_t)min<uint16_t>(y, lines - 1) * stride;
+            int32_t* yb = y_block[(y >> 3) * 2] + (y & 7) * 8;
+            uint8_t crow = (y >> cy_shift) * 8;
+            for (uint8_t x = 0; x < 16; x++) {
+                uint16_t px = line[min<uint32_t>(mx * 16 + x, enc->width - 1)];
+                if (enc->byte_swapped) px = (px >> 8) | (px << 8);
+                int32_t r = five_to_eight[px >> 11];
+                int32_t g = six_to_eight[(px >> 5) & 0x3F];
+                int32_t b = five_to_eight[px & 0x1F];
+                // 左 8 欄與右 8 欄各屬一個亮度區塊
+                yb[(x >> 3) * 64 + (x & 7)] = ((77 * r + 150 * g + 29 * b + 128) >> 8) - 128;
+                uint8_t c = crow + (x >> 1);
+                sum_r[c] += r;
+                sum_g[c] += g;
+                sum_b[c] += b;
+            }
+        }
+        // 每個色度樣本是 2 (4:2:2) 或 4 (4:2:0) 個像素的平均
+        const uint8_t shift = 1 + cy_shift;
+        for (uint8_t i = 0; i < 64; i++) {
+            int32_t r = sum_r[i], g = sum_g[i], b = sum_b[i];
+            cb_block[i] = (-43 * r - 85 * g + 128 * b + (128 << shift)) >> (8 + shift);
+            cr_block[i] = (128 * r - 107 * g - 21 * b + (128 << shift)) >> (8 + shift);
+        }
+        for (uint8_t i = 0; i < y_blocks; i++) jpeg_encode_block(enc, scan->out, y_block[i], 0, &scan->dc[0]);
+        jpeg_encode_block(enc, scan->out, cb_block, 1, &scan->dc[1]);
+        jpeg_encode_block(enc, scan->out, cr_block, 1, &scan->dc[2]);
+    }
+}
+
+// 整段 MCU 列 [first, end); 每列後 (最後一列除外) 放 RSTn 並重設 DC 預測
+static void jpeg_encode_rows(const JpegEncoder* enc, JpegScan* scan, const uint16_t* frame, uint16_t first, uint16_t end) {
+    for (uint16_t row = first; row < end; row++) {
+        uint32_t y0 = (uint32_t)row * enc->mcu_height;
+        jpeg_encode_mcu_row(enc, scan, frame + y0 * enc->width, enc->width, min<uint32_t>(enc->mcu_height, enc->height - y0));
+        if (enc->restart_rows && row + 1 < enc->mcu_rows) {
+            jpeg_flush_bits(scan->out);
+            jpeg_put_marker(scan->out, 0xD0 + (row & 7), 0);
+            memset(scan->dc, 0, sizeof(scan->dc));
+        }
+    }
+}
+
+// ---------- 串流 API ----------
+// begin → write_lines (任意行數, 由上往下) → end; 輸出每 JPEG_SINK_CHUNK 位元組交給 sink 一次。
+// 只有一個 MCU 列的 RGB565 緩衝; 輸入剛好對齊 MCU 列時直接從輸入編碼, 不複製。
+
+bool jpeg_encoder_begin(JpegEncoder* enc, uint16_t width, uint16_t height, uint8_t quality, JpegSubsampling subsampling,
+                        bool byte_swapped, JpegSink sink, void* context) {
+    memset(enc, 0, sizeof(JpegEncoder));
+    if (width == 0 || height == 0 || sink == nullptr) return false;
+    jpeg_setup(enc, width, height, quality, subsampling, byte_swapped, false);
+    enc->strip = (uint16_t*)malloc((size_t)width * enc->mcu_height * 2);
+    if (enc->strip == nullptr || !jpeg_writer_init(&enc->out, JPEG_SINK_CHUNK, sink, context)) {
+        free(enc->strip);
+        free(enc->out.buf);
+        enc->strip = nullptr;
+        enc->out.buf = nullptr;
+        return false;
+    }
+    jpeg_write_headers(enc, &enc->out);
+    return true;
+}
+
+static void jpeg_encoder_row(JpegEncoder* enc, const uint16_t* rows, uint16_t lines) {
+    JpegScan scan = { &enc->out, { enc->dc[0], enc->dc[1], enc->dc[2] } };
+    jpeg_encode_mcu_row(enc, &scan, rows, enc->width, lines);
+    memcpy(enc->dc, scan.dc, sizeof(enc->dc));
+    enc->next_row++;
+}
+
+bool jpeg_encoder_write_lines(JpegEncoder* enc, const uint16_t* lines, uint16_t count) {
+    if (enc->strip == nullptr) return false;
+    count = min<uint16_t>(count, enc->height - enc->lines_done);
+    while (count > 0 && !enc->out.failed) {
+        uint16_t need = min<uint16_t>(enc->mcu_height, enc->height - (uint32_t)enc->next_row * enc->mcu_height);
+        if (enc->strip_lines == 0 && count >= need) {
+            jpeg_encoder_row(enc, lines, need);
+        } else {
+            uint16_t take = min<uint16_t>(count, need - enc->strip_lines);
+            memcpy(enc->strip + (size_t)enc->strip_lines * enc->width, lines, (size_t)take * enc->width * 2);
+            enc->strip_lines += take;
+            if (enc->strip_lines == need) {
+                jpeg_encoder_row(enc, enc->strip, need);
+                enc->strip_lines = 0;
+            }
+            need = take;
+        }
+        lines += (size_t)need * enc->width;
+        count -= need;
+        enc->lines_done += need;
+    }
+    return !enc->out.failed;
+}
+
+// 收尾 (EOI) 並釋放緩衝; 回傳整張是否完整寫出
+bool jpeg_encoder_end(JpegEncoder* enc) {
+    bool complete = enc->strip && enc->lines_done == enc->height;
+    if (enc->strip) {
+        jpeg_flush_bits(&enc->out);
+        jpeg_put_marker(&enc->out, 0xD9, 0);
+        if (!enc->out.failed && enc->out.len) enc->out.failed = !enc->out.sink(enc->out.context, enc->out.buf, enc->out.len);
+    }
+    complete = complete && !enc->out.failed;
+    free(enc->strip);
+    free(enc->out.buf);
+    enc->strip = nullptr;
+    enc->out.buf = nullptr;
+    return complete;
+}
+
+// ---------- 整張影像 (兩核心) ----------
+
+struct JpegHalfParams {
+    const JpegEncoder* enc;
+    const uint16_t* frame;
+    uint16_t first_row;
+    uint16_t end_row;
+    JpegWriter out;
+    JpegScan scan;
+};
+
+// 整張 RGB565 影像編成 JPEG; *out 以 malloc 配置 (呼叫端 free), 與 fmt2jpg 相同。
+// 每個 MCU 列後有 RSTn, parallel 時下半部在另一個核心編碼, 輸出與單核心完全相同。
+bool jpeg_encode_rgb565(const uint16_t* frame, uint16_t width, uint16_t height, uint8_t quality, JpegSubsampling subsampling,
+                        bool byte_swapped, uint8_t** out, size_t* out_len, bool parallel = true) {
+    *out = nullptr;
+    *out_len = 0;
+    if (frame == nullptr || width == 0 || height == 0) return false;
+    JpegEncoder* enc = (JpegEncoder*)malloc(sizeof(JpegEncoder));
+    if (enc == nullptr) return false;
+    memset(enc, 0, sizeof(JpegEncoder));
+    jpeg_setup(enc, width, height, quality, subsampling, byte_swapped, true);
+    uint16_t split = parallel && enc->mcu_rows >= 2 ? enc->mcu_rows / 2 : enc->mcu_rows;
+    // 初始大小約 1.5 bits/像素, 不夠再加倍
+    size_t estimate = (size_t)width * height / 5 + 1024;
+
+    JpegWriter first;
+    if (!jpeg_writer_init(&first, estimate, nullptr, nullptr)) {
+        free(enc);
+        return false;
+    }
+    jpeg_write_headers(enc, &first);
+
+    TaskHandle_t task_handle = nullptr;
+    JpegHalfParams* params = nullptr;
+    if (split < enc->mcu_rows) {
+        // 為第二核心建立參數
+        params = new JpegHalfParams();
+        params->enc = enc;
+        params->frame = frame;
+        params->first_row = split;
+        params->end_row = enc->mcu_rows;
+        jpeg_writer_init(&params->out, estimate / 2, nullptr, nullptr);
+        params->scan.out = &params->out;
+
+        // 第二核心任務函數
+        auto task_func = [](void* p) {
+            JpegHalfParams* args = (JpegHalfParams*)p;
+            jpeg_encode_rows(args->enc, &args->scan, args->frame, args->first_row, args->end_row);
+            vTaskDelete(NULL);
+        };
+
+        bool started = !params->out.failed &&
+            xTaskCreatePinnedToCore(task_func, "jpeg_task", 6144, params, 1, &task_handle, !xPortGetCoreID()) == pdPASS;
+        if (!started) {
+            Serial.println("Failed to create task! Falling back to single core.");
+            free(params->out.buf);
+            delete params;
+            params = nullptr;
+            task_handle = nullptr;
+            split = enc->mcu_rows;
+        }
+    }
+
+    // 這個核心處理上半部 (或整張)
+    JpegScan scan = { &first, { 0, 0, 0 } };
+    jpeg_encode_rows(enc, &scan, frame, 0, split);
+
+    // 等待第二核心任務完成, 接上下半部
+    if (task_handle != nullptr) {
+        while (eTaskGetState(task_handle) != eDeleted) {
+            delay(1);
+        }
+    }
+    if (params) {
+        if (params->out.failed) first.failed = true;
+        else jpeg_put_bytes(&first, params->out.buf, params->out.len);
+        // 下半部的位元已寫進 params->out; 剩下不足一個位元組的部分接到 first
+        first.acc = params->out.acc;
+        first.bits = params->out.bits;
+        free(params->out.buf);
+        delete params;
+    }
+    jpeg_flush_bits(&first);
+    jpeg_put_marker(&first, 0xD9, 0);
+    free(enc);
+    if (first.failed) {
+        free(first.buf);
+        return false;
+    }
+    *out = first.buf;
+    *out_len = first.len;
+    return true;
+}
+
+#endif
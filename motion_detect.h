@@ -0,0 +1,129 @@
+#ifndef __MOTION_DETECT_H
+#define __MOTION_DETECT_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "esp_heap_caps.h"
+
+// ==================== 區塊式移動偵測 ====================
+// 每幀縮成 8x8 區塊的亮度格 (每區塊隔行隔列取 16 點), 與自適應背景比較:
+//   - 背景為 Q4 的 EMA; 靜止區塊追得快 (吸收光線變化), 有變化的區塊追得慢
+//   - 差異超過門檻的區塊數達到比例, 且連續數幀, 才算移動
+//   - 觸發後有冷卻時間, 避免同一段移動連拍
+// 只讀 1/4 的像素, QVGA 每幀遠低於 1 ms, 可以和即時預覽一起跑。
+
+#define MOTION_BLOCK            8
+#define MOTION_FRAC_BITS        4
+#define MOTION_BG_SHIFT         3      // 靜止區塊: 背景每幀追 1/8
+#define MOTION_BG_SHIFT_ACTIVE  6      // 有變化的區塊: 每幀追 1/64
+#define MOTION_WARMUP_FRAMES    8      // 建立背景期間不觸發
+
+struct MotionDetector {
+    uint16_t* background;     // 每區塊背景亮度 (Q4)
+    uint16_t grid_w;
+    uint16_t grid_h;
+    uint16_t capacity;        // background 可容納的區塊數
+    uint8_t threshold;        // 區塊亮度差門檻 (0-255 尺度)
+    uint8_t min_percent;      // 變化區塊比例門檻 (%)
+    uint8_t confirm_frames;   // 連續幾幀才觸發
+    uint8_t hits;             // 目前連續幀數
+    uint16_t warmup;          // 剩餘暖身幀數
+    uint32_t cooldown_ms;
+    unsigned long last_trigger_ms;
+    uint16_t changed_blocks;  // 最近一幀的變化區塊數
+    int64_t last_cost_us;     // 最近一幀的耗時
+    bool enabled;
+};
+
+void motion_init(MotionDetector* md, uint8_t threshold, uint8_t min_percent, uint8_t confirm_frames, uint32_t cooldown_ms) {
+    memset(md, 0, sizeof(MotionDetector));
+    md->threshold = threshold;
+    md->min_percent = min_percent;
+    md->confirm_frames = max<uint8_t>(confirm_frames, 1);
+    md->cooldown_ms = cooldown_ms;
+    md->warmup = MOTION_WARMUP_FRAMES;
+    md->enabled = true;
+}
+
+// 解析度改變或畫面不連續 (切換模式) 後重新建立背景
+void motion_reset(MotionDetector* md) {
+    md->grid_w = 0;
+    md->grid_h = 0;
+    md->hits = 0;
+    md->warmup = MOTION_WARMUP_FRAMES;
+}
+
+// RGB565 → 近似亮度 (0-252): 2R + 2G + B, 以 5/6 位元欄位直接加權
+__attribute__((always_inline)) inline uint8_t IRAM_ATTR motion_luma(uint16_t rgb) {
+    return ((rgb >> 11) << 1) + (((rgb >> 5) & 0x3F) << 1) + (rgb & 0x1F);
+}
+
+// 回傳 true 表示這一幀應觸發拍照 (byte_swapped: 緩衝區仍是感測器的大端序)
+bool motion_update(MotionDetector* md, const uint16_t* buffer, uint16_t width, uint16_t height, bool byte_swapped) {
+    if (!md->enabled || buffer == nullptr) return false;
+    int64_t start = esp_timer_get_time();
+    uint16_t gw = width / MOTION_BLOCK;
+    uint16_t gh = height / MOTION_BLOCK;
+    if (gw == 0 || gh == 0) return false;
+
+    if (gw != md->grid_w || gh != md->grid_h) {
+        uint32_t blocks = (uint32_t)gw * gh;
+        if (blocks > md->capacity) {
+            heap_caps_free(md->background);
+            md->background = (uint16_t*)heap_caps_malloc(blocks * sizeof(uint16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+            md->capacity = md->background ? blocks : 0;
+            if (md->background == nullptr) return false;
+        }
+        md->grid_w = gw;
+        md->grid_h = gh;
+        md->hits = 0;
+        md->warmup = MOTION_WARMUP_FRAMES;
+    }
+    bool seed = md->warmup == MOTION_WARMUP_FRAMES;
+
+    uint16_t changed = 0;
+    uint16_t* bg = md->background;
+    int32_t threshold_q = (int32_t)md->threshold << MOTION_FRAC_BITS;
+    for (uint16_t by = 0; by < gh; by++) {
+        const uint16_t* block_row = buffer + (size_t)by * MOTION_BLOCK * width;
+        for (uint16_t bx = 0; bx < gw; bx++, bg++) {
+            // 區塊內偶數行/偶數列 16 點
+            uint32_t sum = 0;
+            for (uint8_t y = 0; y < MOTION_BLOCK; y += 2) {
+                const uint16_t* p = block_row + (size_t)y * width + bx * MOTION_BLOCK;
+                for (uint8_t x = 0; x < MOTION_BLOCK; x += 2) {
+                    sum += motion_luma(byte_swapped ? __builtin_bswap16(p[x]) : p[x]);
+                }
+            }
+            // 16 點平均 → Q4: sum / 16 << 4 = sum
+            int32_t cur = sum;
+            if (seed) {
+                *bg = cur;
+                continue;
+            }
+            int32_t diff = cur - *bg;
+            bool active = abs(diff) > threshold_q;
+            changed += active;
+            int32_t step = diff >> (active ? MOTION_BG_SHIFT_ACTIVE : MOTION_BG_SHIFT);
+            *bg = (uint16_t)(*bg + (step ? step : (diff > 0) - (diff < 0)));
+        }
+    }
+
+    md->changed_blocks = changed;
+    md->last_cost_us = esp_timer_get_time() - start;
+    if (md->warmup) {
+        md->warmup--;
+        return false;
+    }
+
+    uint32_t needed = max<uint32_t>(1, (uint32_t)gw * gh * md->min_percent / 100);
+    md->hits = changed >= needed ? min<int>(md->hits + 1, 255) : 0;
+    if (md->hits < md->confirm_frames) return false;
+    if (md->last_trigger_ms && millis() - md->last_trigger_ms < md->cooldown_ms) return false;
+    md->last_trigger_ms = millis();
+    md->hits = 0;
+    return true;
+}
+
+#endif
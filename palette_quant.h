@@ -0,0 +1,178 @@
+#ifndef __PALETTE_QUANT_H
+#define __PALETTE_QUANT_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// ==================== 調色盤量化 (RGB565 → 8 位元索引) ====================
+// 每張影像建一個最多 256 色的調色盤, 給 8 位元 BMP 存檔 (sd_read_write.cpp 的 writeBMP_Indexed8)。
+//   - 直方圖: 整個 65536 色的 RGB565 空間, 每色一個 16 位元計數 (飽和, 不會溢位)
+//   - 中位數切割: 從包住所有出現顏色的方塊開始, 每次挑 像素數 x 最長邊 最大的方塊,
+//     沿最長邊 (以 8 位元單位比較) 在像素數的中位數切開, 兩半各自縮到實際出現的顏色範圍
+//   - 方塊互不重疊, 每個方塊就是一個調色盤項目: 逐方塊把範圍內的顏色填進 64K 查表,
+//     不需要對每個顏色找最近的調色盤項目; 調色盤顏色為方塊內像素的加權平均
+// 顏色數不超過 max_colors 時每個方塊只剩一種顏色, 結果無損 (例如顏色調整後只剩幾十色的畫面)。
+// 直方圖 128 KB + 查表 64 KB, 優先放 PSRAM, 第一次使用時配置。
+
+#define PALETTE_MAX_COLORS  256
+
+struct PaletteBox {
+    uint8_t lo[3];                   // 0 = R (0-31), 1 = G (0-63), 2 = B (0-31), 含兩端
+    uint8_t hi[3];
+    uint32_t count;
+    bool unsplittable;               // 只剩一種顏色, 或切割失敗
+};
+
+struct PaletteQuantizer {
+    uint16_t* histogram;             // RGB565 (本機位元組順序) → 像素數
+    uint8_t* lut;                    // RGB565 → 調色盤索引, 只有這張影像出現的顏色有效
+    uint8_t palette[PALETTE_MAX_COLORS][3];   // R, G, B (8 位元)
+    uint16_t colors;
+    uint32_t distinct;               // 這張影像出現的顏色數
+    PaletteBox boxes[PALETTE_MAX_COLORS];     // 切割用, 放這裡不佔 loop() 的堆疊
+    int64_t histogram_us;
+    int64_t build_us;                // 切割 + 查表
+};
+
+__attribute__((always_inline)) inline uint16_t palette_index(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint16_t)r << 11) | ((uint16_t)g << 5) | b;
+}
+
+// 方塊每邊換成 8 位元單位的長度 (R/B 一格 8, G 一格 4)
+__attribute__((always_inline)) inline uint16_t palette_extent(const PaletteBox* box, uint8_t axis) {
+    return (uint16_t)(box->hi[axis] - box->lo[axis] + 1) * (axis == 1 ? 4 : 8);
+}
+
+static void* palette_alloc_buffer(size_t bytes) {
+    void* p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (p == nullptr) p = heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    return p;
+}
+
+bool palette_alloc(PaletteQuantizer* q) {
+    if (q->histogram == nullptr) q->histogram = (uint16_t*)palette_alloc_buffer(65536 * sizeof(uint16_t));
+    if (q->lut == nullptr) q->lut = (uint8_t*)palette_alloc_buffer(65536);
+    return q->histogram && q->lut;
+}
+
+// 縮到方塊內實際出現的顏色範圍並重算像素數; 空方塊回傳 false
+static bool palette_shrink(const PaletteQuantizer* q, PaletteBox* box) {
+    uint8_t lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+    uint32_t count = 0;
+    for (uint8_t r = box->lo[0]; r <= box->hi[0]; r++) {
+        for (uint8_t g = box->lo[1]; g <= box->hi[1]; g++) {
+            const uint16_t* h = q->histogram + palette_index(r, g, 0);
+            for (uint8_t b = box->lo[2]; b <= box->hi[2]; b++) {
+                if (h[b] == 0) continue;
+                count += h[b];
+                lo[0] = min(lo[0], r); hi[0] = max(hi[0], r);
+                lo[1] = min(lo[1], g); hi[1] = max(hi[1], g);
+                lo[2] = min(lo[2], b); hi[2] = max(hi[2], b);
+            }
+        }
+    }
+    if (count == 0) return false;
+    memcpy(box->lo, lo, 3);
+    memcpy(box->hi, hi, 3);
+    box->count = count;
+    return true;
+}
+
+// 沿最長邊在中位數切開; box 保留下半, split 為上半。失敗時 box 不變
+static bool palette_split(const PaletteQuantizer* q, PaletteBox* box, PaletteBox* split) {
+    // 只考慮還能切的邊 (hi > lo); 以 8 位元單位比較時, 一格 G 和只有一階的 R/B 長度可能相同
+    int axis = -1;
+    for (uint8_t a = 0; a < 3; a++) {
+        if (box->hi[a] > box->lo[a] && (axis < 0 || palette_extent(box, a) > palette_extent(box, axis))) axis = a;
+    }
+    if (axis < 0) return false;
+    // 沿 axis 的投影
+    uint32_t projection[64] = { 0 };
+    for (uint8_t r = box->lo[0]; r <= box->hi[0]; r++) {
+        for (uint8_t g = box->lo[1]; g <= box->hi[1]; g++) {
+            const uint16_t* h = q->histogram + palette_index(r, g, 0);
+            for (uint8_t b = box->lo[2]; b <= box->hi[2]; b++) {
+                uint8_t v = axis == 0 ? r : axis == 1 ? g : b;
+                projection[v] += h[b];
+            }
+        }
+    }
+    // 切點在 [lo, hi) 內, 兩半都不空
+    uint32_t half = box->count / 2, sum = 0;
+    uint8_t cut = box->lo[axis];
+    for (; cut < box->hi[axis] - 1; cut++) {
+        sum += projection[cut];
+        if (sum >= half) break;
+    }
+    PaletteBox lower = *box, upper = *box;
+    lower.hi[axis] = cut;
+    upper.lo[axis] = cut + 1;
+    if (!palette_shrink(q, &lower) || !palette_shrink(q, &upper)) return false;
+    *box = lower;
+    *split = upper;
+    return true;
+}
+
+// frame: 本機位元組順序的 RGB565
+bool palette_build(PaletteQuantizer* q, const uint16_t* frame, size_t pixels, uint16_t max_colors) {
+    if (!palette_alloc(q) || frame == nullptr || pixels == 0) return false;
+    max_colors = constrain(max_colors, 1, PALETTE_MAX_COLORS);
+    int64_t start = esp_timer_get_time();
+    memset(q->histogram, 0, 65536 * sizeof(uint16_t));
+    for (size_t i = 0; i < pixels; i++) {
+        uint16_t* h = q->histogram + frame[i];
+        if (*h != 0xFFFF) (*h)++;
+    }
+    int64_t counted = esp_timer_get_time();
+
+    PaletteBox* boxes = q->boxes;
+    boxes[0] = { { 0, 0, 0 }, { 31, 63, 31 }, 0, false };
+    palette_shrink(q, &boxes[0]);
+    uint16_t count = 1;
+    while (count < max_colors) {
+        // 像素數 x 最長邊最大的可切方塊
+        int best = -1;
+        uint64_t best_score = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t extent = max(palette_extent(&boxes[i], 0), max(palette_extent(&boxes[i], 1), palette_extent(&boxes[i], 2)));
+            bool single = boxes[i].lo[0] == boxes[i].hi[0] && boxes[i].lo[1] == boxes[i].hi[1] && boxes[i].lo[2] == boxes[i].hi[2];
+            uint64_t score = (uint64_t)boxes[i].count * extent;
+            if (!single && !boxes[i].unsplittable && score > best_score) {
+                best = i;
+                best_score = score;
+            }
+        }
+        if (best < 0) break;   // 每個方塊都只剩一種顏色
+        if (palette_split(q, &boxes[best], &boxes[count])) count++;
+        else boxes[best].unsplittable = true;
+    }
+
+    // 調色盤 = 加權平均; 方塊內的顏色都對到這個索引
+    q->distinct = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        const PaletteBox* box = &boxes[i];
+        uint64_t sum[3] = { 0, 0, 0 };
+        for (uint8_t r = box->lo[0]; r <= box->hi[0]; r++) {
+            for (uint8_t g = box->lo[1]; g <= box->hi[1]; g++) {
+                uint16_t base = palette_index(r, g, 0);
+                for (uint8_t b = box->lo[2]; b <= box->hi[2]; b++) {
+                    uint16_t n = q->histogram[base + b];
+                    q->lut[base + b] = i;
+                    if (n == 0) continue;
+                    q->distinct++;
+                    sum[0] += (uint32_t)((r << 3) | (r >> 2)) * n;
+                    sum[1] += (uint32_t)((g << 2) | (g >> 4)) * n;
+                    sum[2] += (uint32_t)((b << 3) | (b >> 2)) * n;
+                }
+            }
+        }
+        for (uint8_t c = 0; c < 3; c++) q->palette[i][c] = (sum[c] + box->count / 2) / box->count;
+    }
+    q->colors = count;
+    q->histogram_us = counted - start;
+    q->build_us = esp_timer_get_time() - counted;
+    return true;
+}
+
+#endif
@@ -0,0 +1,417 @@
+#ifndef __REMOTE_CONTROL_H
+#define __REMOTE_CONTROL_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "checksum.h"
+#include "img_computing.h"
+#include "isp_offload.h"
+#include "auto_exposure.h"
+#include "serial_export.h"
+
+// ==================== 遠端即時控制 (二進位協定) ====================
+// 封包 (多位元組欄位為小端序):
+//   A5 | type | flags | seq(2) | len | payload[len] | crc8(type .. payload)
+// 同一種封包走 Serial、HTTP POST /rc 與 WebSocket /ws; 傳輸層只負責把位元組交給 rc_parser_feed,
+// 解出的訊息放進佇列, 由 loop() 在兩幀之間處理:
+//   - 設定寫進暫存緩衝 (config[!active]); 帶 RC_FLAG_APPLY 的訊息在下一個幀邊界
+//     一次切換 active, 多個訊息可以先暫存、最後一個再帶 APPLY, 整組同時生效
+//   - 不帶 APPLY 的訊息立即回覆 RC_STATUS_STAGED; 帶 APPLY 的訊息等套用後第一張影像
+//     顯示完才回覆, 附上收到 → 套用與收到 → 顯示的時間
+// 回覆封包的 type 為原 type | RC_MSG_REPLY, seq 相同, payload 為 status(1) apply_us(4) visible_us(4), GET 另附設定。
+
+#define RC_MAGIC            0xA5
+#define RC_HEADER_LEN       6
+#define RC_MAX_PAYLOAD      64
+#define RC_MAX_FRAME        (RC_HEADER_LEN + RC_MAX_PAYLOAD + 1)
+#define RC_QUEUE_LEN        16
+#define RC_MAX_ADJUSTMENTS  (ISP_MAX_SW_ADJUSTMENTS - 1)   // isp_plan_filters 保留一條給全域餘量
+#define RC_FLAG_APPLY       0x01
+#define RC_NO_CHANGE        0xFF                           // MODE 訊息中表示該欄位不變
+
+enum RcMessageType : uint8_t {
+    RC_MSG_PING = 0x00,          // 無 payload
+    RC_MSG_ADJUSTMENTS = 0x01,   // n, n x {target_hue, hue_shift, range, sat_shift}
+    RC_MSG_EXPOSURE = 0x02,      // target_luma (0 = 旋鈕), aec_value u16 (0 = 自動), agc_gain
+    RC_MSG_MODE = 0x03,          // grab_mode (0 濾鏡 / 1 一般), camera_mode (cameraModes 索引)
+    RC_MSG_GET = 0x04,           // 回覆目前設定
+    RC_MSG_EXPORT = 0x05,        // codec (serial_export.h ExportCodec, 0 = 關閉), every (每幾張送一張)
+    RC_MSG_REPLY = 0x80
+};
+
+enum RcStatus : uint8_t {
+    RC_STATUS_OK = 0,            // 已套用並顯示
+    RC_STATUS_STAGED,            // 已暫存, 等帶 APPLY 的訊息
+    RC_STATUS_BAD_CRC,
+    RC_STATUS_BAD_TYPE,
+    RC_STATUS_BAD_PAYLOAD,
+    RC_STATUS_BUSY               // 佇列已滿
+};
+
+// RcConfig 中被改到的部分 (rc_process 的回傳值)
+#define RC_CHANGED_ADJUSTMENTS  0x01
+#define RC_CHANGED_EXPOSURE     0x02
+#define RC_CHANGED_GRAB         0x04
+#define RC_CHANGED_CAMERA       0x08
+#define RC_CHANGED_EXPORT       0x10
+
+struct RcMessage {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t seq;
+    uint8_t len;
+    uint8_t payload[RC_MAX_PAYLOAD];
+};
+
+struct RcConfig {
+    ColorAdjustment adjustments[RC_MAX_ADJUSTMENTS];
+    uint8_t adjustment_count;
+    uint8_t target_luma;         // 0 = 跟隨旋鈕
+    uint16_t aec_value;          // 0 = 自動曝光
+    uint8_t agc_gain;            // 手動曝光時的增益
+    uint8_t grab_mode;
+    uint8_t camera_mode;
+    uint8_t export_codec;
+    uint8_t export_every;
+};
+
+// 回覆的去處; send 由傳輸層提供, 大多在 loop() 中呼叫 (佇列滿時在傳輸層自己的任務中呼叫)
+struct RcSink {
+    void (*send)(RcSink* sink, const uint8_t* frame, size_t len);
+    void* context;
+    uint8_t generation;          // 槽位重複使用時加一, 舊連線的回覆不會送到新連線
+    volatile bool open;
+};
+
+struct RcInbound {
+    RcMessage msg;
+    RcSink* sink;
+    uint8_t generation;
+    int64_t rx_us;               // 傳輸層收到的時間
+    int64_t apply_us;
+    uint8_t rx_status;           // 解析結果: RC_STATUS_OK 或 RC_STATUS_BAD_CRC
+};
+
+// 逐位元組解析 (可從任意位置開始, 自動找 RC_MAGIC 重新同步)
+struct RcParser {
+    uint8_t buf[RC_MAX_FRAME];
+    uint8_t used;
+};
+
+struct RemoteControl {
+    SemaphoreHandle_t lock;              // 保護 queue (傳輸層任務寫入, loop() 讀出)
+    RcInbound queue[RC_QUEUE_LEN];
+    uint8_t head;
+    uint8_t count;
+
+    RcConfig config[2];                  // 雙緩衝: config[active] 使用中, 另一個暫存
+    uint8_t active;
+    bool staging;                        // 暫存緩衝已從 active 複製
+    uint8_t staged_changes;
+
+    RcInbound waiting[RC_QUEUE_LEN];     // 已套用, 等下一張顯示後回覆
+    uint8_t waiting_count;
+    bool applied;                        // 這一幀開始前剛切換過設定
+
+    RcParser serial_parser;
+    RcSink serial_sink;
+
+    uint32_t commands;
+    uint32_t errors;
+    int64_t last_apply_us;               // 最近一次收到 → 套用
+    int64_t last_visible_us;             // 最近一次收到 → 顯示
+};
+
+// ---------- 封包 ----------
+
+// 組一個封包到 out (至少 RC_MAX_FRAME), 回傳長度
+size_t rc_encode(uint8_t type, uint8_t flags, uint16_t seq, const uint8_t* payload, uint8_t len, uint8_t* out) {
+    len = min<uint8_t>(len, RC_MAX_PAYLOAD);
+    out[0] = RC_MAGIC;
+    out[1] = type;
+    out[2] = flags;
+    out[3] = seq & 0xFF;
+    out[4] = seq >> 8;
+    out[5] = len;
+    if (len) memcpy(out + RC_HEADER_LEN, payload, len);
+    out[RC_HEADER_LEN + len] = crc8_update(0, out + 1, RC_HEADER_LEN - 1 + len);
+    return RC_HEADER_LEN + len + 1;
+}
+
+// 餵一個位元組; 1 = 解出一個訊息, -1 = CRC 錯誤 (msg 仍帶 type / seq 以便回覆), 0 = 還沒完整
+int rc_parser_feed(RcParser* p, uint8_t byte, RcMessage* msg) {
+    if (p->used == 0 && byte != RC_MAGIC) return 0;
+    p->buf[p->used++] = byte;
+    if (p->used == RC_HEADER_LEN && p->buf[5] > RC_MAX_PAYLOAD) {
+        p->used = 0;   // 長度不合理: 丟掉, 從下一個 RC_MAGIC 重新開始
+        return 0;
+    }
+    if (p->used < RC_HEADER_LEN || p->used < RC_HEADER_LEN + p->buf[5] + 1) return 0;
+    uint8_t len = p->buf[5];
+    p->used = 0;
+    msg->type = p->buf[1];
+    msg->flags = p->buf[2];
+    msg->seq = p->buf[3] | (p->buf[4] << 8);
+    msg->len = len;
+    memcpy(msg->payload, p->buf + RC_HEADER_LEN, len);
+    return crc8_update(0, p->buf + 1, RC_HEADER_LEN - 1 + len) == p->buf[RC_HEADER_LEN + len] ? 1 : -1;
+}
+
+// ---------- 傳輸層 (任何任務) ----------
+
+// 簽名需符合 RcSink::send; 序列埠只有一個, 不需要從 sink 找連線
+static void rc_serial_send(RcSink* sink, const uint8_t* frame, size_t len) {
+    (void)sink;
+    Serial.write(frame, len);
+}
+
+void rc_init(RemoteControl* rc, const ColorAdjustment* adjustments, uint8_t count, uint8_t grab_mode, uint8_t camera_mode) {
+    memset(rc, 0, sizeof(RemoteControl));
+    rc->lock = xSemaphoreCreateMutex();
+    RcConfig* cfg = &rc->config[0];
+    cfg->adjustment_count = min<uint8_t>(count, RC_MAX_ADJUSTMENTS);
+    memcpy(cfg->adjustments, adjustments, cfg->adjustment_count * sizeof(ColorAdjustment));
+    cfg->grab_mode = grab_mode;
+    cfg->camera_mode = camera_mode;
+    rc->serial_sink.send = rc_serial_send;
+    rc->serial_sink.open = true;
+}
+
+__attribute__((always_inline)) inline const RcConfig* rc_active(const RemoteControl* rc) {
+    return &rc->config[rc->active];
+}
+
+static void rc_reply(RcSink* sink, const RcMessage* msg, uint8_t status, const RcInbound* timing,
+                     const uint8_t* extra = nullptr, uint8_t extra_len = 0) {
+    if (sink == nullptr || !sink->open) return;
+    uint8_t payload[RC_MAX_PAYLOAD];
+    uint32_t apply_us = timing && timing->apply_us ? timing->apply_us - timing->rx_us : 0;
+    uint32_t visible_us = timing ? esp_timer_get_time() - timing->rx_us : 0;
+    payload[0] = status;
+    memcpy(payload + 1, &apply_us, 4);
+    memcpy(payload + 5, &visible_us, 4);
+    extra_len = min<uint8_t>(extra_len, RC_MAX_PAYLOAD - 9);
+    if (extra_len) memcpy(payload + 9, extra, extra_len);
+    uint8_t frame[RC_MAX_FRAME];
+    size_t len = rc_encode(msg->type | RC_MSG_REPLY, 0, msg->seq, payload, 9 + extra_len, frame);
+    sink->send(sink, frame, len);
+}
+
+// 傳輸層收到一段位元組 (HTTP 本文 / WebSocket 訊框): 解析後排入佇列。
+// 回傳解出的訊息數, 每個訊息之後都會收到一個回覆; CRC 錯誤也排入佇列, 由 loop() 回覆,
+// 佇列滿則立即回覆 RC_STATUS_BUSY。
+uint8_t rc_submit(RemoteControl* rc, RcParser* parser, const uint8_t* data, size_t len, RcSink* sink) {
+    uint8_t parsed = 0;
+    int64_t now = esp_timer_get_time();
+    RcMessage msg;
+    for (size_t i = 0; i < len; i++) {
+        int res = rc_parser_feed(parser, data[i], &msg);
+        if (res == 0) continue;
+        parsed++;
+        xSemaphoreTake(rc->lock, portMAX_DELAY);
+        bool full = rc->count >= RC_QUEUE_LEN;
+        if (!full) {
+            RcInbound* in = &rc->queue[(rc->head + rc->count) % RC_QUEUE_LEN];
+            in->msg = msg;
+            in->sink = sink;
+            in->generation = sink->generation;
+            in->rx_us = now;
+            in->apply_us = 0;
+            in->rx_status = res > 0 ? RC_STATUS_OK : RC_STATUS_BAD_CRC;
+            rc->count++;
+        }
+        xSemaphoreGive(rc->lock);
+        if (full) rc_reply(sink, &msg, RC_STATUS_BUSY, nullptr);
+    }
+    return parsed;
+}
+
+// ---------- loop() ----------
+
+// 讀 Serial 上的位元組 (loop() 呼叫)
+void rc_poll_serial(RemoteControl* rc, Stream* serial) {
+    uint8_t buf[32];
+    int avail;
+    while ((avail = serial->available()) > 0) {
+        size_t n = serial->readBytes(buf, min<int>(avail, sizeof(buf)));
+        if (n == 0) break;
+        rc_submit(rc, &rc->serial_parser, buf, n, &rc->serial_sink);
+    }
+}
+
+// 按鈕等本地操作改了模式: 同步到 active, GET 與之後的暫存以此為準
+void rc_sync_mode(RemoteControl* rc, uint8_t grab_mode, uint8_t camera_mode) {
+    rc->config[rc->active].grab_mode = grab_mode;
+    rc->config[rc->active].camera_mode = camera_mode;
+}
+
+void rc_sync_export(RemoteControl* rc, uint8_t codec, uint8_t every) {
+    rc->config[rc->active].export_codec = codec;
+    rc->config[rc->active].export_every = every;
+}
+
+static RcConfig* rc_staging(RemoteControl* rc) {
+    RcConfig* staged = &rc->config[!rc->active];
+    if (!rc->staging) {
+        *staged = rc->config[rc->active];
+        rc->staging = true;
+    }
+    return staged;
+}
+
+static size_t rc_serialize_config(const RcConfig* cfg, uint8_t* out) {
+    size_t n = 0;
+    out[n++] = cfg->adjustment_count;
+    for (uint8_t i = 0; i < cfg->adjustment_count; i++) {
+        out[n++] = cfg->adjustments[i].target_hue;
+        out[n++] = (uint8_t)cfg->adjustments[i].hue_shift;
+        out[n++] = cfg->adjustments[i].range;
+        out[n++] = (uint8_t)cfg->adjustments[i].sat_shift;
+    }
+    out[n++] = cfg->target_luma;
+    out[n++] = cfg->aec_value & 0xFF;
+    out[n++] = cfg->aec_value >> 8;
+    out[n++] = cfg->agc_gain;
+    out[n++] = cfg->grab_mode;
+    out[n++] = cfg->camera_mode;
+    out[n++] = cfg->export_codec;
+    out[n++] = cfg->export_every;
+    return n;
+}
+
+// 驗證並寫入暫存緩衝; 回傳狀態與改到的部分
+static uint8_t rc_stage(RemoteControl* rc, const RcMessage* msg, uint8_t* changes, uint8_t camera_modes) {
+    const uint8_t* p = msg->payload;
+    switch (msg->type) {
+        case RC_MSG_ADJUSTMENTS: {
+            if (msg->len < 1 || p[0] > RC_MAX_ADJUSTMENTS || msg->len != 1 + 4 * p[0]) return RC_STATUS_BAD_PAYLOAD;
+            for (uint8_t i = 0; i < p[0]; i++) {
+                if (p[3 + 4 * i] > 128) return RC_STATUS_BAD_PAYLOAD;   // range 0-128
+            }
+            RcConfig* cfg = rc_staging(rc);
+            cfg->adjustment_count = p[0];
+            for (uint8_t i = 0; i < p[0]; i++) {
+                const uint8_t* a = p + 1 + 4 * i;
+                cfg->adjustments[i] = { a[0], (int8_t)a[1], a[2], (int8_t)a[3] };
+            }
+            *changes |= RC_CHANGED_ADJUSTMENTS;
+            return RC_STATUS_OK;
+        }
+        case RC_MSG_EXPOSURE: {
+            if (msg->len != 4) return RC_STATUS_BAD_PAYLOAD;
+            uint16_t aec = p[1] | (p[2] << 8);
+            if ((p[0] != 0 && (p[0] < 16 || p[0] > 240)) || aec > AE_AEC_MAX || p[3] > AE_AGC_MAX) return RC_STATUS_BAD_PAYLOAD;
+            RcConfig* cfg = rc_staging(rc);
+            cfg->target_luma = p[0];
+            cfg->aec_value = aec;
+            cfg->agc_gain = p[3];
+            *changes |= RC_CHANGED_EXPOSURE;
+            return RC_STATUS_OK;
+        }
+        case RC_MSG_MODE: {
+            if (msg->len != 2 || (p[0] != RC_NO_CHANGE && p[0] > 1) || (p[1] != RC_NO_CHANGE && p[1] >= camera_modes)) {
+                return RC_STATUS_BAD_PAYLOAD;
+            }
+            RcConfig* cfg = rc_staging(rc);
+            if (p[0] != RC_NO_CHANGE) {
+                cfg->grab_mode = p[0];
+                *changes |= RC_CHANGED_GRAB;
+            }
+            if (p[1] != RC_NO_CHANGE) {
+                cfg->camera_mode = p[1];
+                *changes |= RC_CHANGED_CAMERA;
+            }
+            return RC_STATUS_OK;
+        }
+        case RC_MSG_EXPORT: {
+            if (msg->len != 2 || p[0] > EXPORT_DELTA || p[1] == 0) return RC_STATUS_BAD_PAYLOAD;
+            RcConfig* cfg = rc_staging(rc);
+            cfg->export_codec = p[0];
+            cfg->export_every = p[1];
+            *changes |= RC_CHANGED_EXPORT;
+            return RC_STATUS_OK;
+        }
+        default:
+            return RC_STATUS_BAD_TYPE;
+    }
+}
+
+// 幀邊界 (grab 之前) 呼叫: 處理佇列中的訊息, 有 APPLY 就切換設定。
+// 回傳這次切換改到的部分 (RC_CHANGED_*), 呼叫端依此套用到管線; 0 = 設定沒變。
+uint8_t rc_process(RemoteControl* rc, uint8_t camera_modes) {
+    bool apply = false;
+    for (;;) {
+        RcInbound in;
+        xSemaphoreTake(rc->lock, portMAX_DELAY);
+        bool has = rc->count > 0;
+        if (has) {
+            in = rc->queue[rc->head];
+            rc->head = (rc->head + 1) % RC_QUEUE_LEN;
+            rc->count--;
+        }
+        xSemaphoreGive(rc->lock);
+        if (!has) break;
+
+        RcSink* sink = in.sink->generation == in.generation ? in.sink : nullptr;
+        const RcMessage* msg = &in.msg;
+        rc->commands++;
+        if (in.rx_status != RC_STATUS_OK) {
+            rc->errors++;
+            rc_reply(sink, msg, in.rx_status, nullptr);
+            continue;
+        }
+        if (msg->type == RC_MSG_PING) {
+            rc_reply(sink, msg, RC_STATUS_OK, &in);
+            continue;
+        }
+        if (msg->type == RC_MSG_GET) {
+            uint8_t cfg[RC_MAX_PAYLOAD];
+            size_t n = rc_serialize_config(rc_active(rc), cfg);
+            rc_reply(sink, msg, RC_STATUS_OK, &in, cfg, n);
+            continue;
+        }
+        uint8_t status = rc_stage(rc, msg, &rc->staged_changes, camera_modes);
+        if (status != RC_STATUS_OK) {
+            rc->errors++;
+            rc_reply(sink, msg, status, &in);
+        } else if (!(msg->flags & RC_FLAG_APPLY)) {
+            rc_reply(sink, msg, RC_STATUS_STAGED, &in);
+        } else if (rc->waiting_count < RC_QUEUE_LEN) {
+            rc->waiting[rc->waiting_count++] = in;
+            apply = true;
+        } else {
+            rc_reply(sink, msg, RC_STATUS_BUSY, &in);
+        }
+    }
+    if (!apply) return 0;
+
+    int64_t now = esp_timer_get_time();
+    uint8_t changes = rc->staged_changes;
+    rc->active = !rc->active;
+    rc->staging = false;
+    rc->staged_changes = 0;
+    rc->applied = true;
+    for (uint8_t i = 0; i < rc->waiting_count; i++) {
+        if (rc->waiting[i].apply_us == 0) rc->waiting[i].apply_us = now;
+    }
+    return changes;
+}
+
+// 套用後的影像已顯示 (showFrame 之後呼叫): 回覆等待中的訊息; 回傳 true 表示剛回覆過
+bool rc_frame_shown(RemoteControl* rc) {
+    if (!rc->applied) return false;
+    rc->applied = false;
+    int64_t now = esp_timer_get_time();
+    for (uint8_t i = 0; i < rc->waiting_count; i++) {
+        RcInbound* in = &rc->waiting[i];
+        RcSink* sink = in->sink->generation == in->generation ? in->sink : nullptr;
+        rc_reply(sink, &in->msg, RC_STATUS_OK, in);
+        rc->last_apply_us = in->apply_us - in->rx_us;
+        rc->last_visible_us = now - in->rx_us;
+    }
+    rc->waiting_count = 0;
+    return true;
+}
+
+#endif
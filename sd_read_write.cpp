@@ -1,21 +1,22 @@
 #include "sd_read_write.h"
+#include "checksum.h"
 #include <FS.h>
 #include <Arduino.h>
 
 
 
 
-void sdmmcInit(void){
+bool sdmmcInit(void){
   SD_MMC.setPins(SD_MMC_CLK, SD_MMC_CMD, SD_MMC_D0);
   if (!SD_MMC.begin("/sdcard", true, true, SDMMC_FREQ_DEFAULT, 5)) {
     Serial.println("Card Mount Failed");
-    return;
+    return false;
   }
 
   uint8_t cardType = SD_MMC.cardType();
   if(cardType == CARD_NONE){
       Serial.println("No SD_MMC card attached");
-      return;
+      return false;
   }
   Serial.print("SD_MMC Card Type: ");
   if(cardType == CARD_MMC){
@@ -31,6 +32,7 @@ void sdmmcInit(void){
   Serial.printf("SD_MMC Card Size: %lluMB\n", cardSize);  
   Serial.printf("Total space: %lluMB\r\n", SD_MMC.totalBytes() / (1024 * 1024));
   Serial.printf("Used space: %lluMB\r\n", SD_MMC.usedBytes() / (1024 * 1024));
+  return true;
 }
 
 void listDir(fs::FS &fs, const char * dirname, uint8_t levels){
@@ -378,4 +380,473 @@ void writeBMP_RGB565(fs::FS &fs, const char *path, const uint16_t *rgb565Buf, si
     }
     file.close();
     Serial.printf("Saved: %s\n", path);
-}
\ No newline at end of file
+}
+
+
+void writeBMP_Indexed8(fs::FS &fs, const char *path, const uint16_t *rgb565Buf, size_t width, size_t height,
+                       const uint8_t *lut, const uint8_t (*palette)[3], uint16_t colors) {
+    // 1. 打开文件
+    File file = fs.open(path, FILE_WRITE);
+    if (!file) {
+        Serial.println("Failed to open file");
+        return;
+    }
+
+    // 2. 每像素 1 字节，行对齐到 4 字节
+    size_t padding = (4 - (width % 4)) % 4;
+    size_t rowSize = width + padding;
+    uint32_t paletteSize = colors * 4;
+
+    // 3. 写入BMP头与调色板（BGRA）
+    BMPHeader header = {
+        .signature = BMP_SIGNATURE,
+        .fileSize = static_cast<uint32_t>(54 + paletteSize + rowSize * height),
+        .reserved = 0,
+        .dataOffset = 54 + paletteSize,
+        .dibSize = DIB_HEADER_SIZE,
+        .width = static_cast<int32_t>(width),
+        .height = static_cast<int32_t>(height),
+        .planes = 1,
+        .bpp = 8,
+        .compression = 0,
+        .imageSize = static_cast<uint32_t>(rowSize * height),
+        .xPixelsPerM = PIXELS_PER_METER,
+        .yPixelsPerM = PIXELS_PER_METER,
+        .colorsUsed = colors,
+        .colorsImportant = 0
+    };
+    uint8_t table[256 * 4];
+    for (uint16_t i = 0; i < colors; i++) {
+        table[4 * i] = palette[i][2];
+        table[4 * i + 1] = palette[i][1];
+        table[4 * i + 2] = palette[i][0];
+        table[4 * i + 3] = 0;
+    }
+    if (file.write((uint8_t*)&header, sizeof(BMPHeader)) != sizeof(BMPHeader) || file.write(table, paletteSize) != paletteSize) {
+        Serial.println("Failed to write BMP header");
+        file.close();
+        return;
+    }
+
+    // 4. 逐行查表写入索引（行顺序与 writeBMP_RGB565 相同）
+    uint8_t rowBuffer[rowSize];
+    memset(rowBuffer + width, 0, padding);
+    for (size_t y = 0; y < height; y++) {
+        const uint16_t *src = rgb565Buf + y * width;
+        for (size_t x = 0; x < width; x++) rowBuffer[x] = lut[src[x]];
+        if (file.write(rowBuffer, rowSize) != rowSize) {
+            Serial.println("Failed to write pixel data");
+            file.close();
+            return;
+        }
+    }
+    file.close();
+    Serial.printf("Saved: %s (%u colours)\n", path, colors);
+}
+
+// ==================== PNG ====================
+// 逐行处理：RGB565 → RGB888 → 行滤波 → deflate → IDAT 块，不需要整张图的缓冲。
+// deflate 只用固定 Huffman 码（一个块，不用存码表），匹配在 PNG_WINDOW 的窗口内找；
+// 内存：窗口 2*PNG_WINDOW + 一行、哈希表与链 (4096 + PNG_WINDOW) * 4、一个 IDAT 缓冲、四行行缓冲。
+// 标准工具（浏览器、libpng、zlib）都能直接打开。
+
+static const uint16_t pngLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t pngLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t pngDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                         257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t pngDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                         7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static const size_t PNG_HASH_SIZE = 4096;        // 12 位哈希
+static const uint32_t PNG_NO_POS = 0xFFFFFFFF;
+
+// 固定 Huffman 码（已按位反转，可直接 LSB 先输出）与长度/距离 → 码号，第一次使用时建好
+static uint16_t pngFixedCode[288];
+static uint8_t pngFixedBits[288];
+static uint8_t pngDistSymbol[30];
+static uint8_t pngLengthCode[256];               // 长度 - 3
+static uint8_t pngDistCode[512];                 // 距离 - 1 < 256 直接查，否则查 256 + ((距离 - 1) >> 7)
+static bool pngTablesReady = false;
+
+struct PngWriter {
+    File *file;
+    uint8_t level;
+    bool failed;
+    uint32_t bitAcc;                             // deflate 位流（LSB 先）
+    uint8_t bitCount;
+    uint8_t out[PNG_IDAT_SIZE];                  // 满了就写成一个 IDAT 块
+    size_t outLen;
+    uint32_t adlerA;
+    uint32_t adlerB;
+    uint8_t *window;                             // 滤波后的数据，window[0] 的绝对位置为 windowBase
+    size_t windowLen;
+    size_t windowCap;
+    uint32_t windowBase;
+    uint32_t head[PNG_HASH_SIZE];                // 哈希 → 最近的绝对位置
+    uint32_t prev[PNG_WINDOW];                   // 位置 → 同哈希的前一个位置
+};
+
+static uint16_t pngReverse(uint16_t code, uint8_t bits) {
+    uint16_t r = 0;
+    for (uint8_t i = 0; i < bits; i++) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+static void pngInitTables() {
+    if (pngTablesReady) return;
+    for (uint16_t sym = 0; sym < 288; sym++) {
+        uint16_t code;
+        uint8_t bits;
+        if (sym < 144) { code = 0x30 + sym; bits = 8; }
+        else if (sym < 256) { code = 0x190 + sym - 144; bits = 9; }
+        else if (sym < 280) { code = sym - 256; bits = 7; }
+        else { code = 0xC0 + sym - 280; bits = 8; }
+        pngFixedCode[sym] = pngReverse(code, bits);
+        pngFixedBits[sym] = bits;
+    }
+    for (uint8_t c = 0; c < 28; c++) {
+        for (uint16_t n = 0; n < (1u << pngLengthExtra[c]); n++) pngLengthCode[pngLengthBase[c] - 3 + n] = c;
+    }
+    pngLengthCode[258 - 3] = 28;
+    for (uint8_t c = 0; c < 30; c++) {
+        pngDistSymbol[c] = pngReverse(c, 5);
+        if (c < 16) {
+            for (uint16_t n = 0; n < (1u << pngDistExtra[c]); n++) pngDistCode[pngDistBase[c] - 1 + n] = c;
+        } else {
+            for (uint16_t n = 0; n < (1u << (pngDistExtra[c] - 7)); n++) pngDistCode[256 + ((pngDistBase[c] - 1) >> 7) + n] = c;
+        }
+    }
+    pngTablesReady = true;
+}
+
+static void pngPutBE32(uint8_t *p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static bool pngWriteChunk(File &file, const char *type, const uint8_t *data, size_t len) {
+    uint8_t head[8];
+    uint8_t tail[4];
+    pngPutBE32(head, len);
+    memcpy(head + 4, type, 4);
+    pngPutBE32(tail, crc32_update_bulk(crc32_update(0, type, 4), data, len));
+    return file.write(head, 8) == 8 && (len == 0 || file.write(data, len) == len) && file.write(tail, 4) == 4;
+}
+
+static void pngFlushIdat(PngWriter *p) {
+    if (p->outLen == 0) return;
+    if (!p->failed && !pngWriteChunk(*p->file, "IDAT", p->out, p->outLen)) p->failed = true;
+    p->outLen = 0;
+}
+
+static inline void pngPutByte(PngWriter *p, uint8_t b) {
+    p->out[p->outLen++] = b;
+    if (p->outLen == PNG_IDAT_SIZE) pngFlushIdat(p);
+}
+
+// 字节对齐时整段复制（stored 块）
+static void pngPutBytes(PngWriter *p, const uint8_t *data, size_t len) {
+    while (len) {
+        size_t n = PNG_IDAT_SIZE - p->outLen;
+        if (n > len) n = len;
+        memcpy(p->out + p->outLen, data, n);
+        p->outLen += n;
+        data += n;
+        len -= n;
+        if (p->outLen == PNG_IDAT_SIZE) pngFlushIdat(p);
+    }
+}
+
+static inline void pngPutBits(PngWriter *p, uint32_t value, uint8_t count) {
+    p->bitAcc |= value << p->bitCount;
+    p->bitCount += count;
+    while (p->bitCount >= 8) {
+        pngPutByte(p, p->bitAcc & 0xFF);
+        p->bitAcc >>= 8;
+        p->bitCount -= 8;
+    }
+}
+
+// 补 0 到字节边界
+static void pngAlignByte(PngWriter *p) {
+    if (p->bitCount) pngPutByte(p, p->bitAcc & 0xFF);
+    p->bitAcc = 0;
+    p->bitCount = 0;
+}
+
+static inline void pngPutSymbol(PngWriter *p, uint16_t sym) {
+    pngPutBits(p, pngFixedCode[sym], pngFixedBits[sym]);
+}
+
+static void pngPutMatch(PngWriter *p, size_t length, size_t distance) {
+    uint8_t lc = pngLengthCode[length - 3];
+    pngPutSymbol(p, 257 + lc);
+    if (pngLengthExtra[lc]) pngPutBits(p, length - pngLengthBase[lc], pngLengthExtra[lc]);
+    uint8_t dc = distance <= 256 ? pngDistCode[distance - 1] : pngDistCode[256 + ((distance - 1) >> 7)];
+    pngPutBits(p, pngDistSymbol[dc], 5);
+    if (pngDistExtra[dc]) pngPutBits(p, distance - pngDistBase[dc], pngDistExtra[dc]);
+}
+
+static void pngAdler(PngWriter *p, const uint8_t *data, size_t len) {
+    uint32_t a = p->adlerA, b = p->adlerB;
+    while (len) {
+        size_t n = len < 5552 ? len : 5552;   // 5552 个字节内 b 不会溢出
+        len -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    p->adlerA = a;
+    p->adlerB = b;
+}
+
+static inline uint32_t pngHash(const uint8_t *s) {
+    return (((uint32_t)s[0] << 16 | (uint32_t)s[1] << 8 | s[2]) * 2654435761u) >> 20;
+}
+
+static inline size_t pngMatchLength(const uint8_t *a, const uint8_t *b, size_t max) {
+    size_t n = 0;
+    while (n < max && a[n] == b[n]) n++;
+    return n;
+}
+
+// 压缩窗口中 [start, end) 这一段；匹配不会超过 end（行尾）
+static void pngDeflateSegment(PngWriter *p, size_t start, size_t end) {
+    const uint8_t *w = p->window;
+    uint8_t chain = p->level == PNG_LEVEL_BEST ? 16 : 1;
+    size_t i = start;
+    while (i < end) {
+        size_t maxLen = end - i < 258 ? end - i : 258;
+        size_t bestLen = 0, bestDist = 0;
+        uint32_t pos = p->windowBase + i;
+        if (maxLen >= 3 && p->level == PNG_LEVEL_RLE) {
+            // 与前一个像素（距离 3）或前一个字节重复
+            if (i >= 3) {
+                bestLen = pngMatchLength(w + i, w + i - 3, maxLen);
+                bestDist = 3;
+            }
+            if (i >= 1 && bestLen < maxLen) {
+                size_t len = pngMatchLength(w + i, w + i - 1, maxLen);
+                if (len > bestLen) {
+                    bestLen = len;
+                    bestDist = 1;
+                }
+            }
+        } else if (maxLen >= 3) {
+            uint32_t h = pngHash(w + i);
+            uint32_t cand = p->head[h];
+            for (uint8_t n = 0; n < chain && cand < pos && pos - cand <= PNG_WINDOW; n++) {
+                const uint8_t *c = w + (cand - p->windowBase);
+                if (c[bestLen] == w[i + bestLen]) {
+                    size_t len = pngMatchLength(w + i, c, maxLen);
+                    if (len > bestLen) {
+                        bestLen = len;
+                        bestDist = pos - cand;
+                        if (len == maxLen) break;
+                    }
+                }
+                uint32_t next = p->prev[cand & (PNG_WINDOW - 1)];
+                if (next >= cand) break;   // 链已被新位置覆盖
+                cand = next;
+            }
+            p->prev[pos & (PNG_WINDOW - 1)] = p->head[h];
+            p->head[h] = pos;
+        }
+
+        if (bestLen >= 3) {
+            pngPutMatch(p, bestLen, bestDist);
+            if (p->level == PNG_LEVEL_BEST) {
+                // 匹配内的位置也加进哈希链
+                for (size_t j = i + 1; j < i + bestLen && j + 3 <= end; j++) {
+                    uint32_t h = pngHash(w + j);
+                    p->prev[(p->windowBase + j) & (PNG_WINDOW - 1)] = p->head[h];
+                    p->head[h] = p->windowBase + j;
+                }
+            }
+            i += bestLen;
+        } else {
+            pngPutSymbol(p, w[i]);
+            i++;
+        }
+    }
+}
+
+// 一行滤波后的数据（含开头的滤波类型）
+static void pngWriteRow(PngWriter *p, const uint8_t *data, size_t len, bool last) {
+    pngAdler(p, data, len);
+    if (p->level == PNG_LEVEL_STORED) {
+        // 每行一个 stored 块（一行不超过 65535 字节）
+        pngPutBits(p, last ? 1 : 0, 3);
+        pngAlignByte(p);
+        pngPutByte(p, len & 0xFF);
+        pngPutByte(p, len >> 8);
+        pngPutByte(p, ~len & 0xFF);
+        pngPutByte(p, (~len >> 8) & 0xFF);
+        pngPutBytes(p, data, len);
+        return;
+    }
+    // 窗口满了：只留最后 PNG_WINDOW 字节
+    if (p->windowLen + len > p->windowCap) {
+        size_t drop = p->windowLen - PNG_WINDOW;
+        memmove(p->window, p->window + drop, PNG_WINDOW);
+        p->windowBase += drop;
+        p->windowLen = PNG_WINDOW;
+    }
+    memcpy(p->window + p->windowLen, data, len);
+    pngDeflateSegment(p, p->windowLen, p->windowLen + len);
+    p->windowLen += len;
+}
+
+static inline uint8_t pngPaeth(int a, int b, int c) {
+    int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+// out[0] = 滤波类型，out[1..n] = 滤波结果；prior 为上一行（第一行为全 0）
+static void pngFilterRow(uint8_t type, const uint8_t *cur, const uint8_t *prior, uint8_t *out, size_t n) {
+    out[0] = type;
+    uint8_t *f = out + 1;
+    switch (type) {
+    case 0:
+        memcpy(f, cur, n);
+        break;
+    case 1:
+        for (size_t i = 0; i < n; i++) f[i] = cur[i] - (i >= 3 ? cur[i - 3] : 0);
+        break;
+    case 2:
+        for (size_t i = 0; i < n; i++) f[i] = cur[i] - prior[i];
+        break;
+    case 3:
+        for (size_t i = 0; i < n; i++) f[i] = cur[i] - (((i >= 3 ? cur[i - 3] : 0) + prior[i]) >> 1);
+        break;
+    default:
+        for (size_t i = 0; i < n; i++) {
+            f[i] = cur[i] - (i >= 3 ? pngPaeth(cur[i - 3], prior[i], prior[i - 3]) : prior[i]);
+        }
+        break;
+    }
+}
+
+// 绝对值和（视为有符号字节）
+static uint32_t pngFilterCost(const uint8_t *out, size_t n) {
+    uint32_t cost = 0;
+    for (size_t i = 1; i <= n; i++) cost += abs((int8_t)out[i]);
+    return cost;
+}
+
+bool writePNG_RGB565(fs::FS &fs, const char *path, const uint16_t *rgb565Buf, size_t width, size_t height, uint8_t level) {
+    // 1. 打开文件
+    File file = fs.open(path, FILE_WRITE);
+    if (!file) {
+        Serial.println("Failed to open file");
+        return false;
+    }
+
+    // 2. 配置缓冲：当前行、上一行、两个滤波行，压缩时再加窗口
+    pngInitTables();
+    size_t rowBytes = width * 3;
+    size_t windowCap = level == PNG_LEVEL_STORED ? 0 : 2 * PNG_WINDOW + rowBytes + 1;
+    PngWriter *p = (PngWriter *)malloc(sizeof(PngWriter));
+    uint8_t *rows = (uint8_t *)malloc(rowBytes * 2 + (rowBytes + 1) * 2 + windowCap);
+    if (p == nullptr || rows == nullptr) {
+        Serial.println("PNG: out of memory");
+        free(p);
+        free(rows);
+        file.close();
+        return false;
+    }
+    memset(p, 0, sizeof(PngWriter));
+    memset(p->head, 0xFF, sizeof(p->head));
+    memset(p->prev, 0xFF, sizeof(p->prev));
+    p->file = &file;
+    p->level = level > PNG_LEVEL_BEST ? PNG_LEVEL_BEST : level;
+    p->adlerA = 1;
+    p->window = rows + rowBytes * 2 + (rowBytes + 1) * 2;
+    p->windowCap = windowCap;
+    uint8_t *cur = rows;
+    uint8_t *prior = rows + rowBytes;
+    uint8_t *filtered = prior + rowBytes;
+    uint8_t *scratch = filtered + rowBytes + 1;
+    memset(prior, 0, rowBytes);
+
+    // 3. 写入签名与 IHDR（8 位 RGB，不交错）
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    uint8_t ihdr[13] = {0};
+    pngPutBE32(ihdr, width);
+    pngPutBE32(ihdr + 4, height);
+    ihdr[8] = 8;
+    ihdr[9] = 2;
+    if (file.write(signature, 8) != 8 || !pngWriteChunk(file, "IHDR", ihdr, 13)) p->failed = true;
+
+    // 4. zlib 头，压缩时整张图是一个固定 Huffman 块
+    pngPutByte(p, 0x78);
+    pngPutByte(p, 0x01);
+    if (p->level != PNG_LEVEL_STORED) pngPutBits(p, 3, 3);   // BFINAL = 1, BTYPE = 01
+
+    // 5. 逐行转换、滤波、压缩
+    for (size_t y = 0; y < height && !p->failed; y++) {
+        const uint16_t *src = rgb565Buf + y * width;
+        for (size_t x = 0; x < width; x++) {
+            uint16_t pixel = src[x];
+            uint8_t r = (pixel >> 11) & 0x1F;
+            uint8_t g = (pixel >> 5)  & 0x3F;
+            uint8_t b = pixel & 0x1F;
+            cur[3 * x] = (r << 3) | (r >> 2);
+            cur[3 * x + 1] = (g << 2) | (g >> 4);
+            cur[3 * x + 2] = (b << 3) | (b >> 2);
+        }
+        if (p->level == PNG_LEVEL_STORED) {
+            pngFilterRow(0, cur, prior, filtered, rowBytes);
+        } else if (p->level != PNG_LEVEL_BEST) {
+            pngFilterRow(1, cur, prior, filtered, rowBytes);
+        } else {
+            // 五种滤波中绝对值和最小的（libpng 的启发式）
+            uint32_t best = UINT32_MAX;
+            for (uint8_t type = 0; type < 5; type++) {
+                pngFilterRow(type, cur, prior, scratch, rowBytes);
+                uint32_t cost = pngFilterCost(scratch, rowBytes);
+                if (cost < best) {
+                    best = cost;
+                    uint8_t *t = filtered;
+                    filtered = scratch;
+                    scratch = t;
+                }
+            }
+        }
+        pngWriteRow(p, filtered, rowBytes + 1, y + 1 == height);
+        uint8_t *t = prior;
+        prior = cur;
+        cur = t;
+    }
+
+    // 6. 块结束码、Adler-32、IEND
+    if (p->level != PNG_LEVEL_STORED) pngPutSymbol(p, 256);
+    pngAlignByte(p);
+    uint32_t adler = (p->adlerB << 16) | p->adlerA;
+    pngPutByte(p, adler >> 24);
+    pngPutByte(p, adler >> 16);
+    pngPutByte(p, adler >> 8);
+    pngPutByte(p, adler);
+    pngFlushIdat(p);
+    bool ok = !p->failed && pngWriteChunk(file, "IEND", nullptr, 0);
+    size_t size = file.size();
+    file.close();
+    free(rows);
+    free(p);
+    if (ok) {
+        Serial.printf("Saved: %s (%u bytes, level %u)\n", path, (unsigned)size, level);
+    } else {
+        Serial.println("Failed to write PNG");
+    }
+    return ok;
+}
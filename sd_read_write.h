@@ -36,7 +36,7 @@ typedef struct {
 } BMPHeader;
 #pragma pack(pop)
 
-void sdmmcInit(void); 
+bool sdmmcInit(void); 
 
 void listDir(fs::FS &fs, const char * dirname, uint8_t levels);
 void createDir(fs::FS &fs, const char * path);
@@ -53,4 +53,19 @@ int readFileNum(fs::FS &fs, const char * dirname);
 void writebmp(fs::FS &fs, const char * path, const uint16_t *buf, size_t width, size_t height);
 void writeBMP_RGB565(fs::FS &fs, const char *path, const uint16_t *rgb565Buf, size_t width, size_t height);
 
+// 8 位元索引 BMP：像素经 lut（RGB565 → 索引）映射，palette 为 colors 个 R, G, B
+void writeBMP_Indexed8(fs::FS &fs, const char *path, const uint16_t *rgb565Buf, size_t width, size_t height,
+                       const uint8_t *lut, const uint8_t (*palette)[3], uint16_t colors);
+
+// PNG 压缩等级（速度 ↔ 大小）
+constexpr uint8_t PNG_LEVEL_STORED = 0;  // 不压缩（stored 块），最快
+constexpr uint8_t PNG_LEVEL_RLE    = 1;  // Sub 滤波 + 只找距离 1/3 的重复（RLE）
+constexpr uint8_t PNG_LEVEL_FAST   = 2;  // Sub 滤波 + 哈希表，每个位置只比一个候选
+constexpr uint8_t PNG_LEVEL_BEST   = 3;  // 每行挑最佳滤波 + 哈希链（最多 16 个候选）
+constexpr size_t PNG_WINDOW = 4096;      // 匹配窗口（字节）
+constexpr size_t PNG_IDAT_SIZE = 4096;   // 每个 IDAT 块的大小
+
+// RGB565（本机字节序，与 writeBMP_RGB565 相同）逐行压缩写成 24 位 PNG；成功回传 true
+bool writePNG_RGB565(fs::FS &fs, const char *path, const uint16_t *rgb565Buf, size_t width, size_t height, uint8_t level = PNG_LEVEL_FAST);
+
 #endif
@@ -0,0 +1,180 @@
+#ifndef __SENSOR_PROFILE_H
+#define __SENSOR_PROFILE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include "FS.h"
+#include "esp_camera.h"
+#include "auto_exposure.h"
+#include "checksum.h"
+
+// ==================== 感測器設定快照 ====================
+// 把調好的感測器狀態與 AE/AWB 收斂結果存成小型二進位 blob (NVS 或 SD),
+// 開機時還原, 第一幀就有正確曝光, 不必等 AEC/AWB 重新收斂。
+
+#define SENSOR_PROFILE_MAGIC     0x46525053  // 'SPRF'
+#define SENSOR_PROFILE_VERSION   1
+#define SENSOR_PROFILE_NVS_NS    "camera"
+#define SENSOR_PROFILE_NVS_KEY   "sensor"
+#define SENSOR_PROFILE_AEC_TOL   8           // aec_value 變化超過 1/8 才重存
+#define SENSOR_PROFILE_GAIN_TOL  8           // AWB 增益 (Q8) 變化超過此值才重存
+
+// 開關類設定壓成位元旗標
+enum SensorProfileFlag : uint16_t {
+    SPF_AWB      = 1 << 0,
+    SPF_AWB_GAIN = 1 << 1,
+    SPF_AEC      = 1 << 2,
+    SPF_AEC2     = 1 << 3,
+    SPF_AGC      = 1 << 4,
+    SPF_BPC      = 1 << 5,
+    SPF_WPC      = 1 << 6,
+    SPF_RAW_GMA  = 1 << 7,
+    SPF_LENC     = 1 << 8,
+    SPF_HMIRROR  = 1 << 9,
+    SPF_VFLIP    = 1 << 10,
+    SPF_DCW      = 1 << 11,
+};
+
+#pragma pack(push, 1)
+struct SensorProfile {
+    uint32_t magic;
+    uint8_t  version;
+    uint16_t pid;            // 只還原到同型號感測器
+    uint16_t flags;          // SensorProfileFlag
+    int8_t   brightness;
+    int8_t   contrast;
+    int8_t   saturation;
+    int8_t   sharpness;
+    int8_t   ae_level;
+    uint8_t  denoise;
+    uint8_t  special_effect;
+    uint8_t  wb_mode;
+    uint8_t  gainceiling;
+    // 軟體 AE/AWB 收斂狀態
+    uint16_t aec_value;
+    uint8_t  agc_gain;
+    uint8_t  target_luma;
+    uint16_t gain_r;
+    uint16_t gain_g;
+    uint16_t gain_b;
+    uint32_t crc;            // 以上所有欄位的 CRC-32
+};
+#pragma pack(pop)
+
+static uint32_t sensor_profile_crc(const SensorProfile* p) {
+    return crc32_update(0, p, offsetof(SensorProfile, crc));
+}
+
+// 從目前感測器狀態與 AE 控制器建立快照
+void sensor_profile_capture(sensor_t* s, const AutoExposure* ae, SensorProfile* p) {
+    const camera_status_t* st = &s->status;
+    memset(p, 0, sizeof(SensorProfile));
+    p->magic = SENSOR_PROFILE_MAGIC;
+    p->version = SENSOR_PROFILE_VERSION;
+    p->pid = s->id.PID;
+    p->flags = (st->awb ? SPF_AWB : 0) | (st->awb_gain ? SPF_AWB_GAIN : 0) | (st->aec ? SPF_AEC : 0) |
+               (st->aec2 ? SPF_AEC2 : 0) | (st->agc ? SPF_AGC : 0) | (st->bpc ? SPF_BPC : 0) |
+               (st->wpc ? SPF_WPC : 0) | (st->raw_gma ? SPF_RAW_GMA : 0) | (st->lenc ? SPF_LENC : 0) |
+               (st->hmirror ? SPF_HMIRROR : 0) | (st->vflip ? SPF_VFLIP : 0) | (st->dcw ? SPF_DCW : 0);
+    p->brightness = st->brightness;
+    p->contrast = st->contrast;
+    p->saturation = st->saturation;
+    p->sharpness = st->sharpness;
+    p->ae_level = st->ae_level;
+    p->denoise = st->denoise;
+    p->special_effect = st->special_effect;
+    p->wb_mode = st->wb_mode;
+    p->gainceiling = st->gainceiling;
+    p->aec_value = ae->aec_value;
+    p->agc_gain = ae->agc_gain;
+    p->target_luma = ae->target_luma;
+    p->gain_r = ae->gain_r;
+    p->gain_g = ae->gain_g;
+    p->gain_b = ae->gain_b;
+    p->crc = sensor_profile_crc(p);
+}
+
+bool sensor_profile_valid(const SensorProfile* p, uint16_t pid) {
+    return p->magic == SENSOR_PROFILE_MAGIC && p->version == SENSOR_PROFILE_VERSION &&
+           p->pid == pid && p->crc == sensor_profile_crc(p);
+}
+
+// 寫回感測器並預先設定 AE 控制器 (之後仍需 ae_apply_sensor)
+void sensor_profile_apply(sensor_t* s, const SensorProfile* p, AutoExposure* ae) {
+    s->set_brightness(s, p->brightness);
+    s->set_contrast(s, p->contrast);
+    s->set_saturation(s, p->saturation);
+    s->set_sharpness(s, p->sharpness);
+    s->set_denoise(s, p->denoise);
+    s->set_special_effect(s, p->special_effect);
+    s->set_wb_mode(s, p->wb_mode);
+    s->set_ae_level(s, p->ae_level);
+    s->set_gainceiling(s, (gainceiling_t)p->gainceiling);
+    s->set_awb_gain(s, (p->flags & SPF_AWB_GAIN) != 0);
+    s->set_aec2(s, (p->flags & SPF_AEC2) != 0);
+    s->set_bpc(s, (p->flags & SPF_BPC) != 0);
+    s->set_wpc(s, (p->flags & SPF_WPC) != 0);
+    s->set_raw_gma(s, (p->flags & SPF_RAW_GMA) != 0);
+    s->set_lenc(s, (p->flags & SPF_LENC) != 0);
+    s->set_hmirror(s, (p->flags & SPF_HMIRROR) != 0);
+    s->set_vflip(s, (p->flags & SPF_VFLIP) != 0);
+    s->set_dcw(s, (p->flags & SPF_DCW) != 0);
+
+    ae->aec_value = constrain(p->aec_value, AE_AEC_MIN, AE_AEC_MAX);
+    ae->agc_gain = min<int>(p->agc_gain, AE_AGC_MAX);
+    ae->target_luma = p->target_luma;
+    ae->gain_r = constrain(p->gain_r, AWB_GAIN_MIN, AWB_GAIN_MAX);
+    ae->gain_g = constrain(p->gain_g, AWB_GAIN_MIN, AWB_GAIN_MAX);
+    ae->gain_b = constrain(p->gain_b, AWB_GAIN_MIN, AWB_GAIN_MAX);
+    build_channel_gain_lut(&ae->lut, ae->gain_r, ae->gain_g, ae->gain_b);
+}
+
+// 是否值得重新寫入 (避免 AE 小幅擺動造成頻繁寫 flash)
+bool sensor_profile_differs(const SensorProfile* a, const SensorProfile* b) {
+    if (memcmp(a, b, offsetof(SensorProfile, aec_value)) != 0) return true;
+    if (abs((int)a->aec_value - (int)b->aec_value) > a->aec_value / SENSOR_PROFILE_AEC_TOL) return true;
+    if (a->agc_gain != b->agc_gain || a->target_luma != b->target_luma) return true;
+    return abs((int)a->gain_r - (int)b->gain_r) > SENSOR_PROFILE_GAIN_TOL ||
+           abs((int)a->gain_g - (int)b->gain_g) > SENSOR_PROFILE_GAIN_TOL ||
+           abs((int)a->gain_b - (int)b->gain_b) > SENSOR_PROFILE_GAIN_TOL;
+}
+
+// ---------- NVS ----------
+
+bool sensor_profile_save_nvs(const SensorProfile* p) {
+    Preferences prefs;
+    if (!prefs.begin(SENSOR_PROFILE_NVS_NS, false)) return false;
+    bool ok = prefs.putBytes(SENSOR_PROFILE_NVS_KEY, p, sizeof(SensorProfile)) == sizeof(SensorProfile);
+    prefs.end();
+    return ok;
+}
+
+bool sensor_profile_load_nvs(SensorProfile* p) {
+    Preferences prefs;
+    if (!prefs.begin(SENSOR_PROFILE_NVS_NS, true)) return false;
+    bool ok = prefs.getBytesLength(SENSOR_PROFILE_NVS_KEY) == sizeof(SensorProfile) &&
+              prefs.getBytes(SENSOR_PROFILE_NVS_KEY, p, sizeof(SensorProfile)) == sizeof(SensorProfile);
+    prefs.end();
+    return ok;
+}
+
+// ---------- SD ----------
+
+bool sensor_profile_save_fs(fs::FS &fs, const char* path, const SensorProfile* p) {
+    File file = fs.open(path, FILE_WRITE);
+    if (!file) return false;
+    bool ok = file.write((const uint8_t*)p, sizeof(SensorProfile)) == sizeof(SensorProfile);
+    file.close();
+    return ok;
+}
+
+bool sensor_profile_load_fs(fs::FS &fs, const char* path, SensorProfile* p) {
+    File file = fs.open(path);
+    if (!file) return false;
+    bool ok = file.read((uint8_t*)p, sizeof(SensorProfile)) == sizeof(SensorProfile);
+    file.close();
+    return ok;
+}
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef __SERIAL_EXPORT_H
+#define __SERIAL_EXPORT_H
+
+#include <stdint.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "checksum.h"
+
+// ==================== 序列埠影像匯出 ====================
+// 把處理完的影像 (感測器位元組順序的 RGB565) 經 Serial 送到主機 (host/frame_receiver.cpp)。
+// 封包 (多位元組欄位為小端序):
+//   magic FE 'F' 'R' 'M' | version | codec | format | flags | seq(4) | width(2) | height(2)
+//   | timestamp_ms(4) | payload_len(4) | header_crc32(4) | payload | payload_crc32(4)
+// Serial 同時還有文字記錄與 remote_control.h 的回覆 (A5 開頭); 0xFE 不會出現在 UTF-8 文字中,
+// 接收端跳過封包之間的其他位元組, 以 magic + 標頭 CRC 找到封包。
+//   - loop() 只把影像複製到暫存緩衝 (export_offer); 壓縮與送出在核心 0 的任務中,
+//     上一張還沒送完就跳過這一張 (算一次 busy), 不會拖慢影像管線
+//   - 整個封包一次 Serial.write: USB-CDC 與 UART 的 write 在整段資料期間持有傳送鎖,
+//     其他任務的文字不會插進封包中間
+//   - USB-CDC 不理會鮑率, 以 USB full speed 傳送; 送出速率就是連線的上限
+//   - UART0 (ARDUINO_USB_CDC_ON_BOOT=0) 在 115200 下 QVGA RAW 一張要 13 秒,
+//     第一次開啟匯出時把 Serial 提高到 EXPORT_UART_BAUD (之後的文字記錄也用這個鮑率)
+//
+// 壓縮 (codec):
+//   RAW   原始像素
+//   RLE   16 位元像素的 PackBits: 控制位元組 c < 128 → 接著 c + 1 個像素;
+//         c >= 128 → 下一個像素重複 c - 126 次 (2..129)
+//   DELTA 與上一張送出的影像逐像素 XOR 後再 RLE; 靜止的畫面大多是 0 的長串。
+//         每 EXPORT_KEYFRAME_INTERVAL 張、尺寸改變或剛切換 codec 時送關鍵幀 (對 0 XOR)。
+// 壓縮後不比原始小就改送 RAW (也是關鍵幀), 接收端看標頭的 codec 解碼。
+
+#define EXPORT_UART_BAUD           2000000   // 與 frame_receiver 的預設 --baud 相同
+#define EXPORT_MAGIC0              0xFE
+#define EXPORT_MAGIC1              'F'
+#define EXPORT_MAGIC2              'R'
+#define EXPORT_MAGIC3              'M'
+#define EXPORT_VERSION             1
+#define EXPORT_HEADER_LEN          28
+#define EXPORT_KEYFRAME_INTERVAL   30
+#define EXPORT_FLAG_KEYFRAME       0x01
+
+enum ExportCodec : uint8_t {
+    EXPORT_OFF = 0,
+    EXPORT_RAW,
+    EXPORT_RLE,
+    EXPORT_DELTA
+};
+
+enum ExportFormat : uint8_t {
+    EXPORT_FORMAT_RGB565_BE = 0      // 感測器位元組順序 (高位元組在前)
+};
+
+struct SerialExporter {
+    Print* out;
+    uint8_t codec;                   // EXPORT_OFF 時不收影像
+    uint8_t every;                   // 每 every 張送一張
+    uint32_t counter;
+    TaskHandle_t task;
+    SemaphoreHandle_t ready;         // export_offer → 任務: staged 已填好
+    volatile bool busy;              // 任務持有 staged, 送完才清掉
+    bool uart_raised;                // 已把 UART 提高到 EXPORT_UART_BAUD
+
+    uint16_t* staged;                // loop() 複製進來的影像
+    size_t staged_pixels;
+    uint16_t width;
+    uint16_t height;
+    int64_t staged_us;
+    uint8_t staged_codec;            // 交出時的 codec (loop() 可能在送出期間切換)
+
+    // 以下只有任務使用
+    uint16_t* reference;             // 上一張送出的影像 (DELTA 用)
+    size_t reference_pixels;
+    uint16_t ref_width;
+    uint16_t ref_height;
+    uint8_t ref_codec;               // 參考影像建立時的 codec, 切換後重送關鍵幀
+    uint32_t since_keyframe;
+    uint8_t* packet;
+    size_t packet_cap;
+    uint32_t seq;
+
+    // 統計
+    uint32_t sent;
+    uint32_t busy_skips;             // 上一張還在送, 跳過
+    uint32_t keyframes;
+    uint64_t raw_bytes;
+    uint64_t wire_bytes;
+    int64_t encode_us;               // 最近一張壓縮 + CRC 耗時
+    int64_t send_us;                 // 最近一張 Serial.write 耗時
+    uint32_t latency_us;             // export_offer 到送完 (平滑)
+};
+
+// ---------- 編碼 ----------
+
+__attribute__((always_inline)) inline uint16_t export_pixel(const uint16_t* src, const uint16_t* ref, size_t i) {
+    return ref ? src[i] ^ ref[i] : src[i];
+}
+
+// 16 位元 PackBits; ref 非 nullptr 時先與 ref XOR。超過 cap 回傳 0 (改送 RAW)
+static size_t export_rle_encode(const uint16_t* src, const uint16_t* ref, size_t n, uint8_t* out, size_t cap) {
+    size_t i = 0, o = 0;
+    while (i < n) {
+        uint16_t v = export_pixel(src, ref, i);
+        size_t run = 1;
+        while (i + run < n && run < 129 && export_pixel(src, ref, i + run) == v) run++;
+        if (run >= 2) {
+            if (o + 3 > cap) return 0;
+            out[o++] = (uint8_t)(126 + run);
+            memcpy(out + o, &v, 2);
+            o += 2;
+            i += run;
+            continue;
+        }
+        // 逐字: 直到下一段重複開始或滿 128 個
+        size_t start = i++, lit = 1;
+        while (i < n && lit < 128 && !(i + 1 < n && export_pixel(src, ref, i) == export_pixel(src, ref, i + 1))) {
+            i++;
+            lit++;
+        }
+        if (o + 1 + 2 * lit > cap) return 0;
+        out[o++] = (uint8_t)(lit - 1);
+        for (size_t k = start; k < start + lit; k++, o += 2) {
+            uint16_t p = export_pixel(src, ref, k);
+            memcpy(out + o, &p, 2);
+        }
+    }
+    return o;
+}
+
+static void* export_alloc(size_t bytes) {
+    void* p = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (p == nullptr) p = heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    return p;
+}
+
+__attribute__((always_inline)) inline void export_put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+__attribute__((always_inline)) inline void export_put32(uint8_t* p, uint32_t v) {
+    export_put16(p, v & 0xFFFF);
+    export_put16(p + 2, v >> 16);
+}
+
+// ---------- 任務 (核心 0) ----------
+
+// 組封包到 e->packet, 回傳總長; 配置失敗回傳 0
+static size_t export_build_packet(SerialExporter* e) {
+    size_t pixels = (size_t)e->width * e->height;
+    size_t raw = pixels * 2;
+    if (EXPORT_HEADER_LEN + raw + 4 > e->packet_cap) {
+        free(e->packet);
+        e->packet_cap = EXPORT_HEADER_LEN + raw + 4;
+        e->packet = (uint8_t*)export_alloc(e->packet_cap);
+        if (e->packet == nullptr) {
+            e->packet_cap = 0;
+            return 0;
+        }
+    }
+    uint8_t codec = e->staged_codec;
+    bool keyframe = true;
+    const uint16_t* ref = nullptr;
+    if (codec == EXPORT_DELTA) {
+        if (pixels > e->reference_pixels) {
+            free(e->reference);
+            e->reference = (uint16_t*)export_alloc(raw);
+            e->reference_pixels = e->reference ? pixels : 0;
+            e->ref_codec = EXPORT_OFF;   // 新緩衝沒有內容
+        }
+        if (e->reference == nullptr) {
+            codec = EXPORT_RLE;
+        } else {
+            keyframe = e->ref_codec != EXPORT_DELTA || e->ref_width != e->width || e->ref_height != e->height ||
+                       e->since_keyframe >= EXPORT_KEYFRAME_INTERVAL;
+            if (!keyframe) ref = e->reference;
+        }
+    }
+
+    uint8_t* payload = e->packet + EXPORT_HEADER_LEN;
+    size_t len = 0;
+    if (codec != EXPORT_RAW) len = export_rle_encode(e->staged, ref, pixels, payload, raw);
+    if (len == 0 || len >= raw) {
+        codec = EXPORT_RAW;
+        keyframe = true;
+        len = raw;
+        memcpy(payload, e->staged, raw);
+    }
+    if (e->staged_codec == EXPORT_DELTA && e->reference) {
+        memcpy(e->reference, e->staged, raw);
+        e->ref_codec = EXPORT_DELTA;
+        e->ref_width = e->width;
+        e->ref_height = e->height;
+        e->since_keyframe = keyframe ? 1 : e->since_keyframe + 1;
+    }
+
+    uint8_t* h = e->packet;
+    h[0] = EXPORT_MAGIC0;
+    h[1] = EXPORT_MAGIC1;
+    h[2] = EXPORT_MAGIC2;
+    h[3] = EXPORT_MAGIC3;
+    h[4] = EXPORT_VERSION;
+    h[5] = codec;
+    h[6] = EXPORT_FORMAT_RGB565_BE;
+    h[7] = keyframe ? EXPORT_FLAG_KEYFRAME : 0;
+    export_put32(h + 8, ++e->seq);
+    export_put16(h + 12, e->width);
+    export_put16(h + 14, e->height);
+    export_put32(h + 16, (uint32_t)(e->staged_us / 1000));
+    export_put32(h + 20, len);
+    export_put32(h + 24, crc32_update(0, h, 24));
+    export_put32(payload + len, crc32_update(0, payload, len));
+    if (keyframe) e->keyframes++;
+    e->raw_bytes += raw;
+    return EXPORT_HEADER_LEN + len + 4;
+}
+
+static void export_task(void* p) {
+    SerialExporter* e = (SerialExporter*)p;
+    for (;;) {
+        xSemaphoreTake(e->ready, portMAX_DELAY);
+        int64_t start = esp_timer_get_time();
+        size_t len = export_build_packet(e);
+        int64_t built = esp_timer_get_time();
+        if (len) {
+            e->out->write(e->packet, len);
+            e->sent++;
+            e->wire_bytes += len;
+        }
+        int64_t now = esp_timer_get_time();
+        e->encode_us = built - start;
+        e->send_us = now - built;
+        uint32_t latency = now - e->staged_us;
+        e->latency_us = e->latency_us ? ((uint64_t)e->latency_us * 3 + latency) / 4 : latency;
+        e->busy = false;
+    }
+}
+
+// ---------- loop() ----------
+
+void export_configure(SerialExporter* e, uint8_t codec, uint8_t every) {
+    e->codec = codec;
+    if (codec > EXPORT_DELTA) e->codec = EXPORT_OFF;   // 未知的 codec 視為關閉
+    e->every = max<uint8_t>(every, 1);
+#if !ARDUINO_USB_CDC_ON_BOOT
+    if (e->codec != EXPORT_OFF && e->out == &Serial && !e->uart_raised) {
+        Serial.printf("Serial export: switching to %u baud\n", EXPORT_UART_BAUD);
+        Serial.flush();
+        Serial.updateBaudRate(EXPORT_UART_BAUD);
+        e->uart_raised = true;
+    }
+#endif
+    if (e->codec == EXPORT_OFF || e->task || e->ready == nullptr) return;
+    // 第一次開啟時才建立任務
+    if (xTaskCreatePinnedToCore(export_task, "serial_export", 4096, e, 1, &e->task, 0) != pdPASS) {
+        Serial.println("Serial export: failed to create task");
+        e->task = nullptr;
+        e->codec = EXPORT_OFF;
+    }
+}
+
+bool export_init(SerialExporter* e, Print* out, uint8_t codec, uint8_t every) {
+    memset(e, 0, sizeof(SerialExporter));
+    e->out = out;
+    e->ready = xSemaphoreCreateBinary();
+    if (e->ready == nullptr) return false;
+    export_configure(e, codec, every);
+    return true;
+}
+
+__attribute__((always_inline)) inline bool export_enabled(const SerialExporter* e) {
+    return e->codec != EXPORT_OFF && e->task;
+}
+
+// 處理完的影像 (感測器位元組順序); 回傳 true 表示已交給任務
+bool export_offer(SerialExporter* e, const uint16_t* buffer, uint16_t width, uint16_t height) {
+    if (!export_enabled(e) || e->counter++ % e->every) return false;
+    if (e->busy) {
+        e->busy_skips++;
+        return false;
+    }
+    size_t pixels = (size_t)width * height;
+    if (pixels > e->staged_pixels) {
+        free(e->staged);
+        e->staged = (uint16_t*)export_alloc(pixels * 2);
+        e->staged_pixels = e->staged ? pixels : 0;
+        if (e->staged == nullptr) return false;
+    }
+    memcpy(e->staged, buffer, pixels * 2);
+    e->width = width;
+    e->height = height;
+    e->staged_us = esp_timer_get_time();
+    e->staged_codec = e->codec;
+    e->busy = true;
+    xSemaphoreGive(e->ready);
+    return true;
+}
+
+#endif
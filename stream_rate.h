@@ -0,0 +1,158 @@
+#ifndef __STREAM_RATE_H
+#define __STREAM_RATE_H
+
+#include <stdint.h>
+#include <math.h>
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "frame_broadcast.h"
+
+// ==================== 串流位元率控制 ====================
+// 依各客戶端量到的送出速率 (drain_bps) 調整共用編碼的 JPEG 品質、跳幀與縮小。
+// 只有會丟幀的客戶端 (saturated) 的送出速率才是連線上限, 沒丟幀的表示還有餘裕:
+//   - 品質與縮小跟著最慢的飽和客戶端: 一張影像要在目標延遲的一半內送完
+//     (另一半留給排隊等前一張), 品質每次更新最多變動 RATE_QUALITY_SLEW, 畫面不會忽好忽壞
+//   - 品質降到下限仍送不完 → 長寬各半再編碼; 有足夠餘裕且品質到上限 → 回到原尺寸
+//   - 跳幀跟著最快的客戶端: 所有客戶端都飽和時, 才依最快的速率少編碼, 省下編碼時間
+// 編碼只有一份 (frame_broadcast.h), 所以是所有客戶端共用一組設定。
+
+#define RATE_TARGET_LATENCY_MS   200
+#define RATE_QUALITY_MIN         20
+#define RATE_QUALITY_MAX         90
+#define RATE_QUALITY_SLEW        3        // 每次更新最多改變的品質
+#define RATE_QUALITY_GAIN        12.0f    // 品質變化 / log2(預算 / 影像大小)
+#define RATE_UPDATE_US           500000
+#define RATE_MAX_SKIP            8
+#define RATE_DOWNSCALE_RATIO     0.7f     // 品質在下限且預算 / 大小低於此值 → 縮小
+#define RATE_UPSCALE_RATIO       4.0f     // 品質在上限且預算 / 大小高於此值 → 回到原尺寸
+
+struct RateController {
+    bool enabled;
+    float quality;               // 平滑後的品質 (jpeg_encoder.h 1-100)
+    uint8_t skip;                // 每 skip 幀編碼一幀
+    uint8_t scale;               // 1 = 原尺寸, 2 = 長寬各半
+    uint32_t frame_bytes;        // 目前設定下的平均編碼大小
+    uint32_t frame_interval_us;  // 影像來源的平均間隔
+    uint32_t worst_drain_bps;    // 最近一次更新時最慢 / 最快的客戶端
+    uint32_t best_drain_bps;
+    uint32_t worst_latency_us;
+    uint32_t counter;
+    int64_t last_frame_us;
+    int64_t last_update_us;
+    uint16_t* half;              // 縮小用緩衝 (依需要配置)
+    size_t half_pixels;
+};
+
+void rate_init(RateController* rc, uint8_t quality) {
+    memset(rc, 0, sizeof(RateController));
+    rc->enabled = true;
+    rc->quality = constrain(quality, RATE_QUALITY_MIN, RATE_QUALITY_MAX);
+    rc->skip = 1;
+    rc->scale = 1;
+}
+
+__attribute__((always_inline)) inline uint8_t rate_quality(const RateController* rc) {
+    return (uint8_t)(rc->quality + 0.5f);
+}
+
+// 每個來源影像呼叫一次; 回傳這一幀是否要編碼
+bool rate_should_encode(RateController* rc) {
+    int64_t now = esp_timer_get_time();
+    if (rc->last_frame_us) {
+        uint32_t interval = now - rc->last_frame_us;
+        rc->frame_interval_us = rc->frame_interval_us ? (rc->frame_interval_us * 7 + interval) / 8 : interval;
+    }
+    rc->last_frame_us = now;
+    if (!rc->enabled) return true;
+    return rc->counter++ % rc->skip == 0;
+}
+
+// 長寬各半 (2x2 平均), 感測器位元組順序的 RGB565
+static void rate_halve_rgb565(const uint16_t* src, uint16_t* dst, uint16_t width, uint16_t height) {
+    uint16_t ow = width / 2, oh = height / 2;
+    for (uint16_t y = 0; y < oh; y++) {
+        const uint16_t* r0 = src + (size_t)(2 * y) * width;
+        const uint16_t* r1 = r0 + width;
+        uint16_t* out = dst + (size_t)y * ow;
+        for (uint16_t x = 0; x < ow; x++) {
+            uint16_t a = __builtin_bswap16(r0[2 * x]), b = __builtin_bswap16(r0[2 * x + 1]);
+            uint16_t c = __builtin_bswap16(r1[2 * x]), d = __builtin_bswap16(r1[2 * x + 1]);
+            uint16_t r = ((a >> 11) + (b >> 11) + (c >> 11) + (d >> 11) + 2) >> 2;
+            uint16_t g = (((a >> 5) & 0x3F) + ((b >> 5) & 0x3F) + ((c >> 5) & 0x3F) + ((d >> 5) & 0x3F) + 2) >> 2;
+            uint16_t bl = ((a & 0x1F) + (b & 0x1F) + (c & 0x1F) + (d & 0x1F) + 2) >> 2;
+            out[x] = __builtin_bswap16((r << 11) | (g << 5) | bl);
+        }
+    }
+}
+
+// 依目前的縮小設定回傳要編碼的影像與尺寸 (配置失敗時回傳原影像)
+const uint16_t* rate_prepare(RateController* rc, const uint16_t* buffer, uint16_t width, uint16_t height,
+                             uint16_t* out_width, uint16_t* out_height) {
+    *out_width = width;
+    *out_height = height;
+    if (!rc->enabled || rc->scale == 1) return buffer;
+    size_t pixels = (size_t)(width / 2) * (height / 2);
+    if (pixels > rc->half_pixels) {
+        free(rc->half);
+        rc->half = (uint16_t*)heap_caps_malloc(pixels * 2, MALLOC_CAP_SPIRAM);
+        if (rc->half == nullptr) rc->half = (uint16_t*)heap_caps_malloc(pixels * 2, MALLOC_CAP_8BIT);
+        rc->half_pixels = rc->half ? pixels : 0;
+        if (rc->half == nullptr) return buffer;
+    }
+    rate_halve_rgb565(buffer, rc->half, width, height);
+    *out_width = width / 2;
+    *out_height = height / 2;
+    return rc->half;
+}
+
+// 每次發布後呼叫: 累計影像大小, 每 RATE_UPDATE_US 依客戶端送出速率調整一次設定
+void rate_update(RateController* rc, FrameBroadcaster* b) {
+    if (b->last_len) rc->frame_bytes = rc->frame_bytes ? (rc->frame_bytes * 7 + b->last_len) / 8 : b->last_len;
+    int64_t now = esp_timer_get_time();
+    if (!rc->enabled || now - rc->last_update_us < RATE_UPDATE_US) return;
+    rc->last_update_us = now;
+
+    uint32_t worst = UINT32_MAX, best = 0, latency = 0;
+    uint8_t measured = 0, saturated = 0;
+    xSemaphoreTake(b->lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < BROADCAST_MAX_CLIENTS; i++) {
+        const BroadcastClient* c = &b->clients[i];
+        if (!c->active || c->drain_bps == 0) continue;
+        measured++;
+        latency = max(latency, c->latency_us);
+        if (!c->saturated) continue;
+        saturated++;
+        worst = min(worst, c->drain_bps);
+        best = max(best, c->drain_bps);
+    }
+    xSemaphoreGive(b->lock);
+    if (measured == 0 || rc->frame_bytes == 0) return;
+    rc->worst_drain_bps = saturated ? worst : 0;
+    rc->best_drain_bps = saturated == measured ? best : 0;
+    rc->worst_latency_us = latency;
+
+    // 品質: 最慢的飽和客戶端要在目標延遲的一半內送完一張; 都沒飽和就慢慢往上
+    float ratio = saturated ? worst * (RATE_TARGET_LATENCY_MS / 2000.0f) / rc->frame_bytes : RATE_UPSCALE_RATIO * 2;
+    float delta = constrain(log2f(ratio) * RATE_QUALITY_GAIN, -RATE_QUALITY_SLEW, RATE_QUALITY_SLEW);
+    if (latency > RATE_TARGET_LATENCY_MS * 2000u) delta = -RATE_QUALITY_SLEW;
+    rc->quality = constrain(rc->quality + delta, RATE_QUALITY_MIN, RATE_QUALITY_MAX);
+
+    // 縮小 / 回到原尺寸 (大小約差 4 倍, 換完重新量平均大小)
+    if (rc->scale == 1 && rc->quality <= RATE_QUALITY_MIN && ratio < RATE_DOWNSCALE_RATIO) {
+        rc->scale = 2;
+        rc->frame_bytes = 0;
+    } else if (rc->scale == 2 && rc->quality >= RATE_QUALITY_MAX && ratio > RATE_UPSCALE_RATIO) {
+        rc->scale = 1;
+        rc->frame_bytes = 0;
+    }
+
+    // 跳幀: 全部飽和時, 最快的客戶端送一張要幾個來源間隔; 無條件捨去,
+    // 編碼仍略快於送出, 客戶端保持飽和, 量到的速率才不會失效
+    rc->skip = 1;
+    if (rc->best_drain_bps && rc->frame_interval_us) {
+        uint32_t send_us = (uint64_t)rc->frame_bytes * 1000000 / rc->best_drain_bps;
+        rc->skip = constrain(send_us / rc->frame_interval_us, 1u, (uint32_t)RATE_MAX_SKIP);
+    }
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef __YUV_PIPELINE_H
+#define __YUV_PIPELINE_H
+
+#include <stdint.h>
+#include <Arduino.h>
+
+// ==================== YUV422 擷取: 色度平面上的色調旋轉 ====================
+// 感測器輸出 YUYV (Y0 U Y1 V), 兩個像素共用一組 Cb/Cr。
+// 色調旋轉與飽和度是 Cb/Cr 平面上的 2x2 變換, 再接 YCbCr → RGB 的色度部分 (3x2),
+// 兩者先合併成一個 Q16 的 3x2 矩陣: 每兩個像素只做 6 次乘法,
+// 每個像素只剩 Y 加上三個偏移量、飽和與打包成 RGB565, 完全不經過 HSV。
+// 輸出為感測器位元組順序 (大端序) 的 RGB565, 下游與 RGB565 擷取共用。
+
+struct ChromaTransform {
+    int16_t m[4];           // Q8 2x2: [Cb'; Cr'] = [m0 m1; m2 m3] [Cb; Cr]
+    int32_t r_cb, r_cr;     // Q16 合併後的色度 → RGB 偏移
+    int32_t g_cb, g_cr;
+    int32_t b_cb, b_cr;
+};
+
+struct YuvParams {
+    const uint8_t* src;     // YUYV
+    uint16_t* dst;          // RGB565 (大端序)
+    uint32_t pairs;         // 像素對數
+    const ChromaTransform* ct;
+};
+
+// hue_shift: 0-255 為一圈 (與 HSV 色調偏移同方向); saturation: Q8, 256 = 不變
+void chroma_transform_set(ChromaTransform* ct, int16_t hue_shift, int16_t saturation) {
+    float rad = hue_shift * (2.0f * PI / 256.0f);
+    float c = cosf(rad) * saturation;
+    float s = sinf(rad) * saturation;
+    // 以 (Cb, Cr) 為座標, R→Y→G→B 為逆時針
+    ct->m[0] = (int16_t)lroundf(c);
+    ct->m[1] = (int16_t)lroundf(-s);
+    ct->m[2] = (int16_t)lroundf(s);
+    ct->m[3] = (int16_t)lroundf(c);
+    // BT.601 全範圍 (JFIF): R = Y + 1.402 Cr, G = Y - 0.344 Cb - 0.714 Cr, B = Y + 1.772 Cb (Q8)
+    const int32_t kr_cr = 359, kg_cb = -88, kg_cr = -183, kb_cb = 454;
+    ct->r_cb = kr_cr * ct->m[2];
+    ct->r_cr = kr_cr * ct->m[3];
+    ct->g_cb = kg_cb * ct->m[0] + kg_cr * ct->m[2];
+    ct->g_cr = kg_cb * ct->m[1] + kg_cr * ct->m[3];
+    ct->b_cb = kb_cb * ct->m[0];
+    ct->b_cr = kb_cb * ct->m[1];
+}
+
+__attribute__((always_inline)) inline uint16_t IRAM_ATTR yuv_pack_rgb565(int32_t y, int32_t r_off, int32_t g_off, int32_t b_off) {
+    int32_t r = constrain(y + r_off, 0, 255);
+    int32_t g = constrain(y + g_off, 0, 255);
+    int32_t b = constrain(y + b_off, 0, 255);
+    return __builtin_bswap16(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+void IRAM_ATTR yuv422_convert_span(YuvParams* p) {
+    const uint8_t* src = p->src;
+    uint16_t* dst = p->dst;
+    const ChromaTransform* ct = p->ct;
+    for (uint32_t i = 0; i < p->pairs; i++) {
+        int32_t cb = src[1] - 128;
+        int32_t cr = src[3] - 128;
+        int32_t r_off = (ct->r_cb * cb + ct->r_cr * cr + 32768) >> 16;
+        int32_t g_off = (ct->g_cb * cb + ct->g_cr * cr + 32768) >> 16;
+        int32_t b_off = (ct->b_cb * cb + ct->b_cr * cr + 32768) >> 16;
+        dst[0] = yuv_pack_rgb565(src[0], r_off, g_off, b_off);
+        dst[1] = yuv_pack_rgb565(src[2], r_off, g_off, b_off);
+        src += 4;
+        dst += 2;
+    }
+}
+
+// 整幀 YUYV → RGB565 並套用色度變換 (ct 為 nullptr 時只轉換), 兩個核心各做一半
+void IRAM_ATTR yuv422_to_rgb565_parallel(const uint8_t* src, uint16_t* dst, uint32_t pixel_count, const ChromaTransform* ct = nullptr) {
+    static ChromaTransform identity;
+    static bool identity_ready = false;
+    if (src == nullptr || dst == nullptr) return;
+    if (ct == nullptr) {
+        if (!identity_ready) {
+            chroma_transform_set(&identity, 0, 256);
+            identity_ready = true;
+        }
+        ct = &identity;
+    }
+
+    TaskHandle_t task_handle = nullptr;
+    uint32_t pairs = pixel_count / 2;
+    uint32_t split = pairs / 2;
+
+    YuvParams* params = new YuvParams();
+    params->src = src + split * 4;
+    params->dst = dst + split * 2;
+    params->pairs = pairs - split;
+    params->ct = ct;
+
+    auto task_func = [](void* p) {
+        YuvParams* args = (YuvParams*)p;
+        yuv422_convert_span(args);
+        delete args;
+        vTaskDelete(NULL);
+    };
+
+    BaseType_t result = xTaskCreatePinnedToCore(
+        task_func,
+        "yuv_task",
+        4096,
+        params,
+        1,
+        &task_handle,
+        !xPortGetCoreID()
+    );
+
+    if (result != pdPASS) {
+        Serial.println("Failed to create task! Falling back to single core.");
+        params->src = src;
+        params->dst = dst;
+        params->pairs = pairs;
+        yuv422_convert_span(params);
+        delete params;
+        return;
+    }
+
+    YuvParams first = { src, dst, split, ct };
+    yuv422_convert_span(&first);
+
+    if (task_handle != nullptr) {
+        while (eTaskGetState(task_handle) != eDeleted) {
+            delay(1);
+        }
+    }
+}
+
+#endif